@@ -0,0 +1,146 @@
+// HTTP server benchmark: starts benchmark/http/server.js in its own process
+// and runs the load generator against it for every combination of the given
+// connection counts, pipelining depths, request body sizes and paths.
+//
+//   tjs run benchmark/http/bench.js [--connections 1,50] [--pipeline 1,16]
+//       [--size 0] [--path /,/bytes/16384] [--duration 10] [--workers 0] [--json]
+//
+// Reports req/s, latency percentiles and the server's resident memory (where
+// /proc is available). --json prints a single JSON document, meant to be kept
+// and compared across commits.
+//
+
+import getopts from 'tjs:getopts';
+import path from 'tjs:path';
+
+import { format, run } from './load.js';
+
+const decoder = new TextDecoder();
+
+const list = v => String(v).split(',').filter(Boolean);
+
+async function startServer(workers) {
+    const proc = tjs.spawn([
+        tjs.exePath,
+        'run',
+        path.join(import.meta.dirname, 'server.js'),
+        '--workers',
+        String(workers)
+    ], { stdout: 'pipe' });
+    const buf = new Uint8Array(256);
+    let out = '';
+
+    while (!out.includes('\n')) {
+        const nread = await proc.stdout.read(buf);
+
+        if (nread === null) {
+            throw new Error('The server exited before listening');
+        }
+
+        out += decoder.decode(buf.subarray(0, nread));
+    }
+
+    const m = /listening (\d+)/.exec(out);
+
+    if (!m) {
+        proc.kill();
+        throw new Error(`Unexpected server output: ${out}`);
+    }
+
+    return { proc, port: Number(m[1]) };
+}
+
+// Resident set size of a process in bytes, or null where /proc isn't there.
+async function readRss(pid) {
+    try {
+        const status = decoder.decode(await tjs.readFile(`/proc/${pid}/status`));
+        const m = /VmRSS:\s*(\d+) kB/.exec(status);
+
+        return m ? Number(m[1]) * 1024 : null;
+    } catch {
+        return null;
+    }
+}
+
+async function runScenario(server, options) {
+    const start = await readRss(server.proc.pid);
+    let peak = start;
+    const sampler = setInterval(async () => {
+        const rss = await readRss(server.proc.pid);
+
+        if (rss !== null) {
+            peak = Math.max(peak, rss);
+        }
+    }, 250);
+
+    let result;
+
+    try {
+        result = await run({ port: server.port, ...options });
+    } finally {
+        clearInterval(sampler);
+    }
+
+    const end = await readRss(server.proc.pid);
+
+    if (start !== null && end !== null) {
+        result.rss = { start, peak: Math.max(peak, end), end };
+    }
+
+    return result;
+}
+
+const options = getopts(tjs.args.slice(2), {
+    boolean: [ 'json' ],
+    default: {
+        connections: '50',
+        pipeline: '1',
+        size: '0',
+        path: '/',
+        duration: 10,
+        workers: 0
+    }
+});
+
+const server = await startServer(Number(options.workers));
+const results = [];
+
+// Give the workers, if any, a moment to start listening.
+await new Promise(resolve => setTimeout(resolve, options.workers > 0 ? 500 : 0));
+
+try {
+    for (const p of list(options.path)) {
+        for (const size of list(options.size)) {
+            for (const connections of list(options.connections)) {
+                for (const pipeline of list(options.pipeline)) {
+                    const result = await runScenario(server, {
+                        path: p,
+                        size: Number(size),
+                        connections: Number(connections),
+                        pipeline: Number(pipeline),
+                        duration: Number(options.duration)
+                    });
+
+                    results.push(result);
+
+                    if (!options.json) {
+                        console.log(format(result));
+                    }
+                }
+            }
+        }
+    }
+} finally {
+    server.proc.kill();
+    await server.proc.wait();
+}
+
+if (options.json) {
+    console.log(JSON.stringify({
+        version: tjs.version,
+        platform: tjs.system.platform,
+        workers: Number(options.workers),
+        date: new Date().toISOString(),
+        results
+    }, null, 2));
+}
@@ -0,0 +1,339 @@
+// HTTP/1.1 load generator, can also be run on its own against any server:
+//
+//   tjs run benchmark/http/load.js --port 8000 [--host 127.0.0.1] [--connections 50]
+//       [--pipeline 1] [--duration 10] [--size 0] [--path /] [--json]
+//
+// Every connection keeps `pipeline` requests in flight: they are written in
+// one go and the next batch goes out once all the responses are in. With
+// --size N requests are POSTs carrying N bytes. Responses must be framed by
+// Content-Length.
+//
+
+import getopts from 'tjs:getopts';
+
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+/**
+ * Latency histogram in microseconds. Values under 32 get a bucket each, above
+ * that every power of two is split in 32 buckets, so percentiles are within
+ * about 3% of the exact value at a fixed memory cost.
+ */
+export class Histogram {
+    constructor() {
+        this.counts = new Float64Array(32 + 26 * 32);
+        this.count = 0;
+        this.sum = 0;
+        this.max = 0;
+    }
+
+    static index(v) {
+        if (v < 32) {
+            return v;
+        }
+
+        const k = 31 - Math.clz32(v);
+
+        return 32 + (k - 5) * 32 + ((v >>> (k - 5)) - 32);
+    }
+
+    // The highest value that lands in bucket i.
+    static value(i) {
+        if (i < 32) {
+            return i;
+        }
+
+        const shift = Math.floor((i - 32) / 32);
+        const sub = (i - 32) % 32;
+
+        return (33 + sub) * 2 ** shift - 1;
+    }
+
+    record(us) {
+        const v = Math.min(Math.max(Math.round(us), 0), 2 ** 31 - 1);
+
+        this.counts[Histogram.index(v)]++;
+        this.count++;
+        this.sum += us;
+        this.max = Math.max(this.max, us);
+    }
+
+    merge(other) {
+        for (let i = 0; i < this.counts.length; i++) {
+            this.counts[i] += other.counts[i];
+        }
+
+        this.count += other.count;
+        this.sum += other.sum;
+        this.max = Math.max(this.max, other.max);
+    }
+
+    percentile(p) {
+        const target = Math.ceil(p / 100 * this.count);
+        let seen = 0;
+
+        for (let i = 0; i < this.counts.length; i++) {
+            seen += this.counts[i];
+
+            if (seen >= target && seen > 0) {
+                return Math.min(Histogram.value(i), this.max);
+            }
+        }
+
+        return 0;
+    }
+}
+
+/**
+ * Counts the responses in a byte stream without buffering it: heads are
+ * decoded to find the status and Content-Length, bodies are only skipped.
+ */
+class ResponseCounter {
+    constructor() {
+        this.bodyLeft = 0;
+        this.match = 0; // bytes of \r\n\r\n seen
+        this.head = '';
+        this.errors = 0;
+    }
+
+    // Returns the number of responses completed by buf[0, len).
+    feed(buf, len) {
+        let count = 0;
+        let i = 0;
+
+        while (i < len) {
+            if (this.bodyLeft > 0) {
+                const n = Math.min(this.bodyLeft, len - i);
+
+                this.bodyLeft -= n;
+                i += n;
+
+                if (this.bodyLeft === 0) {
+                    count++;
+                }
+
+                continue;
+            }
+
+            const start = i;
+
+            while (i < len && this.match < 4) {
+                const c = buf[i++];
+
+                if (c === (this.match % 2 === 0 ? 13 : 10)) {
+                    this.match++;
+                } else {
+                    this.match = c === 13 ? 1 : 0;
+                }
+            }
+
+            this.head += decoder.decode(buf.subarray(start, i));
+
+            if (this.match < 4) {
+                break;
+            }
+
+            const status = Number(this.head.slice(9, 12));
+            const m = /\r\ncontent-length: *(\d+)/i.exec(this.head);
+
+            if (!m) {
+                throw new Error(`Response without Content-Length: ${this.head.split('\r\n')[0]}`);
+            }
+
+            if (status < 200 || status >= 400) {
+                this.errors++;
+            }
+
+            this.bodyLeft = Number(m[1]);
+            this.head = '';
+            this.match = 0;
+
+            if (this.bodyLeft === 0) {
+                count++;
+            }
+        }
+
+        return count;
+    }
+}
+
+function buildRequest(options) {
+    const size = options.size | 0;
+    const method = size > 0 ? 'POST' : 'GET';
+    let head = `${method} ${options.path} HTTP/1.1\r\nHost: ${options.host}:${options.port}\r\n`;
+
+    if (size > 0) {
+        head += `Content-Type: application/octet-stream\r\nContent-Length: ${size}\r\n`;
+    }
+
+    const headBytes = encoder.encode(head + '\r\n');
+    const req = new Uint8Array(headBytes.length + size);
+
+    req.set(headBytes);
+    req.fill(120, headBytes.length);
+
+    // One write per batch of pipelined requests.
+    const batch = new Uint8Array(req.length * options.pipeline);
+
+    for (let i = 0; i < options.pipeline; i++) {
+        batch.set(req, i * req.length);
+    }
+
+    return batch;
+}
+
+async function runConnection(options, state, batch) {
+    const conn = await tjs.connect('tcp', options.host, options.port);
+    const buf = new Uint8Array(65536);
+    const counter = new ResponseCounter();
+    const hist = new Histogram();
+
+    conn.setNoDelay(true);
+
+    try {
+        while (!state.done) {
+            const start = performance.now();
+            let pending = options.pipeline;
+
+            await conn.write(batch);
+
+            while (pending > 0) {
+                const nread = await conn.read(buf);
+
+                if (nread === null) {
+                    throw new Error('Connection closed by the server');
+                }
+
+                state.bytes += nread;
+
+                const done = counter.feed(buf, nread);
+
+                if (done > 0) {
+                    // Pipelined requests all went out at start.
+                    const us = (performance.now() - start) * 1000;
+
+                    for (let i = 0; i < done; i++) {
+                        hist.record(us);
+                    }
+
+                    pending -= done;
+                    state.requests += done;
+                }
+            }
+        }
+    } finally {
+        conn.close();
+    }
+
+    state.errors += counter.errors;
+
+    return hist;
+}
+
+/**
+ * Runs the load for options.duration seconds and resolves to the results.
+ * Latencies are in milliseconds.
+ */
+export async function run(options) {
+    options = {
+        host: '127.0.0.1',
+        connections: 50,
+        pipeline: 1,
+        duration: 10,
+        size: 0,
+        path: '/',
+        ...options
+    };
+
+    const batch = buildRequest(options);
+    const state = { done: false, requests: 0, errors: 0, bytes: 0 };
+    const timer = setTimeout(() => {
+        state.done = true;
+    }, options.duration * 1000);
+    const start = performance.now();
+    const conns = [];
+
+    for (let i = 0; i < options.connections; i++) {
+        conns.push(runConnection(options, state, batch));
+    }
+
+    let hists;
+
+    try {
+        hists = await Promise.all(conns);
+    } finally {
+        clearTimeout(timer);
+        state.done = true;
+    }
+
+    const elapsed = (performance.now() - start) / 1000;
+    const hist = new Histogram();
+
+    for (const h of hists) {
+        hist.merge(h);
+    }
+
+    return {
+        connections: options.connections,
+        pipeline: options.pipeline,
+        size: options.size,
+        path: options.path,
+        duration: elapsed,
+        requests: state.requests,
+        rps: state.requests / elapsed,
+        errors: state.errors,
+        bytes: state.bytes,
+        latency: {
+            mean: hist.count ? hist.sum / hist.count / 1000 : 0,
+            p50: hist.percentile(50) / 1000,
+            p99: hist.percentile(99) / 1000,
+            p999: hist.percentile(99.9) / 1000,
+            max: hist.max / 1000
+        }
+    };
+}
+
+export function format(r) {
+    const mb = n => (n / (1024 * 1024)).toFixed(1);
+    const ms = n => n.toFixed(2);
+    const lines = [
+        `${r.path} connections=${r.connections} pipeline=${r.pipeline} size=${r.size}`,
+        `  requests:   ${r.requests} in ${r.duration.toFixed(1)}s, ${r.rps.toFixed(0)} req/s, ${r.errors} errors`,
+        `  latency:    p50 ${ms(r.latency.p50)}ms  p99 ${ms(r.latency.p99)}ms  ` +
+            `p999 ${ms(r.latency.p999)}ms  max ${ms(r.latency.max)}ms`,
+        `  throughput: ${mb(r.bytes / r.duration)} MB/s`
+    ];
+
+    if (r.rss) {
+        lines.push(`  server rss: ${mb(r.rss.end)} MB (start ${mb(r.rss.start)} MB, peak ${mb(r.rss.peak)} MB)`);
+    }
+
+    return lines.join('\n');
+}
+
+if (import.meta.main) {
+    const options = getopts(tjs.args.slice(2), {
+        boolean: [ 'json' ],
+        default: {
+            host: '127.0.0.1',
+            port: 8000,
+            connections: 50,
+            pipeline: 1,
+            duration: 10,
+            size: 0,
+            path: '/'
+        }
+    });
+
+    const result = await run({
+        host: options.host,
+        port: Number(options.port),
+        connections: Number(options.connections),
+        pipeline: Number(options.pipeline),
+        duration: Number(options.duration),
+        size: Number(options.size),
+        path: String(options.path)
+    });
+
+    console.log(options.json ? JSON.stringify(result, null, 2) : format(result));
+}
@@ -0,0 +1,71 @@
+// HTTP server driven by bench.js, can also be run on its own:
+//
+//   tjs run benchmark/http/server.js --port 8000 [--host 127.0.0.1] [--workers 3]
+//
+// Routes:
+//   /            a short text response
+//   /bytes/N     N bytes of payload
+//   /echo        the request body sent back
+//   /file        this file, through sendFile()
+//
+
+import getopts from 'tjs:getopts';
+
+const encoder = new TextEncoder();
+const payloads = new Map();
+
+function payload(size) {
+    let buf = payloads.get(size);
+
+    if (!buf) {
+        buf = new Uint8Array(size).fill(120);
+        payloads.set(size, buf);
+    }
+
+    return buf;
+}
+
+export default function onRequest(req, res) {
+    const url = req.url;
+
+    if (url === '/') {
+        res.setHeader('Content-Type', 'text/plain');
+        res.end('Hello World');
+    } else if (url.startsWith('/bytes/')) {
+        res.setHeader('Content-Type', 'application/octet-stream');
+        res.end(payload(Number(url.slice(7)) | 0));
+    } else if (url === '/echo') {
+        req.arrayBuffer().then(buf => {
+            res.setHeader('Content-Type', 'application/octet-stream');
+            res.end(new Uint8Array(buf));
+        });
+    } else if (url === '/file') {
+        res.setHeader('Content-Type', 'text/javascript');
+        res.sendFile(import.meta.path);
+    } else {
+        res.writeHead(404);
+        res.end(encoder.encode('Not Found'));
+    }
+}
+
+if (import.meta.main) {
+    const options = getopts(tjs.args.slice(2), {
+        default: {
+            host: '127.0.0.1',
+            port: 0,
+            workers: 0
+        }
+    });
+
+    const server = tjs.createServer(onRequest);
+
+    server.listen({
+        host: options.host,
+        port: Number(options.port),
+        workers: Number(options.workers),
+        module: new URL(import.meta.url)
+    });
+
+    // bench.js waits for this line.
+    console.log(`listening ${server.address().port}`);
+}
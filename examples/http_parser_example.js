@@ -137,7 +137,7 @@ function demonstrateParserReuse() {
   const request1 = "GET /first HTTP/1.1\r\nHost: example.com\r\n\r\n";
   parser.execute(request1);
   const result1 = parser.getResult();
-  console.log(`First request - URL: ${result1.url}, Host: ${result1.headers.Host}`);
+  console.log(`First request - URL: ${result1.url}, Host: ${result1.headers.host}`);
   
   // Reset parser and parse second request
   parser.reset();
@@ -180,7 +180,7 @@ function createHttpResponse() {
   
   console.log("\nParsed back verification:");
   console.log(`  Status Code: ${parsedBack.statusCode}`);
-  console.log(`  Content-Type: ${parsedBack.headers["Content-Type"]}`);
+  console.log(`  Content-Type: ${parsedBack.headers["content-type"]}`);
   console.log(`  Body length: ${parsedBack.body.length}`);
   
   console.log();
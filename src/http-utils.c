@@ -0,0 +1,732 @@
+/*
+ * txiki.js
+ *
+ * Copyright (c) 2019-present Saúl Ibarra Corretgé <s@saghul.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "http-utils.h"
+
+#include "../deps/llhttp/include/llhttp.h"
+#include "mem.h"
+#include "utils.h"
+
+#include <string.h>
+#include <time.h>
+
+
+/*
+ * Header names which show up in most requests and responses. Their atoms are
+ * created once per runtime so building a headers object doesn't need to hash
+ * and intern the same strings over and over. Names are lowercase, like Node.
+ */
+#define TJS__HTTP_HEADER(name) { name, sizeof(name) - 1 }
+
+static const struct {
+    const char *name;
+    size_t len;
+} tjs__http_headers[] = {
+    TJS__HTTP_HEADER("accept"),
+    TJS__HTTP_HEADER("accept-charset"),
+    TJS__HTTP_HEADER("accept-encoding"),
+    TJS__HTTP_HEADER("accept-language"),
+    TJS__HTTP_HEADER("accept-ranges"),
+    TJS__HTTP_HEADER("access-control-allow-origin"),
+    TJS__HTTP_HEADER("age"),
+    TJS__HTTP_HEADER("authorization"),
+    TJS__HTTP_HEADER("cache-control"),
+    TJS__HTTP_HEADER("connection"),
+    TJS__HTTP_HEADER("content-disposition"),
+    TJS__HTTP_HEADER("content-encoding"),
+    TJS__HTTP_HEADER("content-language"),
+    TJS__HTTP_HEADER("content-length"),
+    TJS__HTTP_HEADER("content-range"),
+    TJS__HTTP_HEADER("content-type"),
+    TJS__HTTP_HEADER("cookie"),
+    TJS__HTTP_HEADER("date"),
+    TJS__HTTP_HEADER("etag"),
+    TJS__HTTP_HEADER("expect"),
+    TJS__HTTP_HEADER("expires"),
+    TJS__HTTP_HEADER("host"),
+    TJS__HTTP_HEADER("if-match"),
+    TJS__HTTP_HEADER("if-modified-since"),
+    TJS__HTTP_HEADER("if-none-match"),
+    TJS__HTTP_HEADER("if-range"),
+    TJS__HTTP_HEADER("if-unmodified-since"),
+    TJS__HTTP_HEADER("keep-alive"),
+    TJS__HTTP_HEADER("last-modified"),
+    TJS__HTTP_HEADER("location"),
+    TJS__HTTP_HEADER("origin"),
+    TJS__HTTP_HEADER("pragma"),
+    TJS__HTTP_HEADER("range"),
+    TJS__HTTP_HEADER("referer"),
+    TJS__HTTP_HEADER("server"),
+    TJS__HTTP_HEADER("set-cookie"),
+    TJS__HTTP_HEADER("transfer-encoding"),
+    TJS__HTTP_HEADER("upgrade"),
+    TJS__HTTP_HEADER("user-agent"),
+    TJS__HTTP_HEADER("vary"),
+    TJS__HTTP_HEADER("via"),
+    TJS__HTTP_HEADER("x-forwarded-for"),
+    TJS__HTTP_HEADER("x-forwarded-host"),
+    TJS__HTTP_HEADER("x-forwarded-proto"),
+    TJS__HTTP_HEADER("x-requested-with"),
+};
+
+#undef TJS__HTTP_HEADER
+
+#define TJS__HTTP_NHEADERS countof(tjs__http_headers)
+/* Upper bound for llhttp_method_t values, anything above isn't cached. */
+#define TJS__HTTP_NMETHODS 64
+/* Longest header name which gets lowercased on the stack. */
+#define TJS__HTTP_MAX_NAME 64
+
+/*
+ * Well-known names are found through a small open addressing table, hashed
+ * with FNV-1a while the name is lowercased. Slots hold the index in
+ * tjs__http_headers plus one, 0 is empty. It's built once and never changes.
+ */
+#define TJS__HTTP_NSLOTS 128 /* power of 2, over twice the number of headers */
+
+static uint8_t tjs__http_header_slots[TJS__HTTP_NSLOTS];
+static uv_once_t tjs__http_header_slots_once = UV_ONCE_INIT;
+
+#define TJS__HTTP_FNV_BASIS 2166136261u
+#define TJS__HTTP_FNV_PRIME 16777619u
+
+static void tjs__http_header_slots_init(void) {
+    for (size_t i = 0; i < TJS__HTTP_NHEADERS; i++) {
+        uint32_t h = TJS__HTTP_FNV_BASIS;
+        for (size_t j = 0; j < tjs__http_headers[i].len; j++) {
+            h = (h ^ (uint8_t) tjs__http_headers[i].name[j]) * TJS__HTTP_FNV_PRIME;
+        }
+
+        uint32_t slot = h & (TJS__HTTP_NSLOTS - 1);
+        while (tjs__http_header_slots[slot] != 0) {
+            slot = (slot + 1) & (TJS__HTTP_NSLOTS - 1);
+        }
+        tjs__http_header_slots[slot] = i + 1;
+    }
+}
+
+static JSAtom *tjs__http_get_atoms(JSContext *ctx) {
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    CHECK_NOT_NULL(qrt);
+
+    if (qrt->http_ctx.atoms == NULL) {
+        uv_once(&tjs__http_header_slots_once, tjs__http_header_slots_init);
+
+        JSAtom *atoms = tjs__mallocz(sizeof(*atoms) * (TJS__HTTP_NHEADERS + TJS__HTTP_NMETHODS));
+        CHECK_NOT_NULL(atoms);
+
+        for (size_t i = 0; i < TJS__HTTP_NHEADERS; i++) {
+            atoms[i] = JS_NewAtomLen(ctx, tjs__http_headers[i].name, tjs__http_headers[i].len);
+        }
+
+        qrt->http_ctx.atoms = atoms;
+    }
+
+    return qrt->http_ctx.atoms;
+}
+
+JSAtom tjs__http_header_atom(JSContext *ctx, const char *name, size_t len) {
+    JSAtom *atoms = tjs__http_get_atoms(ctx);
+    char buf[TJS__HTTP_MAX_NAME];
+    char *lname = buf;
+
+    if (len > sizeof(buf)) {
+        lname = tjs__malloc(len);
+        if (!lname) {
+            return JS_ATOM_NULL;
+        }
+    }
+
+    uint32_t h = TJS__HTTP_FNV_BASIS;
+    for (size_t i = 0; i < len; i++) {
+        char ch = name[i];
+        lname[i] = (ch >= 'A' && ch <= 'Z') ? ch | 0x20 : ch;
+        h = (h ^ (uint8_t) lname[i]) * TJS__HTTP_FNV_PRIME;
+    }
+
+    JSAtom atom = JS_ATOM_NULL;
+
+    if (len <= TJS__HTTP_MAX_NAME) {
+        for (uint32_t slot = h & (TJS__HTTP_NSLOTS - 1); tjs__http_header_slots[slot] != 0;
+             slot = (slot + 1) & (TJS__HTTP_NSLOTS - 1)) {
+            size_t i = tjs__http_header_slots[slot] - 1;
+            if (tjs__http_headers[i].len == len && memcmp(tjs__http_headers[i].name, lname, len) == 0) {
+                atom = JS_DupAtom(ctx, atoms[i]);
+                break;
+            }
+        }
+    }
+
+    if (atom == JS_ATOM_NULL) {
+        atom = JS_NewAtomLen(ctx, lname, len);
+    }
+
+    if (lname != buf) {
+        tjs__free(lname);
+    }
+
+    return atom;
+}
+
+JSValue tjs__http_method_string(JSContext *ctx, int method) {
+    JSAtom *atoms = tjs__http_get_atoms(ctx) + TJS__HTTP_NHEADERS;
+    const char *name = llhttp_method_name((llhttp_method_t) method);
+
+    if (method < 0 || method >= TJS__HTTP_NMETHODS) {
+        return JS_NewString(ctx, name);
+    }
+
+    if (atoms[method] == JS_ATOM_NULL) {
+        atoms[method] = JS_NewAtom(ctx, name);
+    }
+
+    return JS_AtomToString(ctx, atoms[method]);
+}
+
+static JSValue tjs__http_merge_header(JSContext *ctx,
+                                      JSValue prev,
+                                      bool as_array,
+                                      const char *base,
+                                      const TJSHttpHeader *h) {
+    if (as_array) {
+        JSValue value = JS_NewStringLen(ctx, base + h->value.off, h->value.len);
+        int64_t len = 1;
+        if (JS_IsArray(prev)) {
+            JS_GetLength(ctx, prev, &len);
+        } else {
+            JSValue arr = JS_NewArray(ctx);
+            JS_SetPropertyUint32(ctx, arr, 0, prev);
+            prev = arr;
+        }
+        JS_SetPropertyInt64(ctx, prev, len, value);
+
+        return prev;
+    }
+
+    size_t prev_len;
+    const char *prev_str = JS_ToCStringLen(ctx, &prev_len, prev);
+    JS_FreeValue(ctx, prev);
+    if (!prev_str) {
+        return JS_EXCEPTION;
+    }
+
+    DynBuf dbuf;
+    tjs_dbuf_init(ctx, &dbuf);
+    dbuf_put(&dbuf, (const uint8_t *) prev_str, prev_len);
+    dbuf_put(&dbuf, (const uint8_t *) ", ", 2);
+    dbuf_put(&dbuf, (const uint8_t *) base + h->value.off, h->value.len);
+    JS_FreeCString(ctx, prev_str);
+
+    JSValue value = JS_NewStringLen(ctx, (const char *) dbuf.buf, dbuf.size);
+    dbuf_free(&dbuf);
+
+    return value;
+}
+
+/*
+ * Build a headers object out of parsed name / value spans. Duplicates follow
+ * Node: set-cookie values are collected in an array, anything else is joined
+ * with ", ".
+ */
+JSValue tjs__http_new_headers(JSContext *ctx, const char *base, const TJSHttpHeader *headers, size_t count) {
+    JSValue obj = JS_NewObject(ctx);
+    if (JS_IsException(obj)) {
+        return obj;
+    }
+
+    JSAtom set_cookie = tjs__http_header_atom(ctx, "set-cookie", 10);
+    JSAtom seen[32];
+
+    for (size_t i = 0; i < count; i++) {
+        const TJSHttpHeader *h = &headers[i];
+        JSAtom name = tjs__http_header_atom(ctx, base + h->name.off, h->name.len);
+        if (name == JS_ATOM_NULL) {
+            JS_FreeAtom(ctx, set_cookie);
+            JS_FreeValue(ctx, obj);
+            return JS_EXCEPTION;
+        }
+
+        /* Duplicates are rare, scan the names seen so far before asking the object. */
+        bool dup = false;
+        if (i < countof(seen)) {
+            for (size_t j = 0; j < i; j++) {
+                if (seen[j] == name) {
+                    dup = true;
+                    break;
+                }
+            }
+            seen[i] = name;
+        } else {
+            dup = JS_HasProperty(ctx, obj, name) > 0;
+        }
+
+        JSValue value;
+
+        if (dup) {
+            value = tjs__http_merge_header(ctx, JS_GetProperty(ctx, obj, name), name == set_cookie, base, h);
+        } else {
+            value = JS_NewStringLen(ctx, base + h->value.off, h->value.len);
+        }
+
+        JS_DefinePropertyValue(ctx, obj, name, value, JS_PROP_C_W_E);
+        JS_FreeAtom(ctx, name);
+    }
+
+    JS_FreeAtom(ctx, set_cookie);
+
+    return obj;
+}
+
+void tjs__http_free_atoms(TJSRuntime *qrt) {
+    JSAtom *atoms = qrt->http_ctx.atoms;
+
+    if (atoms == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < TJS__HTTP_NHEADERS + TJS__HTTP_NMETHODS; i++) {
+        if (atoms[i] != JS_ATOM_NULL) {
+            JS_FreeAtom(qrt->ctx, atoms[i]);
+        }
+    }
+
+    tjs__free(atoms);
+    qrt->http_ctx.atoms = NULL;
+}
+
+
+/* Status lines are fully precomputed, keep the table sorted by code. */
+#define TJS__HTTP_STATUS_LINE(code, text) "HTTP/1.1 " #code " " text "\r\n"
+#define TJS__HTTP_STATUS(code, text)                                                                                   \
+    { code, text, TJS__HTTP_STATUS_LINE(code, text), sizeof(TJS__HTTP_STATUS_LINE(code, text)) - 1 }
+
+static const struct {
+    int code;
+    const char *text;
+    const char *line;
+    size_t len;
+} tjs__http_statuses[] = {
+    TJS__HTTP_STATUS(100, "Continue"),
+    TJS__HTTP_STATUS(101, "Switching Protocols"),
+    TJS__HTTP_STATUS(102, "Processing"),
+    TJS__HTTP_STATUS(103, "Early Hints"),
+    TJS__HTTP_STATUS(200, "OK"),
+    TJS__HTTP_STATUS(201, "Created"),
+    TJS__HTTP_STATUS(202, "Accepted"),
+    TJS__HTTP_STATUS(203, "Non-Authoritative Information"),
+    TJS__HTTP_STATUS(204, "No Content"),
+    TJS__HTTP_STATUS(205, "Reset Content"),
+    TJS__HTTP_STATUS(206, "Partial Content"),
+    TJS__HTTP_STATUS(207, "Multi-Status"),
+    TJS__HTTP_STATUS(208, "Already Reported"),
+    TJS__HTTP_STATUS(226, "IM Used"),
+    TJS__HTTP_STATUS(300, "Multiple Choices"),
+    TJS__HTTP_STATUS(301, "Moved Permanently"),
+    TJS__HTTP_STATUS(302, "Found"),
+    TJS__HTTP_STATUS(303, "See Other"),
+    TJS__HTTP_STATUS(304, "Not Modified"),
+    TJS__HTTP_STATUS(305, "Use Proxy"),
+    TJS__HTTP_STATUS(307, "Temporary Redirect"),
+    TJS__HTTP_STATUS(308, "Permanent Redirect"),
+    TJS__HTTP_STATUS(400, "Bad Request"),
+    TJS__HTTP_STATUS(401, "Unauthorized"),
+    TJS__HTTP_STATUS(402, "Payment Required"),
+    TJS__HTTP_STATUS(403, "Forbidden"),
+    TJS__HTTP_STATUS(404, "Not Found"),
+    TJS__HTTP_STATUS(405, "Method Not Allowed"),
+    TJS__HTTP_STATUS(406, "Not Acceptable"),
+    TJS__HTTP_STATUS(407, "Proxy Authentication Required"),
+    TJS__HTTP_STATUS(408, "Request Timeout"),
+    TJS__HTTP_STATUS(409, "Conflict"),
+    TJS__HTTP_STATUS(410, "Gone"),
+    TJS__HTTP_STATUS(411, "Length Required"),
+    TJS__HTTP_STATUS(412, "Precondition Failed"),
+    TJS__HTTP_STATUS(413, "Payload Too Large"),
+    TJS__HTTP_STATUS(414, "URI Too Long"),
+    TJS__HTTP_STATUS(415, "Unsupported Media Type"),
+    TJS__HTTP_STATUS(416, "Range Not Satisfiable"),
+    TJS__HTTP_STATUS(417, "Expectation Failed"),
+    TJS__HTTP_STATUS(418, "I'm a Teapot"),
+    TJS__HTTP_STATUS(421, "Misdirected Request"),
+    TJS__HTTP_STATUS(422, "Unprocessable Entity"),
+    TJS__HTTP_STATUS(423, "Locked"),
+    TJS__HTTP_STATUS(424, "Failed Dependency"),
+    TJS__HTTP_STATUS(425, "Too Early"),
+    TJS__HTTP_STATUS(426, "Upgrade Required"),
+    TJS__HTTP_STATUS(428, "Precondition Required"),
+    TJS__HTTP_STATUS(429, "Too Many Requests"),
+    TJS__HTTP_STATUS(431, "Request Header Fields Too Large"),
+    TJS__HTTP_STATUS(451, "Unavailable For Legal Reasons"),
+    TJS__HTTP_STATUS(500, "Internal Server Error"),
+    TJS__HTTP_STATUS(501, "Not Implemented"),
+    TJS__HTTP_STATUS(502, "Bad Gateway"),
+    TJS__HTTP_STATUS(503, "Service Unavailable"),
+    TJS__HTTP_STATUS(504, "Gateway Timeout"),
+    TJS__HTTP_STATUS(505, "HTTP Version Not Supported"),
+    TJS__HTTP_STATUS(506, "Variant Also Negotiates"),
+    TJS__HTTP_STATUS(507, "Insufficient Storage"),
+    TJS__HTTP_STATUS(508, "Loop Detected"),
+    TJS__HTTP_STATUS(509, "Bandwidth Limit Exceeded"),
+    TJS__HTTP_STATUS(510, "Not Extended"),
+    TJS__HTTP_STATUS(511, "Network Authentication Required"),
+};
+
+#undef TJS__HTTP_STATUS
+#undef TJS__HTTP_STATUS_LINE
+
+static int tjs__http_find_status(int status) {
+    int lo = 0;
+    int hi = countof(tjs__http_statuses) - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int code = tjs__http_statuses[mid].code;
+        if (code == status) {
+            return mid;
+        } else if (code < status) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+const char *tjs__http_status_text(int status) {
+    int idx = tjs__http_find_status(status);
+
+    return idx < 0 ? NULL : tjs__http_statuses[idx].text;
+}
+
+/* RFC 7230 token characters, what header names are made of. */
+bool tjs__http_valid_token(const char *s, size_t len) {
+    if (len == 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+        bool alnum = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        if (!alnum && (c == '\0' || !strchr("!#$%&'*+-.^_`|~", c))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* RFC 7230 reason-phrase: tabs, spaces, visible and non-ASCII characters. */
+bool tjs__http_valid_status_text(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+        if (c != '\t' && (c < 0x20 || c == 0x7f)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* A custom status text must have passed tjs__http_valid_status_text(). */
+void tjs__http_put_status_line(DynBuf *dbuf, int status, const char *status_text) {
+    int idx = tjs__http_find_status(status);
+
+    if (idx >= 0 && (!status_text || strcmp(status_text, tjs__http_statuses[idx].text) == 0)) {
+        dbuf_put(dbuf, (const uint8_t *) tjs__http_statuses[idx].line, tjs__http_statuses[idx].len);
+    } else {
+        dbuf_printf(dbuf, "HTTP/1.1 %d %s\r\n", status, status_text ? status_text : "Unknown");
+    }
+}
+
+static int tjs__http_put_header(JSContext *ctx, DynBuf *dbuf, const char *name, size_t name_len, JSValue val) {
+    size_t len;
+    const char *value = JS_ToCStringLen(ctx, &len, val);
+    if (!value) {
+        return -1;
+    }
+
+    if (memchr(value, '\r', len) || memchr(value, '\n', len)) {
+        JS_ThrowTypeError(ctx, "invalid character in header \"%s\"", name);
+        JS_FreeCString(ctx, value);
+        return -1;
+    }
+
+    dbuf_put(dbuf, (const uint8_t *) name, name_len);
+    dbuf_put(dbuf, (const uint8_t *) ": ", 2);
+    dbuf_put(dbuf, (const uint8_t *) value, len);
+    dbuf_put(dbuf, (const uint8_t *) "\r\n", 2);
+
+    JS_FreeCString(ctx, value);
+    return 0;
+}
+
+/*
+ * Serialize the given headers object. Array values are written as one line
+ * each. The headers which affect framing are reported back in info so the
+ * caller can fill in what's missing.
+ */
+int tjs__http_put_headers(JSContext *ctx, DynBuf *dbuf, JSValue headers, TJSHttpHeadInfo *info) {
+    memset(info, 0, sizeof(*info));
+
+    if (!JS_IsObject(headers)) {
+        return 0;
+    }
+
+    JSPropertyEnum *ptab;
+    uint32_t plen;
+    if (JS_GetOwnPropertyNames(ctx, &ptab, &plen, headers, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
+        return -1;
+    }
+
+    int r = 0;
+
+    for (uint32_t i = 0; r == 0 && i < plen; i++) {
+        JSValue val = JS_GetProperty(ctx, headers, ptab[i].atom);
+        if (JS_IsException(val)) {
+            r = -1;
+            break;
+        }
+        if (JS_IsUndefined(val)) {
+            continue;
+        }
+
+        size_t name_len;
+        const char *name = JS_AtomToCString(ctx, ptab[i].atom);
+        if (!name) {
+            JS_FreeValue(ctx, val);
+            r = -1;
+            break;
+        }
+        name_len = strlen(name);
+
+        if (!tjs__http_valid_token(name, name_len)) {
+            JS_ThrowTypeError(ctx, "invalid header name \"%s\"", name);
+            JS_FreeCString(ctx, name);
+            JS_FreeValue(ctx, val);
+            r = -1;
+            break;
+        }
+
+        if (strcasecmp(name, "content-length") == 0) {
+            info->has_content_length = true;
+        } else if (strcasecmp(name, "transfer-encoding") == 0) {
+            size_t len;
+            const char *value = JS_ToCStringLen(ctx, &len, val);
+            if (value && len >= 7 && strcasecmp(value + len - 7, "chunked") == 0) {
+                info->chunked = true;
+            }
+            JS_FreeCString(ctx, value);
+            info->has_transfer_encoding = true;
+        } else if (strcasecmp(name, "date") == 0) {
+            info->has_date = true;
+        } else if (strcasecmp(name, "connection") == 0) {
+            const char *value = JS_ToCString(ctx, val);
+            if (value && strcasecmp(value, "close") == 0) {
+                info->connection_close = true;
+            }
+            JS_FreeCString(ctx, value);
+            info->has_connection = true;
+        }
+
+        if (JS_IsArray(val)) {
+            int64_t len;
+            r = JS_GetLength(ctx, val, &len);
+            for (int64_t j = 0; r == 0 && j < len; j++) {
+                JSValue item = JS_GetPropertyInt64(ctx, val, j);
+                r = JS_IsException(item) ? -1 : tjs__http_put_header(ctx, dbuf, name, name_len, item);
+                JS_FreeValue(ctx, item);
+            }
+        } else {
+            r = tjs__http_put_header(ctx, dbuf, name, name_len, val);
+        }
+
+        JS_FreeCString(ctx, name);
+        JS_FreeValue(ctx, val);
+    }
+
+    JS_FreePropertyEnum(ctx, ptab, plen);
+
+    return r;
+}
+
+static void tjs__http_update_date(TJSRuntime *qrt) {
+    static const char days[7][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char months[12][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    time_t now = time(NULL);
+    struct tm tm;
+
+#if defined(_WIN32)
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+
+    qrt->http_ctx.date_len = snprintf(qrt->http_ctx.date,
+                                      sizeof(qrt->http_ctx.date),
+                                      "Date: %s, %02d %s %d %02d:%02d:%02d GMT\r\n",
+                                      days[tm.tm_wday],
+                                      tm.tm_mday,
+                                      months[tm.tm_mon],
+                                      tm.tm_year + 1900,
+                                      tm.tm_hour,
+                                      tm.tm_min,
+                                      tm.tm_sec);
+}
+
+static void uv__http_date_timer_cb(uv_timer_t *handle) {
+    tjs__http_update_date(handle->data);
+}
+
+/*
+ * Append a "Date: ...\r\n" line. The string is formatted once and refreshed
+ * every second by a timer which doesn't keep the loop alive.
+ */
+void tjs__http_put_date(JSContext *ctx, DynBuf *dbuf) {
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    CHECK_NOT_NULL(qrt);
+
+    if (qrt->http_ctx.date_len == 0) {
+        tjs__http_update_date(qrt);
+
+        uv_timer_t *timer = &qrt->http_ctx.date_timer;
+        CHECK_EQ(uv_timer_init(&qrt->loop, timer), 0);
+        timer->data = qrt;
+        CHECK_EQ(uv_timer_start(timer, uv__http_date_timer_cb, 1000, 1000), 0);
+        uv_unref((uv_handle_t *) timer);
+    }
+
+    dbuf_put(dbuf, (const uint8_t *) qrt->http_ctx.date, qrt->http_ctx.date_len);
+}
+
+
+/* Timing wheel */
+
+#define TJS__HTTP_WHEEL_TICK  250 /* ms */
+#define TJS__HTTP_WHEEL_SLOTS 256 /* must be a power of 2 */
+
+static void tjs__http_timer_link(TJSHttpTimer *head, TJSHttpTimer *t) {
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void tjs__http_timer_unlink(TJSHttpTimer *t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->prev = NULL;
+    t->next = NULL;
+}
+
+static void uv__http_wheel_cb(uv_timer_t *handle) {
+    TJSRuntime *qrt = handle->data;
+    uint64_t tick = ++qrt->http_ctx.wheel.tick;
+    TJSHttpTimer *head = &qrt->http_ctx.wheel.slots[tick & (TJS__HTTP_WHEEL_SLOTS - 1)];
+    TJSHttpTimer expired = { &expired, &expired };
+
+    /* Timers further away than a full turn stay for the next round. Expired
+     * ones are moved out first: their callbacks may stop any other timer. */
+    for (TJSHttpTimer *t = head->next, *next; t != head; t = next) {
+        next = t->next;
+        if (t->expires <= tick) {
+            tjs__http_timer_unlink(t);
+            tjs__http_timer_link(&expired, t);
+        }
+    }
+
+    while (expired.next != &expired) {
+        TJSHttpTimer *t = expired.next;
+        tjs__http_timer_unlink(t);
+        if (--qrt->http_ctx.wheel.count == 0) {
+            uv_timer_stop(handle);
+        }
+        t->cb(t);
+    }
+}
+
+/* Arm (or re-arm) the timer to fire after roughly timeout milliseconds. */
+void tjs__http_timer_start(TJSRuntime *qrt, TJSHttpTimer *t, uint32_t timeout, TJSHttpTimerCb cb) {
+    if (t->next) {
+        tjs__http_timer_unlink(t);
+        qrt->http_ctx.wheel.count--;
+    }
+
+    if (!qrt->http_ctx.wheel.slots) {
+        TJSHttpTimer *slots = tjs__malloc(TJS__HTTP_WHEEL_SLOTS * sizeof(*slots));
+        CHECK_NOT_NULL(slots);
+        for (size_t i = 0; i < TJS__HTTP_WHEEL_SLOTS; i++) {
+            slots[i].prev = slots[i].next = &slots[i];
+        }
+        qrt->http_ctx.wheel.slots = slots;
+
+        uv_timer_t *handle = &qrt->http_ctx.wheel.handle;
+        CHECK_EQ(uv_timer_init(&qrt->loop, handle), 0);
+        handle->data = qrt;
+        uv_unref((uv_handle_t *) handle);
+    }
+
+    /* Round up, a timer never fires early. When the wheel is already running the
+     * next tick can be anywhere up to a full tick away, so it doesn't count. */
+    uint64_t ticks = (timeout + TJS__HTTP_WHEEL_TICK - 1) / TJS__HTTP_WHEEL_TICK;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    if (qrt->http_ctx.wheel.count > 0) {
+        ticks++;
+    }
+    t->expires = qrt->http_ctx.wheel.tick + ticks;
+    t->cb = cb;
+    tjs__http_timer_link(&qrt->http_ctx.wheel.slots[t->expires & (TJS__HTTP_WHEEL_SLOTS - 1)], t);
+
+    if (qrt->http_ctx.wheel.count++ == 0) {
+        uv_timer_t *handle = &qrt->http_ctx.wheel.handle;
+        CHECK_EQ(uv_timer_start(handle, uv__http_wheel_cb, TJS__HTTP_WHEEL_TICK, TJS__HTTP_WHEEL_TICK), 0);
+    }
+}
+
+void tjs__http_timer_stop(TJSRuntime *qrt, TJSHttpTimer *t) {
+    if (!t->next) {
+        return;
+    }
+
+    tjs__http_timer_unlink(t);
+    if (--qrt->http_ctx.wheel.count == 0) {
+        uv_timer_stop(&qrt->http_ctx.wheel.handle);
+    }
+}
+
+void tjs__http_timers_close(TJSRuntime *qrt) {
+    if (qrt->http_ctx.wheel.slots) {
+        uv_close((uv_handle_t *) &qrt->http_ctx.wheel.handle, NULL);
+    }
+}
+
+/* Connections may still stop their timers while the JS runtime goes away,
+ * so the slots are only released after that. */
+void tjs__http_timers_free(TJSRuntime *qrt) {
+    tjs__free(qrt->http_ctx.wheel.slots);
+    qrt->http_ctx.wheel.slots = NULL;
+}
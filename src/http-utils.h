@@ -0,0 +1,82 @@
+/*
+ * txiki.js
+ *
+ * Copyright (c) 2019-present Saúl Ibarra Corretgé <s@saghul.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TJS_HTTP_UTILS_H
+#define TJS_HTTP_UTILS_H
+
+#include "private.h"
+
+/* Slice of a buffer holding HTTP message text. */
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} TJSHttpSpan;
+
+typedef struct {
+    TJSHttpSpan name;
+    TJSHttpSpan value;
+} TJSHttpHeader;
+
+typedef struct {
+    bool has_content_length;
+    bool has_transfer_encoding;
+    bool chunked; /* transfer-encoding ends with chunked */
+    bool has_connection;
+    bool has_date;
+    bool connection_close;
+} TJSHttpHeadInfo;
+
+JSAtom tjs__http_header_atom(JSContext *ctx, const char *name, size_t len);
+JSValue tjs__http_method_string(JSContext *ctx, int method);
+JSValue tjs__http_new_headers(JSContext *ctx, const char *base, const TJSHttpHeader *headers, size_t count);
+void tjs__http_free_atoms(TJSRuntime *qrt);
+
+const char *tjs__http_status_text(int status);
+bool tjs__http_valid_token(const char *s, size_t len);
+bool tjs__http_valid_status_text(const char *s, size_t len);
+void tjs__http_put_status_line(DynBuf *dbuf, int status, const char *status_text);
+int tjs__http_put_headers(JSContext *ctx, DynBuf *dbuf, JSValue headers, TJSHttpHeadInfo *info);
+void tjs__http_put_date(JSContext *ctx, DynBuf *dbuf);
+
+/*
+ * Coarse timers for connection timeouts. All of them share a hashed timing
+ * wheel driven by a single uv_timer_t per loop, so arming, re-arming and
+ * stopping one is O(1) and costs no syscalls.
+ */
+typedef struct TJSHttpTimer TJSHttpTimer;
+typedef void (*TJSHttpTimerCb)(TJSHttpTimer *t);
+
+struct TJSHttpTimer {
+    TJSHttpTimer *prev;
+    TJSHttpTimer *next; /* NULL when not armed */
+    uint64_t expires; /* in wheel ticks */
+    TJSHttpTimerCb cb;
+};
+
+void tjs__http_timer_start(TJSRuntime *qrt, TJSHttpTimer *t, uint32_t timeout, TJSHttpTimerCb cb);
+void tjs__http_timer_stop(TJSRuntime *qrt, TJSHttpTimer *t);
+void tjs__http_timers_close(TJSRuntime *qrt);
+void tjs__http_timers_free(TJSRuntime *qrt);
+
+#endif
@@ -75,6 +75,13 @@ Object.defineProperty(engine, 'gc', {
     }
 });
 
+Object.defineProperty(engine, 'streamPoolStats', {
+    enumerable: true,
+    configurable: false,
+    writable: false,
+    value: () => core.streamPoolStats()
+});
+
 Object.defineProperty(engine, 'versions', {
     enumerable: true,
     configurable: false,
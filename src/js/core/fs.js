@@ -48,6 +48,121 @@ export async function makeTempFile(template) {
     return new Proxy(handle, fhProxyHandler);
 }
 
+export async function mmap(file, options = {}) {
+    const { offset = 0, length, mode = 'r' } = options;
+
+    if (mode !== 'r' && mode !== 'rw') {
+        throw new TypeError('invalid mode');
+    }
+
+    const handle = typeof file === 'string' ? await core.open(file, mode === 'rw' ? 'r+' : 'r') : file;
+
+    try {
+        return core.mmap(handle.fileno(), offset, length, mode === 'rw');
+    } finally {
+        // The mapping outlives the file descriptor.
+        if (handle !== file) {
+            await handle.close();
+        }
+    }
+}
+
+class WalkEntry {
+    constructor(name, type) {
+        this.name = name;
+        this.type = type;
+    }
+
+    get isBlockDevice() {
+        return this.type === core.DIRENT_BLOCK;
+    }
+
+    get isCharacterDevice() {
+        return this.type === core.DIRENT_CHAR;
+    }
+
+    get isDirectory() {
+        return this.type === core.DIRENT_DIR;
+    }
+
+    get isFIFO() {
+        return this.type === core.DIRENT_FIFO;
+    }
+
+    get isFile() {
+        return this.type === core.DIRENT_FILE;
+    }
+
+    get isSocket() {
+        return this.type === core.DIRENT_SOCKET;
+    }
+
+    get isSymbolicLink() {
+        return this.type === core.DIRENT_LINK;
+    }
+}
+
+// Entries come from the thread pool in batches of parallel arrays, they are
+// only turned into objects as they are iterated.
+class DirWalker {
+    constructor(path, walk, batch) {
+        this.path = path;
+        this.walk = walk;
+        this.batch = batch;
+        this.index = 0;
+    }
+
+    async next() {
+        while (this.batch && this.index === this.batch.names.length) {
+            this.batch = await this.walk.next();
+            this.index = 0;
+        }
+
+        if (!this.batch) {
+            return { done: true, value: undefined };
+        }
+
+        const i = this.index++;
+        const { names, types, sizes, mtimes } = this.batch;
+        const entry = new WalkEntry(names[i], types[i]);
+
+        if (sizes) {
+            entry.size = sizes[i];
+            entry.mtime = new Date(mtimes[i]);
+        }
+
+        return { done: false, value: entry };
+    }
+
+    async return() {
+        await this.close();
+
+        return { done: true, value: undefined };
+    }
+
+    async close() {
+        this.batch = null;
+        this.walk.close();
+    }
+
+    [Symbol.asyncIterator]() {
+        return this;
+    }
+}
+
+export async function readDir(path, options) {
+    if (!options?.recursive && !options?.withStats) {
+        return core.readDir(path);
+    }
+
+    const walk = core.walkDir(path, Boolean(options.recursive), Boolean(options.withStats));
+
+    // The first batch is read upfront so a missing directory fails here, like readDir(path) does.
+    const batch = await walk.next();
+
+    return new DirWalker(path, walk, batch);
+}
+
 export async function makeDir(path, options = { mode: 0o777, recursive: false }) {
     if (!options.recursive) {
         return core.mkdir(path, options.mode);
@@ -1,14 +1,58 @@
-// Batch processing for better CPU utilization
-// 减小批处理大小以减少内存峰值(从16减到4)
-const BATCH_SIZE = 4;
-
 /**
- * HTTP Server implementation for txiki.js using TCP sockets and llhttp parser
+ * HTTP Server implementation for txiki.js on top of the native HttpServer handle
  * Following Node.js API style conventions
  */
 
+import pathModule from './path.js';
+
 const core = globalThis[Symbol.for('tjs.internal.core')];
-const { LLHttp, TCP } = core;
+const { HttpServer } = core;
+
+// Bootstrap for the workers started by listen({ workers }). Each one imports
+// the listener module and serves on the same port, the kernel balances
+// connections across them (SO_REUSEPORT).
+const workerSource = `
+self.onmessage = async ({ data }) => {
+    self.onmessage = null;
+
+    try {
+        const mod = await import(data.module);
+        const listener = mod.default ?? mod.onRequest;
+
+        if (typeof listener !== 'function') {
+            throw new TypeError(\`\${data.module} does not export a request listener\`);
+        }
+
+        const server = tjs.createServer(listener);
+
+        server.maxConnections = data.maxConnections;
+        server.maxRequestsPerSocket = data.maxRequestsPerSocket;
+        server.timeout = data.timeout;
+        server.headersTimeout = data.headersTimeout;
+        server.keepAliveTimeout = data.keepAliveTimeout;
+        server.maxBodySize = data.maxBodySize;
+        server.listen({ port: data.port, host: data.host, backlog: data.backlog, reusePort: true });
+        self.postMessage({ type: 'listening' });
+    } catch (err) {
+        self.postMessage({ type: 'error', message: String(err?.stack ?? err) });
+    }
+};
+`;
+
+function resolveModule(module) {
+    if (module instanceof URL) {
+        return module.protocol === 'file:' ? decodeURIComponent(module.pathname) : module.href;
+    }
+
+    module = String(module);
+
+    if (/^(https?:|tjs:)/.test(module)) {
+        return module;
+    }
+
+    // The worker source is not a file, relative paths can't be resolved there.
+    return pathModule.resolve(module);
+}
 
 // Simple event emitter implementation to reduce bundle size
 class TinyEmitter {
@@ -97,204 +141,81 @@ class TinyEmitter {
     }
 }
 
-// Object pools for reuse
-const objectPool = {
-    incomingMessages: [],
-    serverResponses: [],
-    parsers: [],
-
-    getIncomingMessage(socket) {
-        const msg = this.incomingMessages.pop();
-
-        if (msg) {
-            msg.socket = socket;
-            msg.headers = Object.create(null);
-            msg.method = '';
-            msg.url = '';
-            msg.httpVersion = '1.1';
-            msg.httpVersionMajor = 1;
-            msg.httpVersionMinor = 1;
-            msg.complete = false;
-            msg._body = '';
-
-            return msg;
-        }
+// Shared TextEncoder / TextDecoder instances
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
 
-        return new IncomingMessage(socket);
-    },
-
-    releaseIncomingMessage(msg) {
-        // 大幅减小池大小以更积极地控制内存(从32减到8)
-        if (this.incomingMessages.length < 8) {
-            // 清理可能的循环引用
-            if (msg.socket) {
-                // 删除对当前请求的引用
-                if (msg.socket._currentRequest === msg) {
-                    delete msg.socket._currentRequest;
-                }
-                msg.socket = null;
-            }
-            
-            // 清理请求体
-            msg._body = '';
-            
-            // 清理头部信息
-            msg.headers = Object.create(null);
-            
-            // 清理事件监听器
-            try {
-                msg.removeAllListeners();
-            } catch (e) {
-                // 忽略错误
-            }
-            
-            this.incomingMessages.push(msg);
-        } else {
-            // 如果池已满，确保清理所有引用
-            if (msg.socket) {
-                if (msg.socket._currentRequest === msg) {
-                    delete msg.socket._currentRequest;
-                }
-                msg.socket = null;
-            }
-            msg._body = '';
-            msg.headers = Object.create(null);
-            try {
-                msg.removeAllListeners();
-            } catch (e) {
-                // 忽略错误
-            }
-        }
-    },
-
-    getServerResponse(socket) {
-        const res = this.serverResponses.pop();
-
-        if (res) {
-            res.socket = socket;
-            res.headersSent = false;
-            res.finished = false;
-            res.statusCode = 200;
-            res.statusMessage = 'OK';
-            res.headers = Object.create(null);
-            res._bodyChunks.length = 0;
-            res._bodyLength = 0;
-            res._shouldKeepAlive = true;
-
-            return res;
-        }
+// Request bodies are queued up to this many bytes before reading is paused.
+const BODY_HIGH_WATER_MARK = 65536;
+const kBody = Symbol('kBody');
 
-        return new ServerResponse(socket);
-    },
-
-    releaseServerResponse(res) {
-        // 大幅减小池大小以更积极地控制内存(从32减到8)
-        if (this.serverResponses.length < 8) {
-            // 清理可能的循环引用
-            if (res.socket) {
-                // 删除对请求的引用
-                if (res.socket._currentRequest) {
-                    objectPool.releaseIncomingMessage(res.socket._currentRequest);
-                    delete res.socket._currentRequest;
-                }
-                res.socket = null;
-            }
-            
-            // 清理响应体数据
-            res._bodyChunks.length = 0;
-            res._bodyLength = 0;
-            
-            // 清理头部信息
-            res.headers = Object.create(null);
-            
-            // 重置状态
-            res.headersSent = false;
-            res.finished = false;
-            res.statusCode = 200;
-            res.statusMessage = 'OK';
-            res._shouldKeepAlive = true;
-            
-            // 清理事件监听器
-            try {
-                res.removeAllListeners();
-            } catch (e) {
-                // 忽略错误
-            }
-            
-            this.serverResponses.push(res);
-        } else {
-            // 如果池已满，确保清理所有引用
-            if (res.socket) {
-                if (res.socket._currentRequest) {
-                    objectPool.releaseIncomingMessage(res.socket._currentRequest);
-                    delete res.socket._currentRequest;
-                }
-                res.socket = null;
-            }
-            
-            // 清理响应体数据
-            res._bodyChunks.length = 0;
-            res._bodyLength = 0;
-            
-            // 清理头部信息
-            res.headers = Object.create(null);
-            
-            // 重置状态
-            res.headersSent = false;
-            res.finished = false;
-            res.statusCode = 200;
-            res.statusMessage = 'OK';
-            res._shouldKeepAlive = true;
-            
-            // 清理事件监听器
-            try {
-                res.removeAllListeners();
-            } catch (e) {
-                // 忽略错误
-            }
-        }
-    },
+// write() reports backpressure once this many bytes are waiting to be sent.
+const RESPONSE_HIGH_WATER_MARK = 65536;
+const kResponse = Symbol('kResponse');
 
-    getParser() {
-        const parser = this.parsers.pop();
+// Parses a single range Range header against a file of the given size.
+// Returns the range, null to send the whole file (a header we don't handle)
+// or -1 if it can't be satisfied.
+function parseRange(header, size) {
+    const m = /^bytes=(\d*)-(\d*)$/.exec(header.trim());
 
-        if (parser) {
-            try {
-                parser.reset();
-            } catch (e) {
-                // 如果重置失败，创建新的解析器
-                return new LLHttp('request', {
-                    lenient: true,
-                    allowCustomMethods: true,
-                });
-            }
+    if (!m || (m[1] === '' && m[2] === '')) {
+        return null;
+    }
 
-            return parser;
-        }
+    let start, end;
 
-        return new LLHttp('request', {
-            lenient: true,
-            allowCustomMethods: true,
-        });
-    },
+    if (m[1] === '') {
+        start = Math.max(size - Number(m[2]), 0);
+        end = size - 1;
+    } else {
+        start = Number(m[1]);
+        end = m[2] === '' ? size - 1 : Math.min(Number(m[2]), size - 1);
+    }
 
-    releaseParser(parser) {
-        // 大幅减小池大小以更积极地控制内存(从16减到4)
-        if (this.parsers.length < 4) {
-            try {
-                parser.reset();
-                this.parsers.push(parser);
-            } catch (e) {
-                // 如果重置失败，不将解析器放回池中
-                // 这样会在下次需要时创建新的解析器
-            }
-        }
-    },
-};
+    if (start >= size || start > end) {
+        return -1;
+    }
 
-// Shared TextEncoder/Decoder instances
-const textEncoder = new TextEncoder();
-const textDecoder = new TextDecoder();
+    return { start, end };
+}
+
+// Whether the client's copy, as described by the conditional headers, is current.
+function isNotModified(headers, etag, mtime) {
+    const inm = headers['if-none-match'];
+
+    if (inm !== undefined) {
+        const tag = etag.replace(/^W\//, '');
+
+        return inm.trim() === '*' || inm.split(',').some(t => t.trim().replace(/^W\//, '') === tag);
+    }
+
+    const ims = Date.parse(headers['if-modified-since']);
+
+    // Last-Modified has a resolution of seconds.
+    return !Number.isNaN(ims) && Math.floor(mtime / 1000) * 1000 <= ims;
+}
+
+// Request bodies arrive in chunks from the native side (see Server._handleBody),
+// reading stops while the queue is full and resumes when it's pulled from.
+function createBodyStream(conn, req) {
+    return new ReadableStream({
+        start(controller) {
+            conn[kBody] = { controller, req };
+        },
+        pull() {
+            conn.resume();
+        },
+        cancel() {
+            // The rest of the body is still read, and dropped.
+            delete conn[kBody];
+            conn.resume();
+        },
+    }, {
+        highWaterMark: BODY_HIGH_WATER_MARK,
+        size: chunk => chunk.byteLength,
+    });
+}
 
 // Status code to message mapping
 export const STATUS_CODES = {
@@ -394,13 +315,53 @@ export class IncomingMessage extends TinyEmitter {
         this.httpVersionMajor = 1;
         this.httpVersionMinor = 1;
         this.complete = false;
-        this._body = '';
+        this.body = null; // ReadableStream of Uint8Array chunks, if there is a body
     }
 
     get connection() {
         return this.socket;
     }
 
+    async arrayBuffer() {
+        const chunks = [];
+        let length = 0;
+
+        if (this.body) {
+            const reader = this.body.getReader();
+
+            while (true) {
+                const { done, value } = await reader.read();
+
+                if (done) {
+                    break;
+                }
+
+                chunks.push(value);
+                length += value.byteLength;
+            }
+        }
+
+        if (chunks.length === 1) {
+            const [ chunk ] = chunks;
+
+            return chunk.buffer.slice(chunk.byteOffset, chunk.byteOffset + chunk.byteLength);
+        }
+
+        const buf = new Uint8Array(length);
+        let offset = 0;
+
+        for (const chunk of chunks) {
+            buf.set(chunk, offset);
+            offset += chunk.byteLength;
+        }
+
+        return buf.buffer;
+    }
+
+    async text() {
+        return textDecoder.decode(await this.arrayBuffer());
+    }
+
     get statusCode() {
     // For requests, this doesn't apply, but keeping for compatibility
         return undefined;
@@ -423,17 +384,21 @@ export class IncomingMessage extends TinyEmitter {
  * This is similar to Node.js's http.ServerResponse.
  */
 export class ServerResponse extends TinyEmitter {
-    constructor(socket) {
+    constructor(socket, req) {
         super();
         this.socket = socket;
+        this.req = req;
         this.headersSent = false;
         this.finished = false;
         this.statusCode = 200;
         this.statusMessage = STATUS_CODES[200];
         this.headers = Object.create(null);
+        this.sendDate = true;
         this._bodyChunks = [];
         this._bodyLength = 0;
-        this._shouldKeepAlive = true;
+        this._streaming = false;
+        this._flushScheduled = false;
+        this._needDrain = false;
     }
 
     setHeader(name, value) {
@@ -520,14 +485,36 @@ export class ServerResponse extends TinyEmitter {
             throw new TypeError('Chunk must be a string or Uint8Array');
         }
 
+        this.headersSent = true;
         this._bodyChunks.push(buffer);
         this._bodyLength += buffer.length;
 
+        // Writes made in the same tick go out together. If end() comes first
+        // the whole response is sent at once, with a Content-Length.
+        if (!this._flushScheduled) {
+            this._flushScheduled = true;
+            queueMicrotask(() => this._flush());
+        }
+
         if (callback) {
             queueMicrotask(callback);
         }
 
-        return true;
+        const ok = this._bodyLength + this.socket.writeQueueSize < RESPONSE_HIGH_WATER_MARK;
+
+        if (!ok) {
+            this._needDrain = true;
+        }
+
+        return ok;
+    }
+
+    flushHeaders() {
+        this.headersSent = true;
+
+        if (!this._streaming && !this.finished) {
+            this._stream(false);
+        }
     }
 
     end(data, encoding, callback) {
@@ -555,7 +542,11 @@ export class ServerResponse extends TinyEmitter {
         this.finished = true;
 
         // Send the response
-        this._sendResponse();
+        if (this._streaming) {
+            this._stream(true);
+        } else {
+            this._sendResponse();
+        }
 
         if (callback) {
             queueMicrotask(callback);
@@ -566,183 +557,178 @@ export class ServerResponse extends TinyEmitter {
         return this;
     }
 
-    _sendResponse() {
-    // Ensure headers are sent
-        if (!this.headersSent) {
-            // Set Content-Length if not already set and we have a body
-            if (
-                !this.headers['Content-Length'] &&
-        !this.headers['content-length'] &&
-        this._bodyLength > 0
-            ) {
-                this.setHeader('Content-Length', this._bodyLength);
-            }
+    _flush() {
+        this._flushScheduled = false;
 
-            // 根据HTTP版本和Connection头部正确设置Connection头部
-            if (this.socket._currentRequest) {
-                const req = this.socket._currentRequest;
-                const requestHttpVersion = `${req.httpVersionMajor}.${req.httpVersionMinor}`;
-                const connectionHeader = (
-                    req.headers['Connection'] ||
-          req.headers['connection'] ||
-          ''
-                ).toLowerCase();
-
-                // 正确实现HTTP/1.1的keep-alive机制
-                if (requestHttpVersion === '1.1') {
-                    // HTTP/1.1默认保持连接，除非明确指定Connection: close
-                    this._shouldKeepAlive = connectionHeader !== 'close';
-                } else if (requestHttpVersion === '1.0') {
-                    // HTTP/1.0默认关闭连接，除非明确指定Connection: keep-alive
-                    this._shouldKeepAlive = connectionHeader === 'keep-alive';
-
-                    if (this._shouldKeepAlive) {
-                        this.setHeader('Connection', 'keep-alive');
-                    }
-                } else {
-                    // 其他版本默认不保持连接
-                    this._shouldKeepAlive = false;
-                }
+        // Unless end() sent everything already.
+        if (!this.finished) {
+            this._stream(false);
+        }
+    }
+
+    // Streams the body: the head goes out with the first chunks and, unless
+    // the headers frame the body, Transfer-Encoding: chunked is used.
+    _stream(end) {
+        const socket = this.socket;
+        let ok = false;
+
+        try {
+            if (!this._streaming) {
+                const statusMessage = this.statusMessage === STATUS_CODES[this.statusCode] ?
+                    undefined : this.statusMessage;
+
+                this._streaming = true;
+                socket[kResponse] = this;
+                socket.writeHead(this.statusCode, statusMessage, this.headers, this.sendDate);
             }
 
-            // 如果不保持连接，设置Connection: close头部
-            if (!this._shouldKeepAlive) {
-                this.setHeader('Connection', 'close');
+            ok = end ? socket.end(this._bodyChunks) : socket.write(this._bodyChunks);
+        } catch (err) {
+            console.error('Failed to send response:', err);
+
+            try {
+                socket.close();
+            } catch (closeErr) {
+                // Ignore close errors
             }
+        }
 
-            this.headersSent = true;
+        this._bodyChunks.length = 0;
+        this._bodyLength = 0;
+
+        if (end) {
+            delete socket[kResponse];
+            this.emit('close');
+        } else if (ok) {
+            this._onDrain();
+        }
+    }
+
+    // Sends a file, copied to the socket by the kernel (sendfile) rather than
+    // read into JS. ETag and Last-Modified come from the file's stat, and the
+    // request's If-None-Match / If-Modified-Since (304) and Range / If-Range
+    // (206, 416) headers are honored unless options.range is false. Resolves
+    // to false if the connection went away before the whole file was sent,
+    // rejects with nothing sent if the file can't be opened.
+    async sendFile(path, options = {}) {
+        if (this.headersSent) {
+            throw new Error('Headers already sent');
         }
 
+        const fh = await core.open(path, 'r');
+
         try {
-            // Efficiently concatenate body chunks
-            let body;
-
-            if (this._bodyChunks.length === 0) {
-                body = new Uint8Array(0);
-            } else if (this._bodyChunks.length === 1) {
-                body = this._bodyChunks[0];
-            } else {
-                body = new Uint8Array(this._bodyLength);
-                let offset = 0;
-
-                for (const chunk of this._bodyChunks) {
-                    body.set(chunk, offset);
-                    offset += chunk.length;
-                }
+            const st = await fh.stat();
+
+            if (!st.isFile) {
+                throw new Error(`Not a file: ${path}`);
             }
 
-            // Create HTTP response manually to ensure proper format
-            let response = `HTTP/1.1 ${this.statusCode} ${this.statusMessage}\r\n`;
+            return await this._sendFile(fh, st, options);
+        } finally {
+            await fh.close();
+        }
+    }
 
-            // Add headers
-            for (const [ name, value ] of Object.entries(this.headers)) {
-                response += `${name}: ${value}\r\n`;
-            }
+    async _sendFile(fh, st, options) {
+        const headers = this.req?.headers ?? {};
+        const mtime = st.mtim.getTime();
+        const etag = `W/"${st.size.toString(16)}-${Math.floor(mtime).toString(16)}"`;
+        const lastModified = st.mtim.toUTCString();
+        let start = 0;
+        let length = st.size;
 
-            // End of headers
-            response += '\r\n';
+        if (!this.hasHeader('ETag')) {
+            this.setHeader('ETag', etag);
+        }
 
-            // Add body if present
-            if (body.length > 0) {
-                // Directly concatenate Uint8Array instead of converting to string
-                const headersBytes = textEncoder.encode(response);
-                const responseBytes = new Uint8Array(headersBytes.length + body.length);
+        if (!this.hasHeader('Last-Modified')) {
+            this.setHeader('Last-Modified', lastModified);
+        }
 
-                responseBytes.set(headersBytes, 0);
-                responseBytes.set(body, headersBytes.length);
+        this.removeHeader('Content-Length');
 
-                // 使用单独的方法处理写入和连接状态
-                this._writeAndHandleConnection(responseBytes);
+        if (isNotModified(headers, this.getHeader('ETag'), mtime)) {
+            this.writeHead(304);
+            this.end();
 
-                return;
-            }
+            return true;
+        }
 
-            const encoded = textEncoder.encode(response);
+        if (options.range !== false) {
+            this.setHeader('Accept-Ranges', 'bytes');
 
-            // 使用单独的方法处理写入和连接状态
-            this._writeAndHandleConnection(encoded);
-        } catch (err) {
-            // Release resources
-            this._cleanup();
+            const ifRange = headers['if-range'];
+            const fresh = ifRange === undefined || ifRange === this.getHeader('ETag') || ifRange === lastModified;
+            const range = headers.range && fresh ? parseRange(headers.range, st.size) : null;
 
-            console.error('Failed to create response:', err);
+            if (range === -1) {
+                this.writeHead(416, { 'Content-Range': `bytes */${st.size}` });
+                this.end();
 
-            try {
-                this.socket.close();
-            } catch (closeErr) {
-                // Ignore close errors
+                return true;
+            }
+
+            if (range) {
+                this.writeHead(206, { 'Content-Range': `bytes ${range.start}-${range.end}/${st.size}` });
+                start = range.start;
+                length = range.end - range.start + 1;
             }
         }
-    }
 
-    /**
-   * 处理响应写入和连接状态管理
-   * @param {Uint8Array} data - 要写入的数据
-   */
-    _writeAndHandleConnection(data) {
-    // 使用Promise链而不是async/await来提高性能
-        this.socket
-            .write(data)
-            .then(() => {
-                // Release resources
-                this._cleanup();
-
-                // 根据_keepAlive状态决定是否关闭连接
-                if (!this._shouldKeepAlive) {
-                    try {
-                        this.socket.close();
-                    } catch (err) {
-                        // Ignore close errors
-                    }
-                }
+        const statusMessage = this.statusMessage === STATUS_CODES[this.statusCode] ? undefined : this.statusMessage;
 
-                this.emit('close');
-            })
-            .catch(err => {
-                // Release resources
-                this._cleanup();
+        this.headersSent = true;
+        this.finished = true;
 
-                // Ignore common socket errors
-                if (!this._isCommonSocketError(err)) {
-                    console.error('Failed to write response:', err);
-                }
+        let ok = false;
 
-                try {
-                    this.socket.close();
-                } catch (closeErr) {
-                    // Ignore close errors
-                }
-            });
+        try {
+            ok = await this.socket.sendFile(this.statusCode, statusMessage, this.headers, this.sendDate,
+                fh.fileno(), start, length);
+        } catch (err) {
+            console.error('Failed to send response:', err);
+            this.socket.close();
+        }
+
+        this.emit('finish');
+        this.emit('close');
+
+        return ok;
     }
 
-    _cleanup() {
-        // Clear body chunks to free memory
-        this._bodyChunks.length = 0;
-        this._bodyLength = 0;
+    _onDrain() {
+        if (this._needDrain) {
+            this._needDrain = false;
+            this.emit('drain');
+        }
+    }
+
+    _sendResponse() {
+        this.headersSent = true;
 
-        // Clear socket reference if it exists to prevent memory leaks
-        if (this.socket) {
-            // Remove the reference from socket to this response
-            if (this.socket._currentRequest === this) {
-                objectPool.releaseIncomingMessage(this.socket._currentRequest);
-                delete this.socket._currentRequest;
+        // The native connection serializes the head (adding Content-Length,
+        // Connection and Date as needed) and writes it together with the body
+        // chunks in a single vectored write, without concatenating them here.
+        // The standard status text comes from a precomputed status line.
+        const statusMessage = this.statusMessage === STATUS_CODES[this.statusCode] ? undefined : this.statusMessage;
+
+        try {
+            this.socket.send(this.statusCode, statusMessage, this.headers, this._bodyChunks, this.sendDate);
+        } catch (err) {
+            console.error('Failed to send response:', err);
+
+            try {
+                this.socket.close();
+            } catch (closeErr) {
+                // Ignore close errors
             }
-            this.socket = null;
         }
 
-        // Release response object back to pool
-        objectPool.releaseServerResponse(this);
-    }
-
-    _isCommonSocketError(err) {
-        const msg = err.message || '';
+        this._bodyChunks.length = 0;
+        this._bodyLength = 0;
 
-        return (
-            msg.includes('ECONNRESET') ||
-      msg.includes('EPIPE') ||
-      msg.includes('ECONNABORTED') ||
-      msg.includes('EINVAL')
-        );
+        this.emit('close');
     }
 
     removeAllListeners() {
@@ -759,84 +745,54 @@ export class ServerResponse extends TinyEmitter {
 
 /**
  * HTTP Server implementation
+ *
+ * Connections are accepted, parsed and answered by the native HttpServer
+ * handle, JS sees one call per request and then its body, if any, in chunks.
  */
 export class Server extends TinyEmitter {
     constructor(requestListener, options = {}) {
         super();
         this._requestListener = requestListener;
-        this._connections = new Set();
         this._listening = false;
-        this._server = null;
+        this._handle = null;
         this._debug = !!options.debug;
         this._closed = false;
         this._maxConnections = options.maxConnections || 0; // 0 means no limit
-        this._timeout = options.timeout || 120000; // 2 minutes default
-        this._connectionsCount = 0;
-        this._requestBatch = [];
-        this._processingBatch = false;
+        this._maxRequestsPerSocket = options.maxRequestsPerSocket || 0; // 0 means no limit
+        // Enforced natively, 0 disables a timeout.
+        this._timeout = options.timeout ?? 120000; // idle time while reading a request body
+        this._headersTimeout = options.headersTimeout ?? 60000; // to receive the request headers
+        this._keepAliveTimeout = options.keepAliveTimeout ?? 5000; // between requests
+        this._maxBodySize = options.maxBodySize || 0; // 0 means no limit, larger bodies get a 413
+        this._workers = [];
         // Make STATUS_CODES available on the server instance
         this.STATUS_CODES = STATUS_CODES;
-        
-        // 添加基于连接数的内存管理相关属性
-        this._connectionLimit = options.connectionLimit || 100; // 连接数限制，默认100
-        this._connectionsList = []; // 用于跟踪连接的顺序
-        this._disconnectCount = options.disconnectCount || 5; // 每次断开连接的数量，默认5个
     }
-    
-    // 断开最旧的连接以控制连接数
-    _disconnectOldestConnections(count = this._disconnectCount) {
-        // 当连接数超过限制时，断开最旧的连接
-        const toRemove = Math.min(count, this._connectionsList.length - this._connectionLimit);
-        for (let i = 0; i < toRemove; i++) {
-            const oldestConnection = this._connectionsList.shift();
-            if (oldestConnection && !oldestConnection._closed) {
-                try {
-                    // 清理连接上的引用
-                    if (oldestConnection._currentRequest) {
-                        objectPool.releaseIncomingMessage(oldestConnection._currentRequest);
-                        delete oldestConnection._currentRequest;
-                    }
-                    if (oldestConnection._server) {
-                        delete oldestConnection._server;
-                    }
-                    oldestConnection.close();
-                    this._connections.delete(oldestConnection);
-                    this._connectionsCount = Math.max(0, this._connectionsCount - 1);
-                } catch (err) {
-                    // 忽略关闭连接时的错误
-                }
-            }
-        }
-    }
-    
-    // 修改主动垃圾回收方法，基于连接数阈值触发
-    _performGC() {
-        const now = Date.now();
-        // 检查是否达到连接数阈值并且距离上次GC有一定时间间隔
-        if (this._connectionsCount >= this._gcConnectionThreshold && 
-            now - this._lastGCTime > this._gcInterval) {
-            // 强制垃圾回收
-            if (typeof gc !== 'undefined') {
-                gc();
-            }
-            
-            // 更新上次GC时间
-            this._lastGCTime = now;
-        }
-    }
-    
-    // 清理空闲连接
-    _cleanupIdleConnections() {
-        // 在这个实现中，我们主要依靠定期检查和强制关闭
-        // 实际应用中可以跟踪连接活跃时间并关闭长期空闲的连接
-    }
-    
-    // 重写listen方法，添加连接数限制
+
+    /**
+     * listen(port, hostname, backlog, callback) or listen(options, callback).
+     *
+     * With options.reusePort the port is bound with SO_REUSEPORT. With
+     * options.workers = N, N Worker runtimes are started as well, each one
+     * importing options.module (which must export the request listener) and
+     * listening on the same port, so connections are spread across cores.
+     * This server keeps serving with its own listener too.
+     */
     listen(port, hostname, backlog, callback) {
         if (this._closed) {
             throw new Error('Server has been closed');
         }
 
+        let options = {};
+
+        if (typeof port === 'object' && port !== null) {
+            options = port;
+            callback = hostname;
+            port = options.port;
+            hostname = options.host;
+            backlog = options.backlog;
+        }
+
         if (typeof hostname === 'function') {
             callback = hostname;
             hostname = undefined;
@@ -848,85 +804,46 @@ export class Server extends TinyEmitter {
         hostname = hostname || '0.0.0.0';
         port = port || 0;
 
-        // Create TCP server
-        this._server = new TCP();
-
-        // Bind to address
-        this._server.bind({ ip: hostname, port });
+        const workers = options.workers | 0;
+        let flags = 0;
 
-        // Listen for connections
-        this._server.listen(backlog || 511);
-
-        // Handle incoming connections
-        const handleConnection = async () => {
-            try {
-                // eslint-disable-next-line no-constant-condition
-                while (!this._closed) {
-                    try {
-                        const clientHandle = await this._server.accept();
-
-                        if (!clientHandle || this._closed) {
-                            break;
-                        }
-
-                        // 检查连接数限制
-                        if (this._maxConnections > 0 && this._connectionsCount >= this._maxConnections) {
-                            // 如果达到最大连接数限制，直接关闭新连接
-                            clientHandle.close();
-                            continue;
-                        }
-
-                        this._connections.add(clientHandle);
-                        this._connectionsCount++;
-                        
-                        // 添加连接到连接列表，用于跟踪连接顺序
-                        this._connectionsList.push(clientHandle);
-
-                        // 当连接数超过限制时，断开最旧的连接
-                        // 使用配置的断开连接数
-                        if (this._connectionsList.length > this._connectionLimit) {
-                            this._disconnectOldestConnections();
-                        }
-
-                        // Set connection timeout
-                        if (this._timeout > 0) {
-                            clientHandle.setKeepAlive(true, 1000);
-                            clientHandle.setNoDelay(true);
-                        }
-
-                        // Handle HTTP requests on this connection
-                        this._handleConnection(clientHandle);
-                    } catch (err) {
-                        if (this._closed) {
-                            break;
-                        }
-
-                        // Ignore common connection errors but log others
-                        if (!this._isCommonConnectionError(err)) {
-                            console.error('Connection error:', err);
-                        }
-
-                        // Break loop on certain errors
-                        if (
-                            err.name === 'AbortError' ||
-                            (err.message && err.message.includes('closed'))
-                        ) {
-                            break;
-                        }
-                    }
-                }
-            } catch (err) {
-                if (!this._closed) {
-                    console.error('Server fatal error:', err);
-                    this.close();
-                }
+        if (options.reusePort || workers > 0) {
+            if (core.TCP_REUSEPORT === undefined) {
+                throw new Error('reusePort is not supported');
             }
-        };
 
-        // Start accepting connections
-        handleConnection();
+            flags |= core.TCP_REUSEPORT;
+        }
 
+        if (workers > 0 && !options.module) {
+            throw new TypeError('The workers option requires a module exporting the request listener');
+        }
+
+        const handle = new HttpServer(
+            incoming => this._handleRequest(incoming),
+            (conn, chunk) => this._handleBody(conn, chunk),
+            conn => conn[kResponse]?._onDrain());
+
+        handle.maxConnections = this._maxConnections;
+        handle.maxRequestsPerSocket = this._maxRequestsPerSocket;
+        handle.timeout = this._timeout;
+        handle.headersTimeout = this._headersTimeout;
+        handle.keepAliveTimeout = this._keepAliveTimeout;
+        handle.maxBodySize = this._maxBodySize;
+        handle.bind({ ip: hostname, port }, flags);
+        handle.listen(backlog || 511);
+
+        this._handle = handle;
         this._listening = true;
+
+        if (workers > 0) {
+            // Bind first so the workers share the actual port, even when 0 was given.
+            this._startWorkers(workers, resolveModule(options.module), {
+                host: hostname,
+                port: handle.getsockname().port,
+                backlog: backlog || 511,
+            });
+        }
         this.emit('listening');
 
         if (callback) {
@@ -948,389 +865,132 @@ export class Server extends TinyEmitter {
         this._listening = false;
         this._closed = true;
 
-        // Close all connections with a timeout to prevent hanging
-        const connectionsToClose = Array.from(this._connections);
-        const closePromises = [];
+        // Stops accepting and closes all open connections.
+        this._handle.close();
 
-        for (const connection of connectionsToClose) {
-            try {
-                // Create a promise for each connection close
-                const closePromise = new Promise((resolve) => {
-                    // 设置1秒超时强制关闭连接
-                    const timeout = setTimeout(() => {
-                        try {
-                            connection.close();
-                        } catch (err) {
-                            // Ignore errors when closing
-                        } finally {
-                            // 清理连接上的引用
-                            if (connection._currentRequest) {
-                                objectPool.releaseIncomingMessage(connection._currentRequest);
-                                delete connection._currentRequest;
-                            }
-                            if (connection._server) {
-                                delete connection._server;
-                            }
-                            resolve();
-                        }
-                    }, 1000);
-
-                    // 正常关闭连接
-                    try {
-                        // 清理连接上的引用
-                        if (connection._currentRequest) {
-                            objectPool.releaseIncomingMessage(connection._currentRequest);
-                            delete connection._currentRequest;
-                        }
-                        if (connection._server) {
-                            delete connection._server;
-                        }
-                        connection.close();
-                        clearTimeout(timeout);
-                        resolve();
-                    } catch (err) {
-                        clearTimeout(timeout);
-                        // 清理连接上的引用
-                        if (connection._currentRequest) {
-                            objectPool.releaseIncomingMessage(connection._currentRequest);
-                            delete connection._currentRequest;
-                        }
-                        if (connection._server) {
-                            delete connection._server;
-                        }
-                        resolve();
-                    }
-                });
-
-                closePromises.push(closePromise);
-            } catch (err) {
-                // 即使出现错误也要确保清理引用
-                if (connection._currentRequest) {
-                    objectPool.releaseIncomingMessage(connection._currentRequest);
-                    delete connection._currentRequest;
-                }
-                if (connection._server) {
-                    delete connection._server;
-                }
-            }
+        for (const worker of this._workers) {
+            worker.terminate();
         }
 
-        // Clear connections set immediately
-        this._connections.clear();
-        this._connectionsCount = 0;
-        // Clear connections list
-        this._connectionsList.length = 0;
-
-        // Wait for all connections to close
-        Promise.all(closePromises).then(() => {
-            // Close the server
-            if (this._server) {
-                this._server.close(() => {
-                    this.emit('close');
-
-                    if (callback) {
-                        callback();
-                    }
-                });
-            } else if (callback) {
-                queueMicrotask(callback);
+        this._workers.length = 0;
+
+        queueMicrotask(() => {
+            this.emit('close');
+
+            if (callback) {
+                callback();
             }
         });
 
         return this;
     }
 
-    _handleConnection(handle) {
-        let buffer = '';
-        let parser = objectPool.getParser();
-        let connectionClosed = false;
-        let requestCount = 0;
-        // 进一步降低每个连接的最大请求数，从100降到20
-        const maxRequestsPerConnection = 20;
-        let lastActivityTime = Date.now();
-        const connectionTimeout = this._timeout;
-
-        // Store server reference on socket for cleanup access
-        handle._server = this;
-
-        // Create a simple read loop
-        const readLoop = async () => {
-            try {
-                const buf = new Uint8Array(65536);
-
-                // eslint-disable-next-line no-constant-condition
-                while (!connectionClosed) {
-                    // 检查连接是否超时
-                    if (connectionTimeout > 0 && Date.now() - lastActivityTime > connectionTimeout) {
-                        connectionClosed = true;
-                        break;
-                    }
-                    
-                    // 执行基于连接数的垃圾回收检查
-                    this._performGC();
-
-                    try {
-                        const nread = await handle.read(buf);
-
-                        if (nread === null) {
-                            // Connection closed
-                            connectionClosed = true;
-                            break;
-                        }
-
-                        // 更新活动时间
-                        lastActivityTime = Date.now();
-
-                        // Convert chunk to string and add to buffer
-                        const chunk = textDecoder.decode(buf.subarray(0, nread), { stream: true });
-
-                        buffer += chunk;
-
-                        // Process as much as possible
-                        while (buffer.length > 0 && !connectionClosed) {
-                            try {
-                                const processed = parser.execute(buffer);
-
-                                // If we processed some data, remove it from buffer
-                                if (processed > 0) {
-                                    buffer = buffer.substring(processed);
-                                }
-
-                                // Check if we have a complete message
-                                const result = parser.getResult();
-
-                                if (result.complete) {
-                                    // 限制每个连接的请求数量
-                                    if (++requestCount > maxRequestsPerConnection) {
-                                        connectionClosed = true;
-                                        break;
-                                    }
-                                    
-                                    // Create request and response objects from pool
-                                    const currentRequest = objectPool.getIncomingMessage(handle);
-
-                                    currentRequest.headers = result.headers;
-                                    currentRequest.method = result.method;
-                                    currentRequest.url = result.url;
-                                    currentRequest.httpVersion = `${result.httpMajor}.${result.httpMinor}`;
-                                    currentRequest.httpVersionMajor = result.httpMajor;
-                                    currentRequest.httpVersionMinor = result.httpMinor;
-                                    currentRequest._body = result.body;
-
-                                    // Store current request on handle for response usage
-                                    handle._currentRequest = currentRequest;
-
-                                    const currentResponse = objectPool.getServerResponse(handle);
-
-                                    // 根据HTTP RFC正确确定是否应该保持连接
-                                    const connectionHeader = (
-                                        result.headers['Connection'] ||
-                    result.headers['connection'] ||
-                    ''
-                                    ).toLowerCase();
-
-                                    // 正确实现HTTP/1.1的keep-alive机制
-                                    // HTTP/1.1默认保持连接，除非明确指定Connection: close
-                                    // HTTP/1.0默认关闭连接，除非明确指定Connection: keep-alive
-                                    if (result.httpMajor === 1 && result.httpMinor === 1) {
-                                        // HTTP/1.1
-                                        currentResponse._shouldKeepAlive =
-                      connectionHeader !== 'close';
-                                    } else if (result.httpMajor === 1 && result.httpMinor === 0) {
-                                        // HTTP/1.0
-                                        currentResponse._shouldKeepAlive =
-                      connectionHeader === 'keep-alive';
-                                    } else {
-                                        // 其他版本默认不保持连接
-                                        currentResponse._shouldKeepAlive = false;
-                                    }
-
-                                    // Batch process requests for better CPU utilization
-                                    this._requestBatch.push({
-                                        req: currentRequest,
-                                        res: currentResponse,
-                                    });
-
-                                    if (
-                                        this._requestBatch.length >= BATCH_SIZE ||
-                    !currentResponse._shouldKeepAlive
-                                    ) {
-                                        this._processBatch();
-                                    } else if (!this._processingBatch) {
-                                        this._processingBatch = true;
-                                        queueMicrotask(() => {
-                                            this._processBatch();
-                                        });
-                                    }
-
-                                    // Reset parser for next request if connection is kept alive
-                                    if (currentResponse._shouldKeepAlive) {
-                                        // Reset parser for the next request
-                                        try {
-                                            parser.reset();
-                                        } catch (resetErr) {
-                                            // If reset fails, we need to get a new parser
-                                            objectPool.releaseParser(parser);
-                                            // Create a new parser for the next request
-                                            parser = objectPool.getParser();
-                                        }
-
-                                        // Continue listening for more requests on this connection
-                                    } else {
-                                        // If we shouldn't keep the connection alive, close after this request
-                                        connectionClosed = true;
-                                        break;
-                                    }
-                                } else {
-                                    // No complete message yet, break inner loop to read more data
-                                    break;
-                                }
-                            } catch (err) {
-                                // Handle parse errors
-                                if (this._debug) {
-                                    const shouldLog =
-                    !err.message.includes('HPE_INVALID_METHOD') &&
-                    !err.message.includes('HPE_INVALID_VERSION');
-
-                                    if (shouldLog) {
-                                        console.error(
-                                            'HTTP parse error:',
-                                            err,
-                                            '\nBuffer:',
-                                            buffer
-                                        );
-                                    }
-                                }
-
-                                connectionClosed = true;
-                                handle.close();
-                                this._connections.delete(handle);
-                                this._connectionsCount = Math.max(
-                                    0,
-                                    this._connectionsCount - 1
-                                );
-                                // 从连接列表中移除
-                                const index = this._connectionsList.indexOf(handle);
-                                if (index !== -1) {
-                                    this._connectionsList.splice(index, 1);
-                                }
-
-                                return;
-                            }
-                        }
-                    } catch (err) {
-                        // Ignore common socket errors
-                        if (!this._isCommonSocketError(err)) {
-                            console.error('Socket error:', err);
-                        }
-
-                        connectionClosed = true;
-                        break;
-                    }
-                }
-            } catch (err) {
-                if (this._debug) {
-                    console.error('Connection handler error:', err);
-                }
-            } finally {
-                try {
-                    if (!connectionClosed) {
-                        handle.close();
-                    }
-                } catch (err) {
-                    // Ignore close errors
-                }
+    _startWorkers(count, module, addr) {
+        const url = URL.createObjectURL(new Blob([ workerSource ], { type: 'text/javascript' }));
 
-                // 清理所有相关资源
-                this._connections.delete(handle);
-                this._connectionsCount = Math.max(0, this._connectionsCount - 1);
+        try {
+            for (let i = 0; i < count; i++) {
+                const worker = new Worker(url);
 
-                // 从连接列表中移除
-                const index = this._connectionsList.indexOf(handle);
-                if (index !== -1) {
-                    this._connectionsList.splice(index, 1);
-                }
-                
-                // 确保释放解析器
-                objectPool.releaseParser(parser);
-                
-                // 确保释放当前请求对象
-                if (handle._currentRequest) {
-                    objectPool.releaseIncomingMessage(handle._currentRequest);
-                    delete handle._currentRequest;
-                }
-                
-                // 清理服务器引用
-                if (handle._server) {
-                    delete handle._server;
-                }
+                worker.onmessage = ({ data }) => {
+                    if (data.type === 'error') {
+                        this.emit('error', new Error(`HTTP worker failed: ${data.message}`));
+                    }
+                };
+
+                worker.postMessage({
+                    module,
+                    ...addr,
+                    maxConnections: this._maxConnections,
+                    maxRequestsPerSocket: this._maxRequestsPerSocket,
+                    timeout: this._timeout,
+                    headersTimeout: this._headersTimeout,
+                    keepAliveTimeout: this._keepAliveTimeout,
+                    maxBodySize: this._maxBodySize,
+                });
+
+                this._workers.push(worker);
             }
-        };
+        } finally {
+            // Workers read the blob synchronously when created.
+            URL.revokeObjectURL(url);
+        }
+    }
 
-        // Start the read loop
-        readLoop();
+    get workers() {
+        return this._workers.length;
     }
 
-    _processBatch() {
-        this._processingBatch = false;
-        const batch = this._requestBatch.splice(0, BATCH_SIZE);
+    _handleRequest(incoming) {
+        const conn = incoming.connection;
+        const req = new IncomingMessage(conn);
 
-        for (const { req, res } of batch) {
-            try {
-                // Emit the request event
-                this.emit('request', req, res);
+        req.method = incoming.method;
+        req.url = incoming.url;
+        req.headers = incoming.headers;
+        req.httpVersionMajor = incoming.httpVersionMajor;
+        req.httpVersionMinor = incoming.httpVersionMinor;
+        req.httpVersion = `${incoming.httpVersionMajor}.${incoming.httpVersionMinor}`;
+        req.complete = !incoming.hasBody;
 
-                // Call the request listener if provided
-                if (this._requestListener) {
-                    this._requestListener(req, res);
-                }
-            } catch (err) {
-                // Ignore errors in request handlers but log them
-                if (this._debug) {
-                    console.error('Request handler error:', err);
-                }
+        if (incoming.hasBody) {
+            req.body = createBodyStream(conn, req);
+        }
 
-                // 出错时确保响应被发送
-                try {
-                    if (!res.headersSent) {
-                        res.statusCode = 500;
-                        res.statusMessage = 'Internal Server Error';
-                        res.setHeader('Content-Type', 'text/plain');
-                        res.end('Internal Server Error');
-                    }
-                } catch (resErr) {
-                    // Ignore errors when trying to send error response
-                }
-            } finally {
-                // 确保请求对象被释放回对象池
-                if (req.socket && req.socket._currentRequest === req) {
-                    delete req.socket._currentRequest;
+        const res = new ServerResponse(conn, req);
+
+        try {
+            // Emit the request event
+            this.emit('request', req, res);
+
+            // Call the request listener if provided
+            if (this._requestListener) {
+                this._requestListener(req, res);
+            }
+        } catch (err) {
+            // Ignore errors in request handlers but log them
+            if (this._debug) {
+                console.error('Request handler error:', err);
+            }
+
+            // Make sure a response is sent on errors
+            try {
+                if (!res.headersSent) {
+                    res.statusCode = 500;
+                    res.statusMessage = 'Internal Server Error';
+                    res.setHeader('Content-Type', 'text/plain');
+                    res.end('Internal Server Error');
                 }
-                objectPool.releaseIncomingMessage(req);
+            } catch (resErr) {
+                // Ignore errors when trying to send error response
             }
         }
     }
 
-    _isCommonConnectionError(err) {
-        const msg = err.message || '';
+    _handleBody(conn, chunk) {
+        const state = conn[kBody];
 
-        return (
-            msg.includes('ECONNRESET') ||
-      msg.includes('EPIPE') ||
-      msg.includes('ECONNABORTED') ||
-      msg.includes('EINVAL')
-        );
-    }
+        // The stream was cancelled.
+        if (!state) {
+            return;
+        }
 
-    _isCommonSocketError(err) {
-        const msg = err.message || '';
+        const { controller, req } = state;
 
-        return (
-            msg.includes('ECONNRESET') ||
-      msg.includes('EPIPE') ||
-      msg.includes('ECONNABORTED') ||
-      msg.includes('EINVAL')
-        );
+        if (chunk === null) {
+            delete conn[kBody];
+            req.complete = true;
+            controller.close();
+        } else if (chunk instanceof Error) {
+            delete conn[kBody];
+            controller.error(chunk);
+        } else {
+            controller.enqueue(chunk);
+
+            if (controller.desiredSize <= 0) {
+                conn.pause();
+            }
+        }
     }
 
     get maxConnections() {
@@ -1339,6 +999,22 @@ export class Server extends TinyEmitter {
 
     set maxConnections(value) {
         this._maxConnections = value;
+
+        if (this._handle) {
+            this._handle.maxConnections = value;
+        }
+    }
+
+    get maxRequestsPerSocket() {
+        return this._maxRequestsPerSocket;
+    }
+
+    set maxRequestsPerSocket(value) {
+        this._maxRequestsPerSocket = value;
+
+        if (this._handle) {
+            this._handle.maxRequestsPerSocket = value;
+        }
     }
 
     get timeout() {
@@ -1347,20 +1023,60 @@ export class Server extends TinyEmitter {
 
     set timeout(value) {
         this._timeout = value;
+
+        if (this._handle) {
+            this._handle.timeout = value;
+        }
+    }
+
+    get headersTimeout() {
+        return this._headersTimeout;
+    }
+
+    set headersTimeout(value) {
+        this._headersTimeout = value;
+
+        if (this._handle) {
+            this._handle.headersTimeout = value;
+        }
+    }
+
+    get keepAliveTimeout() {
+        return this._keepAliveTimeout;
+    }
+
+    set keepAliveTimeout(value) {
+        this._keepAliveTimeout = value;
+
+        if (this._handle) {
+            this._handle.keepAliveTimeout = value;
+        }
+    }
+
+    get maxBodySize() {
+        return this._maxBodySize;
+    }
+
+    set maxBodySize(value) {
+        this._maxBodySize = value;
+
+        if (this._handle) {
+            this._handle.maxBodySize = value;
+        }
     }
 
     get connections() {
-        return this._connectionsCount;
+        return this._handle ? this._handle.connections : 0;
     }
 
     // Add address method for better compatibility
     address() {
-        if (!this._server || !this._listening) {
+        if (!this._handle || !this._listening) {
             return null;
         }
 
         try {
-            const addr = this._server.getsockname();
+            const addr = this._handle.getsockname();
 
             return {
                 port: addr.port,
@@ -3,7 +3,7 @@ const core = globalThis[Symbol.for('tjs.internal.core')];
 import { alert, confirm, prompt } from './alert-confirm-prompt.js';
 import engine from './engine.js';
 import env from './env.js';
-import { open, makeDir, makeTempFile, remove, symlink } from './fs.js';
+import { open, makeDir, makeTempFile, mmap, readDir, remove, symlink } from './fs.js';
 import { createServer } from './httpserver.js';
 import { lookup } from './lookup.js';
 import pathModule from './path.js';
@@ -28,6 +28,7 @@ const exports = [
     'cwd',
     'exePath',
     'exec',
+    'existsSync',
     'exit',
     'format',
     'homeDir',
@@ -38,13 +39,17 @@ const exports = [
     'link',
     'lstat',
     'lutime',
+    'madvise',
     'makeTempDir',
+    'msync',
     'pid',
     'ppid',
-    'readDir',
+    'readDirSync',
     'readFile',
+    'readFileSync',
     'readLink',
     'realPath',
+    'realPathSync',
     'rename',
     'spawn',
     'stat',
@@ -53,6 +58,7 @@ const exports = [
     'utime',
     'version',
     'watch',
+    'writeFileSync',
 ];
 
 for (const key of exports) {
@@ -118,6 +124,18 @@ Object.defineProperty(tjs, 'makeTempFile', {
     writable: false,
     value: makeTempFile,
 });
+Object.defineProperty(tjs, 'mmap', {
+    enumerable: true,
+    configurable: false,
+    writable: false,
+    value: mmap,
+});
+Object.defineProperty(tjs, 'readDir', {
+    enumerable: true,
+    configurable: false,
+    writable: false,
+    value: readDir,
+});
 Object.defineProperty(tjs, 'remove', {
     enumerable: true,
     configurable: false,
@@ -1,5 +1,5 @@
 import { isIP, lookup } from './lookup.js';
-import { readableStreamForHandle, writableStreamForHandle } from './stream-utils.js';
+import { readableStreamForStream, writableStreamForHandle } from './stream-utils.js';
 
 const core = globalThis[Symbol.for('tjs.internal.core')];
 
@@ -9,7 +9,8 @@ export async function connect(transport, host, port, options = {}) {
 
     switch (transport) {
         case 'tcp': {
-            const handle = new core.TCP();
+            // Create the socket right away, so options can be set before connecting.
+            const handle = new core.TCP(isIP(addr.ip) === 6 ? core.AF_INET6 : core.AF_INET);
 
             if (options.bindAddr) {
                 let flags = 0;
@@ -21,8 +22,14 @@ export async function connect(transport, host, port, options = {}) {
                 handle.bind(options.bindAddr, flags);
             }
 
+            setBufferSizes(handle, options);
+
             await handle.connect(addr);
 
+            if (options.noDelay !== undefined) {
+                handle.setNoDelay(options.noDelay);
+            }
+
             return new Connection(handle);
         }
 
@@ -66,7 +73,27 @@ export async function listen(transport, host, port, options = {}) {
                 flags |= core.TCP_IPV6ONLY;
             }
 
+            if (options.reusePort) {
+                if (core.TCP_REUSEPORT === undefined) {
+                    throw new Error('reusePort is not supported');
+                }
+
+                flags |= core.TCP_REUSEPORT;
+            }
+
             handle.bind(addr, flags);
+
+            // Accepted connections inherit these from the listening socket.
+            setBufferSizes(handle, options);
+
+            if (options.fastOpen) {
+                handle.setFastOpen(options.fastOpen === true ? DEFAULT_FASTOPEN_QUEUE : options.fastOpen);
+            }
+
+            if (options.deferAccept) {
+                handle.setDeferAccept(options.deferAccept === true ? 1 : options.deferAccept);
+            }
+
             handle.listen(options.backlog);
 
             return new Listener(handle);
@@ -100,6 +127,18 @@ export async function listen(transport, host, port, options = {}) {
     }
 }
 
+const DEFAULT_FASTOPEN_QUEUE = 256;
+
+function setBufferSizes(handle, options) {
+    if (options.sendBufferSize) {
+        handle.setSendBufferSize(options.sendBufferSize);
+    }
+
+    if (options.recvBufferSize) {
+        handle.setRecvBufferSize(options.recvBufferSize);
+    }
+}
+
 async function resolveAddress(transport, host, port) {
     switch (transport) {
         case 'tcp':
@@ -136,10 +175,15 @@ const kLocalAddress = Symbol('kLocalAddress');
 const kRemoteAddress = Symbol('kRemoteAddress');
 const kReadable = Symbol('kReadable');
 const kWritable = Symbol('kWritable');
+const kAccepted = Symbol('kAccepted');
+const kCorked = Symbol('kCorked');
+const kPending = Symbol('kPending');
 
 class Connection {
     constructor(handle) {
         this[kHandle] = handle;
+        this[kCorked] = 0;
+        this[kPending] = null;
     }
 
     get localAddress() {
@@ -160,7 +204,7 @@ class Connection {
 
     get readable() {
         if (!this[kReadable]) {
-            this[kReadable] = readableStreamForHandle(this[kHandle]);
+            this[kReadable] = readableStreamForStream(this[kHandle]);
         }
 
         return this[kReadable];
@@ -174,12 +218,75 @@ class Connection {
         return this[kWritable];
     }
 
+    get writeQueueSize() {
+        return this[kHandle].writeQueueSize;
+    }
+
     read(buf) {
         return this[kHandle].read(buf);
     }
 
     write(buf) {
-        return this[kHandle].write(buf);
+        if (this[kCorked] === 0) {
+            return this[kHandle].write(buf);
+        }
+
+        // Held back until uncork(), which writes everything in one go.
+        const bufs = Array.isArray(buf) ? buf : [ buf ];
+
+        for (const b of bufs) {
+            if (!(b instanceof Uint8Array)) {
+                throw new TypeError('expected a Uint8Array or an array of them');
+            }
+        }
+
+        const pending = this[kPending] ??= { bufs: [], size: 0, flushed: Promise.withResolvers() };
+        const start = pending.size;
+
+        for (const b of bufs) {
+            pending.bufs.push(b);
+            pending.size += b.byteLength;
+        }
+
+        const size = pending.size - start;
+
+        return pending.flushed.promise.then(() => size);
+    }
+
+    cork() {
+        this[kCorked]++;
+    }
+
+    uncork() {
+        if (this[kCorked] === 0 || --this[kCorked] > 0) {
+            return;
+        }
+
+        const pending = this[kPending];
+
+        if (!pending) {
+            return;
+        }
+
+        this[kPending] = null;
+
+        try {
+            this[kHandle].write(pending.bufs).then(pending.flushed.resolve, pending.flushed.reject);
+        } catch (e) {
+            pending.flushed.reject(e);
+        }
+    }
+
+    pipeTo(dest, options = {}) {
+        if (!(dest instanceof Connection)) {
+            throw new TypeError('expected a Connection');
+        }
+
+        uncorkAll(dest);
+
+        const { end = true, highWaterMark } = options;
+
+        return core.pipe(this[kHandle], dest[kHandle], end, highWaterMark);
     }
 
     setKeepAlive(enable, delay) {
@@ -190,18 +297,58 @@ class Connection {
         this[kHandle].setNoDelay(enable);
     }
 
+    setQuickAck(enable = true) {
+        this[kHandle].setQuickAck(enable);
+    }
+
+    setSendBufferSize(size) {
+        this[kHandle].setSendBufferSize(size);
+    }
+
+    setRecvBufferSize(size) {
+        this[kHandle].setRecvBufferSize(size);
+    }
+
     shutdown() {
+        uncorkAll(this);
         this[kHandle].shutdown();
     }
 
     close() {
+        discardCorked(this);
         this[kHandle].close();
     }
 }
 
+// Writes are not left behind a cork when the connection is shut down, the
+// shutdown waits for them.
+function uncorkAll(conn) {
+    if (conn[kCorked] > 0) {
+        conn[kCorked] = 1;
+        conn.uncork();
+    }
+}
+
+// Closing cancels writes still in flight, so anything held back by a cork is
+// dropped as well, and its writes are rejected like the cancelled ones.
+function discardCorked(conn) {
+    const pending = conn[kPending];
+
+    conn[kCorked] = 0;
+    conn[kPending] = null;
+
+    if (pending) {
+        const err = new Error('ECANCELED: operation canceled');
+
+        err.code = 'ECANCELED';
+        pending.flushed.reject(err);
+    }
+}
+
 class Listener {
     constructor(handle) {
         this[kHandle] = handle;
+        this[kAccepted] = [];
     }
 
     get localAddress() {
@@ -213,6 +360,10 @@ class Listener {
     }
 
     async accept() {
+        if (this[kAccepted].length) {
+            return this[kAccepted].shift();
+        }
+
         const handle = await this[kHandle].accept();
 
         if (typeof handle === 'undefined') {
@@ -222,6 +373,20 @@ class Listener {
         return new Connection(handle);
     }
 
+    async acceptMany(max) {
+        if (this[kAccepted].length) {
+            return this[kAccepted].splice(0, max ?? this[kAccepted].length);
+        }
+
+        const handles = await this[kHandle].acceptMany(max);
+
+        if (typeof handles === 'undefined') {
+            return;
+        }
+
+        return handles.map(handle => new Connection(handle));
+    }
+
     close() {
         this[kHandle].close();
     }
@@ -234,7 +399,16 @@ class Listener {
     }
 
     async next() {
-        const value = await this.accept();
+        // Connections come in batches, a burst costs a single wakeup.
+        if (!this[kAccepted].length) {
+            const conns = await this.acceptMany();
+
+            if (conns) {
+                this[kAccepted].push(...conns);
+            }
+        }
+
+        const value = this[kAccepted].shift();
 
         return {
             value,
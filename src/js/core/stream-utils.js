@@ -7,6 +7,7 @@ function silentClose(handle) {
 }
 
 const CHUNK_SIZE = 16640;  // Borrowed from Deno.
+const WRITE_HIGH_WATER_MARK = 64 * 1024;
 
 export function readableStreamForHandle(handle) {
     return new ReadableStream({
@@ -36,17 +37,106 @@ export function readableStreamForHandle(handle) {
     });
 }
 
-export function writableStreamForHandle(handle) {
+// Reads continuously into the runtime's slab pool: chunks are enqueued as
+// they arrive and reading is paused while the queue is full. It's a byte
+// stream, BYOB readers get the data copied into their buffers. There is no
+// autoAllocateChunkSize, so default readers get the slab chunks themselves.
+//
+// A slab chunk is a view on a 256KB slab which is only released once every
+// chunk on it is gone: consumers holding on to chunks for long should copy
+// them, or use a BYOB reader.
+export function readableStreamForStream(handle) {
+    let reading = false;
+
+    const stop = () => {
+        if (reading) {
+            reading = false;
+            handle.readStop();
+        }
+    };
+
+    const push = (controller, chunk) => {
+        const req = controller.byobRequest;
+
+        if (req) {
+            const view = req.view;
+            const n = Math.min(view.byteLength, chunk.byteLength);
+
+            new Uint8Array(view.buffer, view.byteOffset, n).set(chunk.subarray(0, n));
+            req.respond(n);
+            chunk = chunk.subarray(n);
+        }
+
+        if (chunk.byteLength > 0) {
+            controller.enqueue(chunk);
+        }
+    };
+
+    return new ReadableStream({
+        type: 'bytes',
+        pull(controller) {
+            if (reading) {
+                return;
+            }
+
+            reading = true;
+            handle.readStart(chunk => {
+                if (chunk === null) {
+                    reading = false;
+                    silentClose(handle);
+                    controller.close();
+                    controller.byobRequest?.respond(0);
+                } else if (chunk instanceof Error) {
+                    reading = false;
+                    controller.error(chunk);
+                    silentClose(handle);
+                } else {
+                    push(controller, chunk);
+
+                    if (controller.desiredSize <= 0) {
+                        stop();
+                    }
+                }
+            });
+        },
+        cancel() {
+            stop();
+            silentClose(handle);
+        }
+    }, {
+        highWaterMark: CHUNK_SIZE * 4
+    });
+}
+
+// Writes resolve right away while the bytes queued in the handle (as reported
+// by writeQueueSize) are under the high water mark, so writes don't wait on
+// each other. Handles which don't report it get one write at a time.
+export function writableStreamForHandle(handle, highWaterMark = WRITE_HIGH_WATER_MARK) {
+    let last = null;
+
     return new WritableStream({
         async write(chunk, controller) {
-            try {
-                await handle.write(chunk);
-            } catch (e) {
+            const fail = e => {
                 controller.error(e);
                 silentClose(handle);
+            };
+
+            try {
+                const p = handle.write(chunk);
+                const queued = handle.writeQueueSize;
+
+                if (queued !== undefined && queued < highWaterMark) {
+                    // Writes complete in order, the last one covers them all.
+                    last = p.catch(fail);
+                } else {
+                    await p;
+                }
+            } catch (e) {
+                fail(e);
             }
         },
-        close() {
+        async close() {
+            await last;
             silentClose(handle);
         },
         abort() {
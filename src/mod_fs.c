@@ -22,11 +22,18 @@
  * THE SOFTWARE.
  */
 
+#include "hash.h"
+#include "mem.h"
 #include "private.h"
 #include "utils.h"
 
 #include <string.h>
 #include <uv.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 
 static JSClassID tjs_file_class_id;
@@ -123,11 +130,16 @@ typedef struct {
 } TJSFsReq;
 
 typedef struct {
-    uv_work_t req;
+    union {
+        uv_fs_t fs;     /* chained requests, with io_uring */
+        uv_work_t work; /* a single thread pool job otherwise */
+    } req;
     DynBuf dbuf;
     JSContext *ctx;
-    int r;
     char *filename;
+    uv_file fd;
+    int error;
+    bool utf8; /* resolve to a string */
     TJSPromise result;
 } TJSReadFileReq;
 
@@ -450,6 +462,86 @@ static JSValue tjs_file_rw(JSContext *ctx, JSValue this_val, int argc, JSValue *
     return fr->result.p;
 }
 
+static JSValue tjs_file_rwv(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSFile *f = tjs_file_get(ctx, this_val);
+    if (!f) {
+        return JS_EXCEPTION;
+    }
+
+    /* arg 0: array of buffers */
+    if (!JS_IsArray(argv[0])) {
+        return JS_ThrowTypeError(ctx, "expected an array of buffers");
+    }
+
+    int64_t len;
+    if (JS_GetLength(ctx, argv[0], &len)) {
+        return JS_EXCEPTION;
+    }
+
+    if (len == 0 || len > INT32_MAX) {
+        return JS_ThrowRangeError(ctx, "invalid number of buffers");
+    }
+
+    /* arg 1: position (on the file) */
+    int64_t pos = -1;
+    if (!JS_IsUndefined(argv[1]) && JS_ToInt64(ctx, &pos, argv[1])) {
+        return JS_EXCEPTION;
+    }
+
+    /* The buffers are kept alive in a copy of the array, so changes to the given one don't matter. */
+    JSValue tarrays = JS_NewArray(ctx);
+    if (JS_IsException(tarrays)) {
+        return JS_EXCEPTION;
+    }
+
+    /* libuv copies the buffer descriptors, these only need to live until the request is queued. */
+    uv_buf_t *bufs = js_malloc(ctx, len * sizeof(*bufs));
+    if (!bufs) {
+        JS_FreeValue(ctx, tarrays);
+        return JS_EXCEPTION;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        JSValue tarray = JS_GetPropertyUint32(ctx, argv[0], i);
+        size_t size;
+        uint8_t *buf = JS_GetUint8Array(ctx, &size, tarray);
+        if (!buf) {
+            JS_FreeValue(ctx, tarray);
+            goto fail;
+        }
+
+        bufs[i] = uv_buf_init((char *) buf, size);
+        JS_SetPropertyUint32(ctx, tarrays, i, tarray);
+    }
+
+    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        goto fail;
+    }
+
+    int r;
+    if (magic) {
+        r = uv_fs_write(tjs_get_loop(ctx), &fr->req, f->fd, bufs, len, pos, uv__fs_req_cb);
+    } else {
+        r = uv_fs_read(tjs_get_loop(ctx), &fr->req, f->fd, bufs, len, pos, uv__fs_req_cb);
+    }
+    js_free(ctx, bufs);
+    if (r != 0) {
+        js_free(ctx, fr);
+        JS_FreeValue(ctx, tarrays);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    tjs_fsreq_init(ctx, fr, this_val);
+    fr->rw.tarray = tarrays;
+    return fr->result.p;
+
+fail:
+    js_free(ctx, bufs);
+    JS_FreeValue(ctx, tarrays);
+    return JS_EXCEPTION;
+}
+
 static JSValue tjs_file_close(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     TJSFile *f = tjs_file_get(ctx, this_val);
     if (!f) {
@@ -1253,203 +1345,962 @@ static JSValue tjs_fs_readdir(JSContext *ctx, JSValue this_val, int argc, JSValu
     return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
 }
 
-static void tjs__readfile_work_cb(uv_work_t *req) {
-    TJSReadFileReq *fr = req->data;
-    CHECK_NOT_NULL(fr);
+/*
+ * Directory walks.
+ *
+ * walkDir() lists a directory, and optionally everything under it, on the
+ * thread pool: every next() call runs a job which returns a batch of entries,
+ * instead of a request and a promise per entry. Only one directory is open at
+ * a time, subdirectories are queued and listed once the current one is done.
+ */
 
-    fr->r = tjs__load_file(fr->ctx, &fr->dbuf, fr->filename);
+#define TJS__DIRWALK_BATCH   1024
+#define TJS__DIRWALK_DIRENTS 64
+
+typedef struct {
+    char *name; /* relative to the root */
+    uv_dirent_type_t type;
+    double size;
+    double mtime;
+} TJSDirWalkEntry;
+
+static JSClassID tjs_dirwalk_class_id;
+
+typedef struct {
+    uv_work_t req;
+    JSContext *ctx;
+    TJSPromise result;
+    char *root;
+    bool recursive;
+    bool with_stats;
+    bool busy;
+    bool closed;
+    bool finalized;
+    /* Only touched by the job while busy. */
+    bool started;
+    int error;
+    uv_dir_t *dir;
+    char *dir_name; /* the open directory relative to the root, NULL for the root */
+    char **pending; /* directories left to list */
+    uint32_t npending;
+    uint32_t pending_size;
+    TJSDirWalkEntry *entries;
+    uint32_t nentries;
+} TJSDirWalk;
+
+/* These run on the thread pool, hence the plain allocator. */
+
+static char *tjs__dirwalk_join(const char *a, const char *b) {
+    size_t la = a ? strlen(a) : 0;
+    size_t lb = strlen(b);
+    char *p = tjs__malloc(la + lb + 2);
+    if (!p) {
+        return NULL;
+    }
+
+    if (a) {
+        memcpy(p, a, la);
+        p[la++] = '/';
+    }
+    memcpy(p + la, b, lb + 1);
+
+    return p;
+}
+
+static uv_dirent_type_t tjs__dirwalk_mode_type(uint64_t mode) {
+    switch (mode & S_IFMT) {
+        case S_IFREG:
+            return UV_DIRENT_FILE;
+        case S_IFDIR:
+            return UV_DIRENT_DIR;
+        case S_IFLNK:
+            return UV_DIRENT_LINK;
+        case S_IFIFO:
+            return UV_DIRENT_FIFO;
+#if defined(S_IFSOCK)
+        case S_IFSOCK:
+            return UV_DIRENT_SOCKET;
+#endif
+        case S_IFCHR:
+            return UV_DIRENT_CHAR;
+        case S_IFBLK:
+            return UV_DIRENT_BLOCK;
+        default:
+            return UV_DIRENT_UNKNOWN;
+    }
 }
 
-static void tjs__readfile_after_work_cb(uv_work_t *req, int status) {
-    TJSReadFileReq *fr = req->data;
-    CHECK_NOT_NULL(fr);
+static int tjs__dirwalk_add(TJSDirWalk *w, const uv_dirent_t *dent) {
+    TJSDirWalkEntry *e = &w->entries[w->nentries];
 
-    JSContext *ctx = fr->ctx;
-    JSValue arg;
-    bool is_reject = false;
+    e->name = tjs__dirwalk_join(w->dir_name, dent->name);
+    if (!e->name) {
+        return UV_ENOMEM;
+    }
+    e->type = dent->type;
+    e->size = 0;
+    e->mtime = 0;
 
-    if (status != 0) {
-        arg = tjs_new_error(ctx, status);
-        is_reject = true;
-        dbuf_free(&fr->dbuf);
-    } else if (fr->r < 0) {
-        arg = tjs_new_error(ctx, fr->r);
-        is_reject = true;
-        dbuf_free(&fr->dbuf);
-    } else {
-        arg = TJS_NewUint8Array(ctx, fr->dbuf.buf, fr->dbuf.size);
-        if (JS_IsException(arg)) {
-            dbuf_free(&fr->dbuf);
+    /* Some file systems don't report the type, it's needed to recurse. */
+    if (w->with_stats || (w->recursive && e->type == UV_DIRENT_UNKNOWN)) {
+        char *path = tjs__dirwalk_join(w->root, e->name);
+        if (!path) {
+            tjs__free(e->name);
+            return UV_ENOMEM;
         }
+
+        uv_fs_t req;
+        if (uv_fs_lstat(NULL, &req, path, NULL) == 0) {
+            e->size = req.statbuf.st_size;
+            e->mtime = req.statbuf.st_mtim.tv_sec * 1e3 + req.statbuf.st_mtim.tv_nsec / 1e6;
+            if (e->type == UV_DIRENT_UNKNOWN) {
+                e->type = tjs__dirwalk_mode_type(req.statbuf.st_mode);
+            }
+        }
+        uv_fs_req_cleanup(&req);
+        tjs__free(path);
     }
 
-    TJS_SettlePromise(ctx, &fr->result, is_reject, 1, &arg);
+    w->nentries++;
 
-    js_free(ctx, fr->filename);
-    js_free(ctx, fr);
+    if (w->recursive && e->type == UV_DIRENT_DIR) {
+        if (w->npending == w->pending_size) {
+            uint32_t size = w->pending_size ? w->pending_size * 2 : 16;
+            char **pending = tjs__realloc(w->pending, size * sizeof(*pending));
+            if (!pending) {
+                return UV_ENOMEM;
+            }
+            w->pending = pending;
+            w->pending_size = size;
+        }
+
+        char *name = tjs__dirwalk_join(NULL, e->name);
+        if (!name) {
+            return UV_ENOMEM;
+        }
+        w->pending[w->npending++] = name;
+    }
+
+    return 0;
 }
 
-static JSValue tjs_fs_readfile(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
-    const char *path = JS_ToCString(ctx, argv[0]);
-    if (!path) {
-        return JS_EXCEPTION;
+static void tjs__dirwalk_close_dir(TJSDirWalk *w) {
+    if (w->dir) {
+        uv_fs_t req;
+        uv_fs_closedir(NULL, &req, w->dir, NULL);
+        uv_fs_req_cleanup(&req);
+        w->dir = NULL;
     }
 
-    TJSReadFileReq *fr = js_malloc(ctx, sizeof(*fr));
-    if (!fr) {
-        JS_FreeCString(ctx, path);
-        return JS_EXCEPTION;
+    tjs__free(w->dir_name);
+    w->dir_name = NULL;
+}
+
+static bool tjs__dirwalk_done(TJSDirWalk *w) {
+    return w->started && !w->dir && w->npending == 0;
+}
+
+static void tjs__dirwalk_work_cb(uv_work_t *req) {
+    TJSDirWalk *w = req->data;
+    CHECK_NOT_NULL(w);
+
+    uv_dirent_t dirents[TJS__DIRWALK_DIRENTS];
+    uv_fs_t fs_req;
+    int r;
+
+    while (w->nentries < TJS__DIRWALK_BATCH && !w->error) {
+        if (!w->dir) {
+            char *name = NULL;
+
+            if (w->started) {
+                if (w->npending == 0) {
+                    break;
+                }
+                name = w->pending[--w->npending];
+            }
+            w->started = true;
+
+            char *path = name ? tjs__dirwalk_join(w->root, name) : w->root;
+            if (!path) {
+                tjs__free(name);
+                w->error = UV_ENOMEM;
+                break;
+            }
+
+            r = uv_fs_opendir(NULL, &fs_req, path, NULL);
+            uv_dir_t *dir = fs_req.ptr;
+            uv_fs_req_cleanup(&fs_req);
+            if (path != w->root) {
+                tjs__free(path);
+            }
+
+            if (r != 0) {
+                /* Subdirectories which vanished or can't be read are skipped, like find does. */
+                if (name) {
+                    tjs__free(name);
+                    continue;
+                }
+                w->error = r;
+                break;
+            }
+
+            w->dir = dir;
+            w->dir_name = name;
+        }
+
+        w->dir->dirents = dirents;
+        w->dir->nentries = TJS__DIRWALK_DIRENTS;
+
+        r = uv_fs_readdir(NULL, &fs_req, w->dir, NULL);
+        for (int i = 0; i < r && !w->error; i++) {
+            w->error = tjs__dirwalk_add(w, &dirents[i]);
+        }
+        uv_fs_req_cleanup(&fs_req);
+
+        if (r <= 0) {
+            /* Like opening them, failing to read subdirectories isn't fatal. */
+            if (r < 0 && !w->dir_name) {
+                w->error = r;
+            }
+            tjs__dirwalk_close_dir(w);
+        }
     }
+}
 
-    fr->ctx = ctx;
-    tjs_dbuf_init(ctx, &fr->dbuf);
-    fr->r = -1;
-    fr->filename = js_strdup(ctx, path);
-    fr->req.data = fr;
-    JS_FreeCString(ctx, path);
+static void tjs__dirwalk_free_entries(TJSDirWalk *w) {
+    for (uint32_t i = 0; i < w->nentries; i++) {
+        tjs__free(w->entries[i].name);
+    }
+    w->nentries = 0;
+}
 
-    int r = uv_queue_work(tjs_get_loop(ctx), &fr->req, tjs__readfile_work_cb, tjs__readfile_after_work_cb);
-    if (r != 0) {
-        js_free(ctx, fr->filename);
-        js_free(ctx, fr);
-        return tjs_throw_errno(ctx, r);
+static void tjs__dirwalk_cleanup(TJSDirWalk *w) {
+    tjs__dirwalk_free_entries(w);
+    tjs__dirwalk_close_dir(w);
+
+    while (w->npending > 0) {
+        tjs__free(w->pending[--w->npending]);
     }
+    w->started = true;
+}
 
-    return TJS_InitPromise(ctx, &fr->result);
+static void tjs__dirwalk_free(TJSDirWalk *w) {
+    tjs__dirwalk_cleanup(w);
+    tjs__free(w->pending);
+    tjs__free(w->entries);
+    tjs__free(w->root);
+    tjs__free(w);
 }
 
-static JSValue tjs_fs_xchown(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
-    if (!JS_IsString(argv[0])) {
-        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+static JSValue tjs__dirwalk_batch(JSContext *ctx, TJSDirWalk *w) {
+    JSValue batch = JS_NewObjectProto(ctx, JS_NULL);
+    JSValue names = JS_NewArray(ctx);
+    JSValue types = JS_NewArray(ctx);
+    JSValue sizes = w->with_stats ? JS_NewArray(ctx) : JS_UNDEFINED;
+    JSValue mtimes = w->with_stats ? JS_NewArray(ctx) : JS_UNDEFINED;
+
+    for (uint32_t i = 0; i < w->nentries; i++) {
+        TJSDirWalkEntry *e = &w->entries[i];
+
+        JS_SetPropertyUint32(ctx, names, i, JS_NewString(ctx, e->name));
+        JS_SetPropertyUint32(ctx, types, i, JS_NewInt32(ctx, e->type));
+        if (w->with_stats) {
+            JS_SetPropertyUint32(ctx, sizes, i, JS_NewFloat64(ctx, e->size));
+            JS_SetPropertyUint32(ctx, mtimes, i, JS_NewFloat64(ctx, e->mtime));
+        }
     }
 
-    int uid;
-    if (JS_IsUndefined(argv[1]) || JS_ToInt32(ctx, &uid, argv[1])) {
-        return JS_ThrowTypeError(ctx, "expected a number for uid parameter");
+    JS_DefinePropertyValueStr(ctx, batch, "names", names, JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, batch, "types", types, JS_PROP_C_W_E);
+    if (w->with_stats) {
+        JS_DefinePropertyValueStr(ctx, batch, "sizes", sizes, JS_PROP_C_W_E);
+        JS_DefinePropertyValueStr(ctx, batch, "mtimes", mtimes, JS_PROP_C_W_E);
     }
 
-    int gid;
-    if (JS_IsUndefined(argv[2]) || JS_ToInt32(ctx, &gid, argv[2])) {
-        return JS_ThrowTypeError(ctx, "expected a number for gid parameter");
+    return batch;
+}
+
+static void tjs__dirwalk_after_work_cb(uv_work_t *req, int status) {
+    TJSDirWalk *w = req->data;
+    CHECK_NOT_NULL(w);
+
+    w->busy = false;
+
+    /* The object is gone, and so is the promise. */
+    if (w->finalized) {
+        tjs__dirwalk_free(w);
+        return;
     }
 
-    const char *path = JS_ToCString(ctx, argv[0]);
-    if (!path) {
-        return JS_EXCEPTION;
+    JSContext *ctx = w->ctx;
+    JSValue arg;
+    bool is_reject = false;
+
+    if (status != 0) {
+        w->error = status;
     }
 
-    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
-    if (!fr) {
-        JS_FreeCString(ctx, path);
-        return JS_EXCEPTION;
+    /* Entries read before an error are delivered first, the error comes next. */
+    if (w->nentries > 0) {
+        arg = tjs__dirwalk_batch(ctx, w);
+    } else if (w->error) {
+        arg = tjs_new_error(ctx, w->error);
+        is_reject = true;
+    } else {
+        arg = JS_NULL;
     }
 
-    int r = (magic == 1 ? uv_fs_lchown : uv_fs_chown)(tjs_get_loop(ctx), &fr->req, path, uid, gid, uv__fs_req_cb);
-    JS_FreeCString(ctx, path);
-    if (r != 0) {
-        js_free(ctx, fr);
-        return tjs_throw_errno(ctx, r);
+    tjs__dirwalk_free_entries(w);
+    if (w->closed) {
+        tjs__dirwalk_cleanup(w);
     }
 
-    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+    TJS_SettlePromise(ctx, &w->result, is_reject, 1, &arg);
 }
 
-static JSValue tjs_fs_chmod(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
-    if (!JS_IsString(argv[0])) {
-        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+static void tjs_dirwalk_finalizer(JSRuntime *rt, JSValue val) {
+    TJSDirWalk *w = JS_GetOpaque(val, tjs_dirwalk_class_id);
+    if (w) {
+        TJS_FreePromiseRT(rt, &w->result);
+        if (w->busy) {
+            w->finalized = true;
+        } else {
+            tjs__dirwalk_free(w);
+        }
     }
+}
 
-    int mode;
-    if (JS_IsUndefined(argv[1]) || JS_ToInt32(ctx, &mode, argv[1])) {
-        return JS_ThrowTypeError(ctx, "expected a number for mode parameter");
+static void tjs_dirwalk_mark(JSRuntime *rt, JSValue val, JS_MarkFunc *mark_func) {
+    TJSDirWalk *w = JS_GetOpaque(val, tjs_dirwalk_class_id);
+    if (w) {
+        TJS_MarkPromise(rt, &w->result, mark_func);
     }
+}
+
+static JSClassDef tjs_dirwalk_class = {
+    "DirWalk",
+    .finalizer = tjs_dirwalk_finalizer,
+    .gc_mark = tjs_dirwalk_mark,
+};
 
+static JSValue tjs_fs_walkdir(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     const char *path = JS_ToCString(ctx, argv[0]);
     if (!path) {
         return JS_EXCEPTION;
     }
 
-    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
-    if (!fr) {
+    JSValue obj = JS_NewObjectClass(ctx, tjs_dirwalk_class_id);
+    if (JS_IsException(obj)) {
         JS_FreeCString(ctx, path);
-        return JS_EXCEPTION;
+        return obj;
     }
 
-    int r = uv_fs_chmod(tjs_get_loop(ctx), &fr->req, path, mode, uv__fs_req_cb);
+    TJSDirWalk *w = tjs__mallocz(sizeof(*w));
+    if (w) {
+        w->root = tjs__dirwalk_join(NULL, path);
+        w->entries = tjs__malloc((TJS__DIRWALK_BATCH + TJS__DIRWALK_DIRENTS) * sizeof(*w->entries));
+    }
     JS_FreeCString(ctx, path);
-    if (r != 0) {
-        js_free(ctx, fr);
-        return tjs_throw_errno(ctx, r);
+
+    if (!w || !w->root || !w->entries) {
+        if (w) {
+            tjs__dirwalk_free(w);
+        }
+        JS_FreeValue(ctx, obj);
+        return JS_ThrowOutOfMemory(ctx);
     }
 
-    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
-}
+    w->ctx = ctx;
+    w->req.data = w;
+    w->recursive = JS_ToBool(ctx, argv[1]);
+    w->with_stats = JS_ToBool(ctx, argv[2]);
+    TJS_ClearPromise(ctx, &w->result);
 
-static JSValue tjs_fs_xutime(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
-    if (!JS_IsString(argv[0])) {
-        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
-    }
+    JS_SetOpaque(obj, w);
 
-    double atime;
-    if (JS_ToFloat64(ctx, &atime, argv[1])) {
+    return obj;
+}
+
+static JSValue tjs_dirwalk_next(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSDirWalk *w = JS_GetOpaque2(ctx, this_val, tjs_dirwalk_class_id);
+    if (!w) {
         return JS_EXCEPTION;
     }
 
-    double mtime;
-    if (JS_ToFloat64(ctx, &mtime, argv[2])) {
-        return JS_EXCEPTION;
+    if (w->busy) {
+        return tjs_throw_errno(ctx, UV_EBUSY);
     }
 
-    const char *path = JS_ToCString(ctx, argv[0]);
-    if (!path) {
-        return JS_EXCEPTION;
+    if (w->closed || (tjs__dirwalk_done(w) && !w->error)) {
+        JSValue arg = JS_NULL;
+        return TJS_NewResolvedPromise(ctx, 1, &arg);
     }
 
-    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
-    if (!fr) {
-        JS_FreeCString(ctx, path);
-        return JS_EXCEPTION;
+    if (w->error) {
+        JSValue arg = tjs_new_error(ctx, w->error);
+        return TJS_NewRejectedPromise(ctx, 1, &arg);
     }
 
-    /* Date.getTime is in ms, convert to seconds. */
-    int r = (magic == 1 ? uv_fs_lutime
-                        : uv_fs_utime)(tjs_get_loop(ctx), &fr->req, path, atime / 1000, mtime / 1000, uv__fs_req_cb);
-    JS_FreeCString(ctx, path);
+    int r = uv_queue_work(tjs_get_loop(ctx), &w->req, tjs__dirwalk_work_cb, tjs__dirwalk_after_work_cb);
     if (r != 0) {
-        js_free(ctx, fr);
         return tjs_throw_errno(ctx, r);
     }
 
-    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+    w->busy = true;
+
+    return TJS_InitPromise(ctx, &w->result);
 }
 
-static JSValue tjs_fs_readlink(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
-    if (!JS_IsString(argv[0])) {
-        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+static JSValue tjs_dirwalk_close(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSDirWalk *w = JS_GetOpaque2(ctx, this_val, tjs_dirwalk_class_id);
+    if (!w) {
+        return JS_EXCEPTION;
     }
 
-    const char *path = JS_ToCString(ctx, argv[0]);
-    if (!path) {
-        return JS_EXCEPTION;
+    w->closed = true;
+
+    /* Otherwise it's done once the running job is. */
+    if (!w->busy) {
+        tjs__dirwalk_cleanup(w);
     }
 
-    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
-    if (!fr) {
-        JS_FreeCString(ctx, path);
-        return JS_EXCEPTION;
+    return JS_UNDEFINED;
+}
+
+/* Parses the encoding argument of readFile(), only UTF-8 is supported. */
+static int tjs__readfile_encoding(JSContext *ctx, JSValue arg, bool *utf8) {
+    *utf8 = false;
+    if (JS_IsUndefined(arg)) {
+        return 0;
     }
 
-    int r = uv_fs_readlink(tjs_get_loop(ctx), &fr->req, path, uv__fs_req_cb);
-    JS_FreeCString(ctx, path);
-    if (r != 0) {
-        js_free(ctx, fr);
-        return tjs_throw_errno(ctx, r);
+    const char *encoding = JS_ToCString(ctx, arg);
+    if (!encoding) {
+        return -1;
+    }
+    *utf8 = strcasecmp(encoding, "utf-8") == 0 || strcasecmp(encoding, "utf8") == 0;
+    JS_FreeCString(ctx, encoding);
+    if (!*utf8) {
+        JS_ThrowRangeError(ctx, "unsupported encoding");
+        return -1;
     }
 
-    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+    return 0;
 }
 
-static JSValue tjs_fs_link(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+/* Turns the file content into a string or a Uint8Array, consuming the buffer. */
+static JSValue tjs__readfile_value(JSContext *ctx, DynBuf *dbuf, bool utf8) {
+    JSValue ret;
+
+    if (utf8) {
+        const char *buf = (const char *) dbuf->buf;
+        size_t len = dbuf->size;
+
+        /* Skip the BOM, like TextDecoder does. */
+        if (len >= 3 && memcmp(buf, "\xEF\xBB\xBF", 3) == 0) {
+            buf += 3;
+            len -= 3;
+        }
+
+        ret = JS_NewStringLen(ctx, buf, len);
+        dbuf_free(dbuf);
+    } else {
+        /* The buffer is handed over, not copied. */
+        ret = TJS_NewUint8Array(ctx, dbuf->buf, dbuf->size);
+        if (JS_IsException(ret)) {
+            dbuf_free(dbuf);
+        }
+    }
+
+    return ret;
+}
+
+static void tjs__readfile_settle(TJSReadFileReq *fr) {
+    JSContext *ctx = fr->ctx;
+    JSValue arg;
+    bool is_reject = false;
+
+    if (fr->error < 0) {
+        arg = tjs_new_error(ctx, fr->error);
+        is_reject = true;
+        dbuf_free(&fr->dbuf);
+    } else {
+        arg = tjs__readfile_value(ctx, &fr->dbuf, fr->utf8);
+    }
+
+    if (JS_IsException(arg)) {
+        arg = JS_GetException(ctx);
+        is_reject = true;
+    }
+
+    TJS_SettlePromise(ctx, &fr->result, is_reject, 1, &arg);
+
+    js_free(ctx, fr->filename);
+    js_free(ctx, fr);
+}
+
+/*
+ * By default readFile() runs tjs__load_file() as a single thread pool job.
+ * With io_uring it chains open, fstat, read and close requests on the loop
+ * instead, those don't need a thread pool round trip each.
+ */
+
+static void tjs__readfile_work_cb(uv_work_t *req) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    fr->error = tjs__load_file(fr->ctx, &fr->dbuf, fr->filename);
+}
+
+static void tjs__readfile_after_work_cb(uv_work_t *req, int status) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    if (status != 0) {
+        fr->error = status;
+    }
+
+    tjs__readfile_settle(fr);
+}
+
+static void uv__readfile_read_cb(uv_fs_t *req);
+
+static void uv__readfile_close_cb(uv_fs_t *req) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    uv_fs_req_cleanup(req);
+
+    tjs__readfile_settle(fr);
+}
+
+static void tjs__readfile_close(TJSReadFileReq *fr, int error) {
+    fr->error = error;
+
+    int r = uv_fs_close(tjs_get_loop(fr->ctx), &fr->req.fs, fr->fd, uv__readfile_close_cb);
+    if (r != 0) {
+        /* The request never started, settle right away. */
+        tjs__readfile_settle(fr);
+    }
+}
+
+static void tjs__readfile_read(TJSReadFileReq *fr) {
+    DynBuf *dbuf = &fr->dbuf;
+
+    /* Files may be bigger than reported (e.g. in /proc) or grow meanwhile, so read until EOF. */
+    if (dbuf->allocated_size - dbuf->size < TJS__LOAD_FILE_SLACK &&
+        dbuf_realloc(dbuf, dbuf->allocated_size + TJS__LOAD_FILE_GROW)) {
+        tjs__readfile_close(fr, UV_ENOMEM);
+        return;
+    }
+
+    uv_buf_t b = uv_buf_init((char *) dbuf->buf + dbuf->size, dbuf->allocated_size - dbuf->size);
+    int r = uv_fs_read(tjs_get_loop(fr->ctx), &fr->req.fs, fr->fd, &b, 1, dbuf->size, uv__readfile_read_cb);
+    if (r != 0) {
+        tjs__readfile_close(fr, r);
+    }
+}
+
+static void uv__readfile_read_cb(uv_fs_t *req) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    ssize_t nread = req->result;
+    uv_fs_req_cleanup(req);
+
+    if (nread <= 0) {
+        tjs__readfile_close(fr, nread);
+        return;
+    }
+
+    fr->dbuf.size += nread;
+    tjs__readfile_read(fr);
+}
+
+static void uv__readfile_stat_cb(uv_fs_t *req) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    /* Allocate once for the whole file, the size is only a hint. */
+    size_t size_hint = req->result == 0 ? req->statbuf.st_size : 0;
+    uv_fs_req_cleanup(req);
+
+    if (dbuf_realloc(&fr->dbuf, size_hint + TJS__LOAD_FILE_SLACK)) {
+        tjs__readfile_close(fr, UV_ENOMEM);
+        return;
+    }
+
+    tjs__readfile_read(fr);
+}
+
+static void uv__readfile_open_cb(uv_fs_t *req) {
+    TJSReadFileReq *fr = req->data;
+    CHECK_NOT_NULL(fr);
+
+    int r = req->result;
+    uv_fs_req_cleanup(req);
+
+    if (r < 0) {
+        fr->error = r;
+        tjs__readfile_settle(fr);
+        return;
+    }
+
+    fr->fd = r;
+
+    r = uv_fs_fstat(tjs_get_loop(fr->ctx), req, fr->fd, uv__readfile_stat_cb);
+    if (r != 0) {
+        tjs__readfile_close(fr, r);
+    }
+}
+
+static JSValue tjs_fs_readfile(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    bool utf8;
+    if (tjs__readfile_encoding(ctx, argv[1], &utf8)) {
+        return JS_EXCEPTION;
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    TJSReadFileReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    fr->ctx = ctx;
+    fr->filename = NULL;
+    fr->utf8 = utf8;
+    fr->fd = -1;
+    fr->error = 0;
+    tjs_dbuf_init(ctx, &fr->dbuf);
+
+    int r;
+    if (TJS_GetRuntime(ctx)->options.io_uring) {
+        fr->req.fs.data = fr;
+        r = uv_fs_open(tjs_get_loop(ctx), &fr->req.fs, path, UV_FS_O_RDONLY, 0, uv__readfile_open_cb);
+        JS_FreeCString(ctx, path);
+    } else {
+        fr->filename = js_strdup(ctx, path);
+        JS_FreeCString(ctx, path);
+        if (!fr->filename) {
+            js_free(ctx, fr);
+            return JS_EXCEPTION;
+        }
+        fr->req.work.data = fr;
+        r = uv_queue_work(tjs_get_loop(ctx), &fr->req.work, tjs__readfile_work_cb, tjs__readfile_after_work_cb);
+    }
+
+    if (r != 0) {
+        js_free(ctx, fr->filename);
+        js_free(ctx, fr);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return TJS_InitPromise(ctx, &fr->result);
+}
+
+/*
+ * Synchronous versions of the most common operations. They block the loop
+ * thread, but for small files that's cheaper than a thread pool round trip,
+ * which is what matters at startup.
+ */
+
+static void tjs__fs_close_sync(uv_file fd) {
+    uv_fs_t req;
+    uv_fs_close(NULL, &req, fd, NULL);
+    uv_fs_req_cleanup(&req);
+}
+
+static JSValue tjs_fs_readfile_sync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    bool utf8;
+    if (tjs__readfile_encoding(ctx, argv[1], &utf8)) {
+        return JS_EXCEPTION;
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    DynBuf dbuf;
+    tjs_dbuf_init(ctx, &dbuf);
+
+    int r = tjs__load_file(ctx, &dbuf, path);
+    JS_FreeCString(ctx, path);
+    if (r < 0) {
+        dbuf_free(&dbuf);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return tjs__readfile_value(ctx, &dbuf, utf8);
+}
+
+static JSValue tjs_fs_writefile_sync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    /* arg 2: mode */
+    int32_t mode = 0666;
+    if (!JS_IsUndefined(argv[2]) && JS_ToInt32(ctx, &mode, argv[2])) {
+        return JS_EXCEPTION;
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    /* arg 1: data, a string or a buffer. It goes last: converting the other arguments may
+     * run JS code, which could detach or resize the buffer. */
+    const char *str = NULL;
+    const uint8_t *data;
+    size_t size;
+
+    if (JS_IsString(argv[1])) {
+        str = JS_ToCStringLen(ctx, &size, argv[1]);
+        data = (const uint8_t *) str;
+    } else {
+        data = JS_GetUint8Array(ctx, &size, argv[1]);
+    }
+    if (!data) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    uv_fs_t req;
+    int r = uv_fs_open(NULL, &req, path, js__uv_open_flags("w", 1), mode, NULL);
+    uv_fs_req_cleanup(&req);
+    JS_FreeCString(ctx, path);
+    if (r < 0) {
+        JS_FreeCString(ctx, str);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    uv_file fd = r;
+    size_t off = 0;
+
+    /* Keep going after short writes. */
+    while (off < size) {
+        uv_buf_t b = uv_buf_init((char *) data + off, size - off);
+        r = uv_fs_write(NULL, &req, fd, &b, 1, -1, NULL);
+        uv_fs_req_cleanup(&req);
+        if (r < 0) {
+            break;
+        }
+        off += r;
+    }
+
+    tjs__fs_close_sync(fd);
+    JS_FreeCString(ctx, str);
+
+    if (r < 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_fs_readdir_sync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    uv_fs_t req;
+    int r = uv_fs_scandir(NULL, &req, path, 0, NULL);
+    JS_FreeCString(ctx, path);
+    if (r < 0) {
+        uv_fs_req_cleanup(&req);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    JSValue ret = JS_NewArray(ctx);
+    uv_dirent_t dent;
+    uint32_t i = 0;
+
+    while (uv_fs_scandir_next(&req, &dent) != UV_EOF) {
+        JSValue item = tjs_new_dirent(ctx, &dent);
+        if (JS_IsException(item)) {
+            JS_FreeValue(ctx, ret);
+            ret = JS_EXCEPTION;
+            break;
+        }
+        JS_SetPropertyUint32(ctx, ret, i++, item);
+    }
+
+    uv_fs_req_cleanup(&req);
+
+    return ret;
+}
+
+static JSValue tjs_fs_exists_sync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    /* Any error means it's not there, as far as the caller can tell. */
+    uv_fs_t req;
+    int r = uv_fs_stat(NULL, &req, path, NULL);
+    uv_fs_req_cleanup(&req);
+    JS_FreeCString(ctx, path);
+
+    return JS_NewBool(ctx, r == 0);
+}
+
+static JSValue tjs_fs_realpath_sync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    uv_fs_t req;
+    int r = uv_fs_realpath(NULL, &req, path, NULL);
+    JS_FreeCString(ctx, path);
+    if (r != 0) {
+        uv_fs_req_cleanup(&req);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    JSValue ret = JS_NewString(ctx, req.ptr);
+    uv_fs_req_cleanup(&req);
+
+    return ret;
+}
+
+static JSValue tjs_fs_xchown(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    if (!JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+    }
+
+    int uid;
+    if (JS_IsUndefined(argv[1]) || JS_ToInt32(ctx, &uid, argv[1])) {
+        return JS_ThrowTypeError(ctx, "expected a number for uid parameter");
+    }
+
+    int gid;
+    if (JS_IsUndefined(argv[2]) || JS_ToInt32(ctx, &gid, argv[2])) {
+        return JS_ThrowTypeError(ctx, "expected a number for gid parameter");
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    int r = (magic == 1 ? uv_fs_lchown : uv_fs_chown)(tjs_get_loop(ctx), &fr->req, path, uid, gid, uv__fs_req_cb);
+    JS_FreeCString(ctx, path);
+    if (r != 0) {
+        js_free(ctx, fr);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+}
+
+static JSValue tjs_fs_chmod(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    if (!JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+    }
+
+    int mode;
+    if (JS_IsUndefined(argv[1]) || JS_ToInt32(ctx, &mode, argv[1])) {
+        return JS_ThrowTypeError(ctx, "expected a number for mode parameter");
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    int r = uv_fs_chmod(tjs_get_loop(ctx), &fr->req, path, mode, uv__fs_req_cb);
+    JS_FreeCString(ctx, path);
+    if (r != 0) {
+        js_free(ctx, fr);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+}
+
+static JSValue tjs_fs_xutime(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    if (!JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+    }
+
+    double atime;
+    if (JS_ToFloat64(ctx, &atime, argv[1])) {
+        return JS_EXCEPTION;
+    }
+
+    double mtime;
+    if (JS_ToFloat64(ctx, &mtime, argv[2])) {
+        return JS_EXCEPTION;
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    /* Date.getTime is in ms, convert to seconds. */
+    int r = (magic == 1 ? uv_fs_lutime
+                        : uv_fs_utime)(tjs_get_loop(ctx), &fr->req, path, atime / 1000, mtime / 1000, uv__fs_req_cb);
+    JS_FreeCString(ctx, path);
+    if (r != 0) {
+        js_free(ctx, fr);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+}
+
+static JSValue tjs_fs_readlink(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    if (!JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "expected a string for path parameter");
+    }
+
+    const char *path = JS_ToCString(ctx, argv[0]);
+    if (!path) {
+        return JS_EXCEPTION;
+    }
+
+    TJSFsReq *fr = js_malloc(ctx, sizeof(*fr));
+    if (!fr) {
+        JS_FreeCString(ctx, path);
+        return JS_EXCEPTION;
+    }
+
+    int r = uv_fs_readlink(tjs_get_loop(ctx), &fr->req, path, uv__fs_req_cb);
+    JS_FreeCString(ctx, path);
+    if (r != 0) {
+        js_free(ctx, fr);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
+}
+
+static JSValue tjs_fs_link(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     if (!JS_IsString(argv[0])) {
         return JS_ThrowTypeError(ctx, "expected a string for path parameter");
     }
@@ -1556,9 +2407,201 @@ static JSValue tjs_fs_statfs(JSContext *ctx, JSValue this_val, int argc, JSValue
     return tjs_fsreq_init(ctx, fr, JS_UNDEFINED);
 }
 
+/*
+ * Memory mapped files.
+ *
+ * The mapping backs an external ArrayBuffer and goes away with it. Mappings
+ * are always writable: read-only ones are private, so writes from JS stay in
+ * memory instead of faulting, while "rw" ones are shared with the file.
+ */
+
+#ifndef _WIN32
+typedef struct TJSMapping {
+    void *data; /* what the ArrayBuffer points to */
+    size_t size;
+    void *base; /* page aligned */
+    size_t len;
+    TJSRuntime *qrt;
+    UT_hash_handle hh;
+} TJSMapping;
+
+static void tjs__mmap_free(JSRuntime *rt, void *opaque, void *ptr) {
+    TJSMapping *m = opaque;
+
+    HASH_DEL(m->qrt->mappings, m);
+    munmap(m->base, m->len);
+    js_free_rt(rt, m);
+}
+
+/* The mapping behind a buffer returned by mmap(), other buffers are refused: msync() and
+ * madvise() work on whole pages, which would include memory the buffer doesn't own. Empty
+ * buffers are never mapped, NULL is returned for them. */
+static int tjs__mmap_get(JSContext *ctx, JSValue obj, TJSMapping **m) {
+    if (!JS_IsArrayBuffer(obj)) {
+        JS_ThrowTypeError(ctx, "expected an ArrayBuffer");
+        return -1;
+    }
+
+    size_t size = 0;
+    uint8_t *buf = JS_GetArrayBuffer(ctx, &size, obj);
+
+    *m = NULL;
+    if (!buf) {
+        return JS_HasException(ctx) ? -1 : 0;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    HASH_FIND_PTR(qrt->mappings, &buf, *m);
+    if (!*m || (*m)->size != size) {
+        tjs_throw_errno(ctx, UV_EINVAL);
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+static JSValue tjs_fs_mmap(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+#ifdef _WIN32
+    return tjs_throw_errno(ctx, UV_ENOTSUP);
+#else
+    int32_t fd;
+    if (JS_ToInt32(ctx, &fd, argv[0])) {
+        return JS_EXCEPTION;
+    }
+
+    int64_t offset = 0;
+    if (!JS_IsUndefined(argv[1]) && JS_ToInt64(ctx, &offset, argv[1])) {
+        return JS_EXCEPTION;
+    }
+
+    int64_t length = -1;
+    if (!JS_IsUndefined(argv[2]) && JS_ToInt64(ctx, &length, argv[2])) {
+        return JS_EXCEPTION;
+    }
+
+    int shared = JS_ToBool(ctx, argv[3]);
+    if (shared == -1) {
+        return JS_EXCEPTION;
+    }
+
+    uv_fs_t req;
+    int r = uv_fs_fstat(NULL, &req, fd, NULL);
+    int64_t size = req.statbuf.st_size;
+    uv_fs_req_cleanup(&req);
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    /* Touching pages past the end of the file raises SIGBUS, don't map them. */
+    if (length == -1) {
+        length = size - offset;
+    }
+    if (offset < 0 || length < 0 || offset > size || length > size - offset || (uint64_t) length > SIZE_MAX) {
+        return tjs_throw_errno(ctx, UV_EINVAL);
+    }
+
+    if (length == 0) {
+        return JS_NewArrayBufferCopy(ctx, NULL, 0);
+    }
+
+    int64_t delta = offset % sysconf(_SC_PAGESIZE);
+    size_t len = length + delta;
+    void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, offset - delta);
+    if (base == MAP_FAILED) {
+        return tjs_throw_errno(ctx, uv_translate_sys_error(errno));
+    }
+
+    TJSMapping *m = js_malloc(ctx, sizeof(*m));
+    if (!m) {
+        munmap(base, len);
+        return JS_EXCEPTION;
+    }
+
+    m->data = (uint8_t *) base + delta;
+    m->size = length;
+    m->base = base;
+    m->len = len;
+    m->qrt = TJS_GetRuntime(ctx);
+
+    JSValue ab = JS_NewArrayBuffer(ctx, m->data, length, tjs__mmap_free, m, false);
+    if (JS_IsException(ab)) {
+        munmap(base, len);
+        js_free(ctx, m);
+
+        return ab;
+    }
+
+    HASH_ADD_PTR(m->qrt->mappings, data, m);
+
+    return ab;
+#endif
+}
+
+static JSValue tjs_fs_msync(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+#ifdef _WIN32
+    return tjs_throw_errno(ctx, UV_ENOTSUP);
+#else
+    TJSMapping *m;
+    if (tjs__mmap_get(ctx, argv[0], &m)) {
+        return JS_EXCEPTION;
+    }
+
+    if (m && msync(m->base, m->len, MS_SYNC) != 0) {
+        return tjs_throw_errno(ctx, uv_translate_sys_error(errno));
+    }
+
+    return JS_UNDEFINED;
+#endif
+}
+
+static JSValue tjs_fs_madvise(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+#ifdef _WIN32
+    return tjs_throw_errno(ctx, UV_ENOTSUP);
+#else
+    TJSMapping *m;
+    if (tjs__mmap_get(ctx, argv[0], &m)) {
+        return JS_EXCEPTION;
+    }
+
+    const char *advice_str = JS_ToCString(ctx, argv[1]);
+    if (!advice_str) {
+        return JS_EXCEPTION;
+    }
+
+    int advice;
+    if (strcmp(advice_str, "normal") == 0) {
+        advice = MADV_NORMAL;
+    } else if (strcmp(advice_str, "sequential") == 0) {
+        advice = MADV_SEQUENTIAL;
+    } else if (strcmp(advice_str, "random") == 0) {
+        advice = MADV_RANDOM;
+    } else if (strcmp(advice_str, "willneed") == 0) {
+        advice = MADV_WILLNEED;
+    } else if (strcmp(advice_str, "dontneed") == 0) {
+        advice = MADV_DONTNEED;
+    } else {
+        JS_FreeCString(ctx, advice_str);
+        return JS_ThrowTypeError(ctx, "invalid advice");
+    }
+    JS_FreeCString(ctx, advice_str);
+
+    if (m && madvise(m->base, m->len, advice) != 0) {
+        return tjs_throw_errno(ctx, uv_translate_sys_error(errno));
+    }
+
+    return JS_UNDEFINED;
+#endif
+}
+
 static const JSCFunctionListEntry tjs_file_proto_funcs[] = {
     TJS_CFUNC_MAGIC_DEF("read", 2, tjs_file_rw, 0),
     TJS_CFUNC_MAGIC_DEF("write", 2, tjs_file_rw, 1),
+    TJS_CFUNC_MAGIC_DEF("readv", 2, tjs_file_rwv, 0),
+    TJS_CFUNC_MAGIC_DEF("writev", 2, tjs_file_rwv, 1),
     TJS_CFUNC_DEF("close", 0, tjs_file_close),
     TJS_CFUNC_DEF("fileno", 0, tjs_file_fileno),
     TJS_CFUNC_DEF("stat", 0, tjs_file_stat),
@@ -1580,6 +2623,11 @@ static const JSCFunctionListEntry tjs_dir_proto_funcs[] = {
     TJS_CFUNC_DEF("[Symbol.asyncIterator]", 0, tjs_dir_iterator),
 };
 
+static const JSCFunctionListEntry tjs_dirwalk_proto_funcs[] = {
+    TJS_CFUNC_DEF("next", 0, tjs_dirwalk_next),
+    TJS_CFUNC_DEF("close", 0, tjs_dirwalk_close),
+};
+
 static const JSCFunctionListEntry tjs_dirent_proto_funcs[] = {
     TJS_CGETSET_DEF("isBlockDevice", tjs_dirent_isblockdevice, NULL),
     TJS_CGETSET_DEF("isCharacterDevice", tjs_dirent_ischaracterdevice, NULL),
@@ -1606,6 +2654,14 @@ static const JSCFunctionListEntry tjs_stat_proto_funcs[] = {
 static const JSCFunctionListEntry tjs_fs_funcs[] = {
     TJS_UVCONST(FS_SYMLINK_DIR),
     TJS_UVCONST(FS_SYMLINK_JUNCTION),
+    TJS_UVCONST(DIRENT_UNKNOWN),
+    TJS_UVCONST(DIRENT_FILE),
+    TJS_UVCONST(DIRENT_DIR),
+    TJS_UVCONST(DIRENT_LINK),
+    TJS_UVCONST(DIRENT_FIFO),
+    TJS_UVCONST(DIRENT_SOCKET),
+    TJS_UVCONST(DIRENT_CHAR),
+    TJS_UVCONST(DIRENT_BLOCK),
     TJS_CFUNC_DEF("open", 3, tjs_fs_open),
     TJS_CFUNC_DEF("newStdioFile", 2, tjs_fs_new_stdio_file),
     TJS_CFUNC_MAGIC_DEF("stat", 1, tjs_fs_stat, 0),
@@ -1619,7 +2675,13 @@ static const JSCFunctionListEntry tjs_fs_funcs[] = {
     TJS_CFUNC_DEF("mkdir", 2, tjs_fs_mkdir),
     TJS_CFUNC_DEF("copyFile", 2, tjs_fs_copyfile),
     TJS_CFUNC_DEF("readDir", 1, tjs_fs_readdir),
-    TJS_CFUNC_DEF("readFile", 1, tjs_fs_readfile),
+    TJS_CFUNC_DEF("walkDir", 3, tjs_fs_walkdir),
+    TJS_CFUNC_DEF("readFile", 2, tjs_fs_readfile),
+    TJS_CFUNC_DEF("readFileSync", 2, tjs_fs_readfile_sync),
+    TJS_CFUNC_DEF("writeFileSync", 3, tjs_fs_writefile_sync),
+    TJS_CFUNC_DEF("readDirSync", 1, tjs_fs_readdir_sync),
+    TJS_CFUNC_DEF("existsSync", 1, tjs_fs_exists_sync),
+    TJS_CFUNC_DEF("realPathSync", 1, tjs_fs_realpath_sync),
     TJS_CFUNC_MAGIC_DEF("chown", 3, tjs_fs_xchown, 0),
     TJS_CFUNC_MAGIC_DEF("lchown", 3, tjs_fs_xchown, 1),
     TJS_CFUNC_DEF("chmod", 2, tjs_fs_chmod),
@@ -1629,6 +2691,9 @@ static const JSCFunctionListEntry tjs_fs_funcs[] = {
     TJS_CFUNC_DEF("link", 2, tjs_fs_link),
     TJS_CFUNC_DEF("symlink", 3, tjs_fs_symlink),
     TJS_CFUNC_DEF("statFs", 1, tjs_fs_statfs),
+    TJS_CFUNC_DEF("mmap", 4, tjs_fs_mmap),
+    TJS_CFUNC_DEF("msync", 1, tjs_fs_msync),
+    TJS_CFUNC_DEF("madvise", 2, tjs_fs_madvise),
     /* Internal */
     TJS_CFUNC_DEF("mkdirSync", 2, tjs_fs_mkdir_sync),
     TJS_CFUNC_DEF("statSync", 1, tjs_fs_stat_sync),
@@ -1652,6 +2717,13 @@ void tjs__mod_fs_init(JSContext *ctx, JSValue ns) {
     JS_SetPropertyFunctionList(ctx, proto, tjs_dir_proto_funcs, countof(tjs_dir_proto_funcs));
     JS_SetClassProto(ctx, tjs_dir_class_id, proto);
 
+    /* DirWalk object */
+    JS_NewClassID(rt, &tjs_dirwalk_class_id);
+    JS_NewClass(rt, tjs_dirwalk_class_id, &tjs_dirwalk_class);
+    proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, proto, tjs_dirwalk_proto_funcs, countof(tjs_dirwalk_proto_funcs));
+    JS_SetClassProto(ctx, tjs_dirwalk_class_id, proto);
+
     /* DirEnt object */
     JS_NewClassID(rt, &tjs_dirent_class_id);
     JS_NewClass(rt, tjs_dirent_class_id, &tjs_dirent_class);
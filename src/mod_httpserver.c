@@ -0,0 +1,1970 @@
+/*
+ * txiki.js
+ *
+ * Copyright (c) 2019-present Saúl Ibarra Corretgé <s@saghul.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "../deps/llhttp/include/llhttp.h"
+#include "http-utils.h"
+#include "mem.h"
+#include "private.h"
+#include "utils.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/*
+ * Native HTTP/1.x server.
+ *
+ * The listening socket, the accept loop, request parsing and response
+ * serialization all live here. JS is called once per request, with a
+ * ready-made request object, and answers through HttpConnection.send().
+ *
+ * Requests without a body are handed over once complete. For the others the
+ * request goes out as soon as the headers are in and the body follows in
+ * chunks through the onBody callback (null marks its end, an Error a failed
+ * one), as it's read. JS applies backpressure with pause() / resume().
+ *
+ * Responses are either sent whole with send(), or streamed: writeHead() then
+ * any number of write() calls and end(). Streamed bodies are chunked unless
+ * the headers say otherwise, and write() returns false once the socket's
+ * write queue is over the high water mark, the onDrain callback tells when
+ * it has gone down again. sendFile() writes the head and then a file, from
+ * the kernel with sendfile(2) while the socket takes it; when it's full one
+ * chunk is read and queued with a regular write, which tells when it's
+ * writable again.
+ *
+ * Only one request per connection is in flight at a time: once a message is
+ * complete the parser is paused and whatever follows it is kept. Pipelined
+ * requests are dispatched as soon as the previous response has been handed to
+ * libuv, without waiting for it to be written, so their responses queue up
+ * behind it in order. Reading stops while a request is in flight, or while
+ * too much is queued for a client which doesn't read its responses.
+ *
+ * Every connection has one coarse timer on the shared timing wheel: the
+ * headers timeout runs from the start of a request until its headers are in
+ * (it is not extended by reads, so trickling bytes doesn't help), the idle
+ * timeout while its body is read, and the keep-alive timeout between
+ * requests. Nothing is armed while the handler owns the request, except the
+ * idle timeout while a file is being sent.
+ */
+
+#define TJS_HTTP_READ_BUF_SIZE 65536
+
+typedef struct TJSHttpServer TJSHttpServer;
+typedef struct TJSHttpConn TJSHttpConn;
+typedef struct TJSHttpFileReq TJSHttpFileReq;
+
+struct TJSHttpConn {
+    TJSHttpServer *server;
+    TJSHttpConn *prev;
+    TJSHttpConn *next;
+    JSValue obj;
+    int closed;
+    int finalized;
+    int in_flight;
+    int writing; /* responses being written */
+    int reading;
+    int processing;
+    int process_queued;
+    int rejected;
+    int file_busy; /* the thread pool is working on the socket */
+    int close_deferred; /* until it's done */
+    int body_paused;
+    int keep_alive;
+    int is_head;
+    int no_body; /* the response has no body: HEAD, 1xx, 204, 304 */
+    int streaming; /* the response head went out through writeHead() */
+    int chunked;
+    int need_drain;
+    int http_major;
+    int http_minor;
+    uint32_t nrequests;
+    uv_tcp_t tcp;
+    llhttp_t parser;
+    TJSHttpTimer timer;
+    struct {
+        DynBuf data; /* URL, then header names and values back to back */
+        DynBuf headers; /* TJSHttpHeader entries pointing into data */
+        DynBuf body; /* received since the last chunk was handed over */
+        uint64_t body_size;
+        size_t url_len;
+        int in_field;
+        int started;
+        int in_body; /* the body is being streamed */
+        int body_done;
+        int too_large;
+        JSValue req;
+    } msg;
+    DynBuf pending;
+    DynBuf head; /* serialized by writeHead(), written with the first chunk */
+    TJSHttpFileReq *file;
+};
+
+struct TJSHttpServer {
+    JSContext *ctx;
+    TJSRuntime *qrt;
+    int closed;
+    int finalized;
+    uv_tcp_t tcp;
+    JSValue on_request;
+    JSValue on_body;
+    JSValue on_drain;
+    TJSHttpConn *conns;
+    uint32_t nconns;
+    uint32_t max_connections;
+    uint32_t max_requests;
+    uint32_t timeout; /* all timeouts in ms, 0 disables them */
+    uint32_t headers_timeout;
+    uint32_t keep_alive_timeout;
+    uint64_t max_body_size; /* 0 means no limit */
+    char *read_buf;
+};
+
+typedef struct {
+    uv_write_t req;
+    TJSHttpConn *conn;
+    DynBuf buf; /* status line, headers, chunk framing and small bodies */
+    bool last; /* ends the response */
+    TJSHttpFileReq *file; /* to send once this head is written */
+    uint32_t nchunks;
+    JSValue chunks[]; /* body chunks written in place, kept alive until done */
+} TJSHttpWriteReq;
+
+/* Bodies up to this size are copied after the head instead of being written
+ * as separate buffers. */
+#define TJS_HTTP_COALESCE_SIZE 1024
+/* Initial size of the buffer a response head is serialized into. */
+#define TJS_HTTP_HEAD_SIZE 512
+/* Body chunks which fit here are collected on the stack. */
+#define TJS_HTTP_WRITE_NBUFS 16
+/* Streamed writes report backpressure once this much is queued. */
+#define TJS_HTTP_HIGH_WATER_MARK 65536
+/* Body length passed when the response is streamed. */
+#define TJS_HTTP_UNKNOWN_LENGTH SIZE_MAX
+
+/* A file being sent by sendFile(). */
+struct TJSHttpFileReq {
+    uv_fs_t req;
+    uv_write_t write_req;
+    JSContext *ctx;
+    TJSHttpConn *conn;
+    JSValue obj; /* keeps the connection around while the thread pool has it */
+    TJSPromise result;
+    uv_file fd;
+    int64_t offset;
+    uint64_t remaining;
+    size_t nread;
+    char *buf; /* for chunks which go through a regular write */
+};
+
+/* Size of those chunks. */
+#define TJS_HTTP_FILE_CHUNK_SIZE 65536
+
+typedef struct {
+    const char *str; /* a string body, always copied */
+    size_t len;
+    uint32_t nchunks;
+    uv_buf_t *bufs;
+    uv_buf_t stack_bufs[TJS_HTTP_WRITE_NBUFS + 2];
+} TJSHttpBody;
+
+static JSClassID tjs_http_server_class_id;
+static JSClassID tjs_http_conn_class_id;
+
+static const char tjs__http_bad_request[] = "HTTP/1.1 400 Bad Request\r\n"
+                                            "Connection: close\r\n"
+                                            "Content-Length: 0\r\n"
+                                            "\r\n";
+
+static const char tjs__http_payload_too_large[] = "HTTP/1.1 413 Payload Too Large\r\n"
+                                                  "Connection: close\r\n"
+                                                  "Content-Length: 0\r\n"
+                                                  "\r\n";
+
+static const char tjs__http_request_timeout[] = "HTTP/1.1 408 Request Timeout\r\n"
+                                                "Connection: close\r\n"
+                                                "Content-Length: 0\r\n"
+                                                "\r\n";
+
+static void tjs__http_conn_process(TJSHttpConn *c, const char *data, size_t len);
+static void uv__http_write_cb(uv_write_t *req, int status);
+static void tjs__http_file_next(TJSHttpFileReq *fr, int status);
+
+
+/* Server lifetime */
+
+static void tjs__http_server_maybe_free(TJSHttpServer *s) {
+    if (s->closed && s->finalized && s->nconns == 0) {
+        tjs__free(s->read_buf);
+        tjs__free(s);
+    }
+}
+
+static void uv__http_server_close_cb(uv_handle_t *handle) {
+    TJSHttpServer *s = handle->data;
+    CHECK_NOT_NULL(s);
+    s->closed = 1;
+    tjs__http_server_maybe_free(s);
+}
+
+
+/* Connection lifetime */
+
+static void tjs__http_conn_release(JSRuntime *rt, TJSHttpConn *c) {
+    dbuf_free(&c->msg.data);
+    dbuf_free(&c->msg.headers);
+    dbuf_free(&c->msg.body);
+    dbuf_free(&c->pending);
+    dbuf_free(&c->head);
+    JS_FreeValueRT(rt, c->msg.req);
+    c->msg.req = JS_UNDEFINED;
+}
+
+static void tjs__http_conn_emit_body(TJSHttpConn *c, JSValue chunk) {
+    TJSHttpServer *s = c->server;
+    JSContext *ctx = s->ctx;
+
+    if (JS_IsFunction(ctx, s->on_body) && !JS_IsUndefined(c->obj)) {
+        JSValue args[2] = { c->obj, chunk };
+        tjs_call_handler(ctx, s->on_body, 2, args);
+    }
+    JS_FreeValue(ctx, chunk);
+}
+
+static void tjs__http_conn_body_error(TJSHttpConn *c, const char *message) {
+    JSContext *ctx = c->server->ctx;
+    JSValue error = JS_NewError(ctx);
+
+    JS_DefinePropertyValueStr(ctx, error, "message", JS_NewString(ctx, message), JS_PROP_C_W_E);
+    c->msg.in_body = 0;
+    tjs__http_conn_emit_body(c, error);
+}
+
+static void uv__http_conn_close_cb(uv_handle_t *handle) {
+    TJSHttpConn *c = handle->data;
+    CHECK_NOT_NULL(c);
+
+    TJSHttpServer *s = c->server;
+
+    /* Don't leave a body stream hanging. */
+    if (c->msg.in_body && !s->finalized) {
+        tjs__http_conn_body_error(c, "connection closed before the request body was received");
+    }
+
+    JSValue obj = c->obj;
+
+    c->closed = 1;
+    c->obj = JS_UNDEFINED;
+    c->server = NULL;
+
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        s->conns = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    }
+    s->nconns--;
+
+    if (!s->finalized) {
+        JSRuntime *rt = JS_GetRuntime(s->ctx);
+        tjs__http_conn_release(rt, c);
+        /* This might run the finalizer, which frees the connection. */
+        if (!JS_IsUndefined(obj)) {
+            JS_FreeValueRT(rt, obj);
+        } else if (c->finalized) {
+            tjs__free(c);
+        }
+    } else if (c->finalized) {
+        tjs__free(c);
+    }
+
+    tjs__http_server_maybe_free(s);
+}
+
+static void tjs__http_conn_close(TJSHttpConn *c) {
+    /* The socket's fd can't go away under sendfile(2). */
+    if (c->file_busy) {
+        if (!c->close_deferred) {
+            c->close_deferred = 1;
+            tjs__http_timer_stop(c->server->qrt, &c->timer);
+            uv_read_stop((uv_stream_t *) &c->tcp);
+            c->reading = 0;
+        }
+        return;
+    }
+
+    if (!uv_is_closing((uv_handle_t *) &c->tcp)) {
+        tjs__http_timer_stop(c->server->qrt, &c->timer);
+        uv_close((uv_handle_t *) &c->tcp, uv__http_conn_close_cb);
+    }
+}
+
+static void uv__http_reject_cb(uv_write_t *req, int status) {
+    TJSHttpConn *c = req->data;
+
+    tjs__free(req);
+    tjs__http_conn_close(c);
+}
+
+/* Write a canned error response, as far as it goes, and close. */
+static void tjs__http_conn_reject(TJSHttpConn *c, const char *response, size_t len) {
+    uv_buf_t b = uv_buf_init((char *) response, len);
+
+    if (c->writing == 0) {
+        uv_try_write((uv_stream_t *) &c->tcp, &b, 1);
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    /* Responses to earlier pipelined requests go out first. */
+    uv_write_t *req = c->rejected ? NULL : tjs__malloc(sizeof(*req));
+    if (req) {
+        req->data = c;
+        c->rejected = 1;
+        tjs__http_timer_stop(c->server->qrt, &c->timer);
+        if (uv_write(req, (uv_stream_t *) &c->tcp, &b, 1, uv__http_reject_cb) == 0) {
+            return;
+        }
+        tjs__free(req);
+    }
+    tjs__http_conn_close(c);
+}
+
+
+/* Timeouts */
+
+static void tjs__http_conn_timeout_cb(TJSHttpTimer *t) {
+    TJSHttpConn *c = (TJSHttpConn *) ((char *) t - offsetof(TJSHttpConn, timer));
+
+    /* Tell a client which got stuck half way through a request. */
+    if (c->msg.started && !c->msg.in_body) {
+        tjs__http_conn_reject(c, tjs__http_request_timeout, sizeof(tjs__http_request_timeout) - 1);
+    } else {
+        tjs__http_conn_close(c);
+    }
+}
+
+static void tjs__http_conn_set_timeout(TJSHttpConn *c, uint32_t timeout) {
+    if (timeout > 0) {
+        tjs__http_timer_start(c->server->qrt, &c->timer, timeout, tjs__http_conn_timeout_cb);
+    } else {
+        tjs__http_timer_stop(c->server->qrt, &c->timer);
+    }
+}
+
+
+/* Parser callbacks */
+
+static int tjs__http_on_message_begin(llhttp_t *parser) {
+    TJSHttpConn *c = parser->data;
+    c->msg.data.size = 0;
+    c->msg.headers.size = 0;
+    c->msg.body.size = 0;
+    c->msg.url_len = 0;
+    c->msg.in_field = 0;
+    c->msg.body_size = 0;
+    c->msg.started = 1;
+    c->msg.in_body = 0;
+    c->msg.body_done = 0;
+    c->msg.too_large = 0;
+
+    /* The first request is bound by the timeout armed on accept. */
+    if (c->nrequests > 0) {
+        tjs__http_conn_set_timeout(c, c->server->headers_timeout);
+    }
+    return 0;
+}
+
+static int tjs__http_on_url(llhttp_t *parser, const char *at, size_t length) {
+    TJSHttpConn *c = parser->data;
+    if (dbuf_put(&c->msg.data, (const uint8_t *) at, length)) {
+        return -1;
+    }
+    c->msg.url_len += length;
+    return 0;
+}
+
+static int tjs__http_on_header_field(llhttp_t *parser, const char *at, size_t length) {
+    TJSHttpConn *c = parser->data;
+    TJSHttpHeader *h;
+
+    if (!c->msg.in_field) {
+        TJSHttpHeader nh = { .name.off = c->msg.data.size };
+        if (dbuf_put(&c->msg.headers, (const uint8_t *) &nh, sizeof(nh))) {
+            return -1;
+        }
+        c->msg.in_field = 1;
+    }
+
+    h = (TJSHttpHeader *) (c->msg.headers.buf + c->msg.headers.size - sizeof(*h));
+    if (dbuf_put(&c->msg.data, (const uint8_t *) at, length)) {
+        return -1;
+    }
+    h->name.len += length;
+    return 0;
+}
+
+static int tjs__http_on_header_field_complete(llhttp_t *parser) {
+    TJSHttpConn *c = parser->data;
+    TJSHttpHeader *h = (TJSHttpHeader *) (c->msg.headers.buf + c->msg.headers.size - sizeof(*h));
+
+    /* The value (which might be empty) follows the name in the data buffer. */
+    h->value.off = c->msg.data.size;
+    c->msg.in_field = 0;
+    return 0;
+}
+
+static int tjs__http_on_header_value(llhttp_t *parser, const char *at, size_t length) {
+    TJSHttpConn *c = parser->data;
+    TJSHttpHeader *h = (TJSHttpHeader *) (c->msg.headers.buf + c->msg.headers.size - sizeof(*h));
+
+    if (dbuf_put(&c->msg.data, (const uint8_t *) at, length)) {
+        return -1;
+    }
+    h->value.len += length;
+    return 0;
+}
+
+static JSValue tjs__http_conn_new_request(TJSHttpConn *c) {
+    JSContext *ctx = c->server->ctx;
+    const char *data = (const char *) c->msg.data.buf;
+    JSValue req, headers;
+
+    req = JS_NewObject(ctx);
+    if (JS_IsException(req)) {
+        return req;
+    }
+
+    size_t nheaders = c->msg.headers.size / sizeof(TJSHttpHeader);
+    headers = tjs__http_new_headers(ctx, data, (TJSHttpHeader *) c->msg.headers.buf, nheaders);
+    if (JS_IsException(headers)) {
+        JS_FreeValue(ctx, req);
+        return headers;
+    }
+
+    JSValue method = tjs__http_method_string(ctx, llhttp_get_method(&c->parser));
+
+    JS_DefinePropertyValueStr(ctx, req, "method", method, JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "url", JS_NewStringLen(ctx, data, c->msg.url_len), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "httpVersionMajor", JS_NewInt32(ctx, c->http_major), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "httpVersionMinor", JS_NewInt32(ctx, c->http_minor), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "headers", headers, JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "hasBody", JS_NewBool(ctx, c->msg.in_body), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "keepAlive", JS_NewBool(ctx, c->keep_alive), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, req, "connection", JS_DupValue(ctx, c->obj), JS_PROP_C_W_E);
+
+    return req;
+}
+
+static int tjs__http_on_headers_complete(llhttp_t *parser) {
+    TJSHttpConn *c = parser->data;
+    TJSHttpServer *s = c->server;
+
+    c->http_major = llhttp_get_http_major(parser);
+    c->http_minor = llhttp_get_http_minor(parser);
+    c->is_head = llhttp_get_method(parser) == HTTP_HEAD;
+    c->keep_alive = llhttp_should_keep_alive(parser);
+    c->nrequests++;
+    if (s->max_requests > 0 && c->nrequests >= s->max_requests) {
+        c->keep_alive = 0;
+    }
+
+    if (!(parser->flags & F_CHUNKED) && parser->content_length == 0) {
+        return 0;
+    }
+
+    if (s->max_body_size > 0 && (parser->flags & F_CONTENT_LENGTH) && parser->content_length > s->max_body_size) {
+        c->msg.too_large = 1;
+        return -1;
+    }
+
+    /* The body is streamed, so the request goes out right away. */
+    c->msg.in_body = 1;
+    c->body_paused = 0;
+    tjs__http_conn_set_timeout(c, s->timeout);
+
+    c->msg.req = tjs__http_conn_new_request(c);
+    if (JS_IsException(c->msg.req)) {
+        c->msg.req = JS_UNDEFINED;
+        return -1;
+    }
+
+    return HPE_PAUSED;
+}
+
+static int tjs__http_on_body(llhttp_t *parser, const char *at, size_t length) {
+    TJSHttpConn *c = parser->data;
+    TJSHttpServer *s = c->server;
+
+    c->msg.body_size += length;
+    if (s->max_body_size > 0 && c->msg.body_size > s->max_body_size) {
+        c->msg.too_large = 1;
+        return -1;
+    }
+
+    if (dbuf_put(&c->msg.body, (const uint8_t *) at, length)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int tjs__http_on_message_complete(llhttp_t *parser) {
+    TJSHttpConn *c = parser->data;
+
+    c->msg.started = 0;
+    tjs__http_timer_stop(c->server->qrt, &c->timer);
+
+    if (c->msg.in_body) {
+        c->msg.body_done = 1;
+    } else {
+        c->msg.req = tjs__http_conn_new_request(c);
+        if (JS_IsException(c->msg.req)) {
+            c->msg.req = JS_UNDEFINED;
+            return -1;
+        }
+    }
+
+    /* Stop here, the rest of the buffer is parsed once the connection can take it. */
+    return HPE_PAUSED;
+}
+
+static const llhttp_settings_t tjs__http_settings = {
+    .on_message_begin = tjs__http_on_message_begin,
+    .on_url = tjs__http_on_url,
+    .on_header_field = tjs__http_on_header_field,
+    .on_header_field_complete = tjs__http_on_header_field_complete,
+    .on_header_value = tjs__http_on_header_value,
+    .on_headers_complete = tjs__http_on_headers_complete,
+    .on_body = tjs__http_on_body,
+    .on_message_complete = tjs__http_on_message_complete,
+};
+
+
+/* Reading and dispatching */
+
+static void uv__http_conn_alloc_cb(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf) {
+    TJSHttpConn *c = handle->data;
+    CHECK_NOT_NULL(c);
+
+    /* Data is always consumed (or copied) synchronously, so a single buffer is shared by all connections. */
+    buf->base = c->server->read_buf;
+    buf->len = TJS_HTTP_READ_BUF_SIZE;
+}
+
+static void tjs__http_conn_dispatch(TJSHttpConn *c) {
+    TJSHttpServer *s = c->server;
+    JSContext *ctx = s->ctx;
+    JSValue req = c->msg.req;
+
+    c->msg.req = JS_UNDEFINED;
+    c->in_flight = 1;
+    c->no_body = c->is_head;
+    c->streaming = 0;
+    c->chunked = 0;
+    c->need_drain = 0;
+
+    tjs_call_handler(ctx, s->on_request, 1, &req);
+    JS_FreeValue(ctx, req);
+}
+
+/* Hand the body received so far over to JS. */
+static void tjs__http_conn_flush_body(TJSHttpConn *c) {
+    JSContext *ctx = c->server->ctx;
+
+    if (c->msg.body.size == 0) {
+        return;
+    }
+
+    /* No copy, the buffer now belongs to the Uint8Array. */
+    JSValue chunk = TJS_NewUint8Array(ctx, c->msg.body.buf, c->msg.body.size);
+    tjs_dbuf_init(ctx, &c->msg.body);
+    if (JS_IsException(chunk)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    tjs__http_conn_emit_body(c, chunk);
+}
+
+static void tjs__http_conn_execute(TJSHttpConn *c, const char *data, size_t len) {
+    llhttp_errno_t err = llhttp_execute(&c->parser, data, len);
+
+    if (err == HPE_PAUSED) {
+        const char *pos = llhttp_get_error_pos(&c->parser);
+        size_t consumed = pos - data;
+
+        llhttp_resume(&c->parser);
+
+        if (consumed < len && dbuf_put(&c->pending, (const uint8_t *) pos, len - consumed)) {
+            tjs__http_conn_close(c);
+            return;
+        }
+    } else if (err != HPE_OK) {
+        /* Once the handler has answered there is nothing more to tell the peer. */
+        bool respond = !c->msg.in_body || c->in_flight;
+
+        if (c->msg.in_body) {
+            tjs__http_conn_body_error(c, c->msg.too_large ? "request body too large" : "invalid request body");
+        }
+
+        if (!respond) {
+            tjs__http_conn_close(c);
+        } else if (c->msg.too_large) {
+            tjs__http_conn_reject(c, tjs__http_payload_too_large, sizeof(tjs__http_payload_too_large) - 1);
+        } else {
+            tjs__http_conn_reject(c, tjs__http_bad_request, sizeof(tjs__http_bad_request) - 1);
+        }
+        return;
+    }
+
+    tjs__http_conn_flush_body(c);
+
+    if (c->msg.body_done) {
+        c->msg.body_done = 0;
+        c->msg.in_body = 0;
+        tjs__http_conn_emit_body(c, JS_NULL);
+    }
+
+    if (!JS_IsUndefined(c->msg.req)) {
+        tjs__http_conn_dispatch(c);
+    }
+}
+
+static void uv__http_conn_read_cb(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf) {
+    TJSHttpConn *c = handle->data;
+    CHECK_NOT_NULL(c);
+
+    if (nread > 0) {
+        /* Only the idle timeout is extended by activity. */
+        if (c->msg.in_body) {
+            tjs__http_conn_set_timeout(c, c->server->timeout);
+        }
+        tjs__http_conn_process(c, buf->base, nread);
+    } else if (nread < 0) {
+        tjs__http_conn_close(c);
+    }
+}
+
+/* A body is parsed as long as JS keeps up with it, the next request once the
+ * current one has been answered. Nothing follows a response which closes the
+ * connection. */
+static bool tjs__http_conn_can_parse(TJSHttpConn *c) {
+    if (uv_is_closing((uv_handle_t *) &c->tcp) || c->rejected || c->close_deferred) {
+        return false;
+    }
+    if (c->msg.in_body) {
+        return !c->body_paused;
+    }
+    if (c->in_flight || (c->writing > 0 && !c->keep_alive)) {
+        return false;
+    }
+    return c->tcp.write_queue_size < TJS_HTTP_HIGH_WATER_MARK;
+}
+
+static JSValue tjs__http_conn_process_job(JSContext *ctx, int argc, JSValue *argv) {
+    TJSHttpConn *c = JS_GetOpaque(argv[0], tjs_http_conn_class_id);
+
+    if (c && !c->closed) {
+        c->process_queued = 0;
+        tjs__http_conn_process(c, NULL, 0);
+    }
+
+    return JS_UNDEFINED;
+}
+
+/* Parse what's next once the JS code which answered the request is done, so
+ * handlers never run nested in one another. */
+static void tjs__http_conn_queue_process(TJSHttpConn *c) {
+    if (c->processing || c->process_queued || JS_IsUndefined(c->obj)) {
+        /* A running tjs__http_conn_process() picks it up. */
+        return;
+    }
+
+    c->process_queued = 1;
+    CHECK_EQ(JS_EnqueueJob(c->server->ctx, tjs__http_conn_process_job, 1, &c->obj), 0);
+}
+
+/*
+ * Parse the given data and whatever was left over as far as the connection
+ * state allows, then start or stop reading to match. Called again whenever
+ * that state changes.
+ */
+static void tjs__http_conn_process(TJSHttpConn *c, const char *data, size_t len) {
+    if (c->processing) {
+        /* Reentered from JS, the outer call takes care of it. */
+        CHECK_EQ(len, 0);
+        return;
+    }
+
+    c->processing = 1;
+
+    if (len > 0) {
+        if (c->pending.size == 0 && tjs__http_conn_can_parse(c)) {
+            tjs__http_conn_execute(c, data, len);
+        } else if (dbuf_put(&c->pending, (const uint8_t *) data, len)) {
+            tjs__http_conn_close(c);
+        }
+    }
+
+    while (c->pending.size > 0 && tjs__http_conn_can_parse(c)) {
+        DynBuf pending = c->pending;
+
+        tjs_dbuf_init(c->server->ctx, &c->pending);
+        tjs__http_conn_execute(c, (const char *) pending.buf, pending.size);
+        dbuf_free(&pending);
+    }
+
+    c->processing = 0;
+
+    if (uv_is_closing((uv_handle_t *) &c->tcp)) {
+        return;
+    }
+
+    bool read = c->pending.size == 0 && tjs__http_conn_can_parse(c);
+
+    if (read && !c->reading) {
+        if (uv_read_start((uv_stream_t *) &c->tcp, uv__http_conn_alloc_cb, uv__http_conn_read_cb) != 0) {
+            tjs__http_conn_close(c);
+            return;
+        }
+        c->reading = 1;
+    } else if (!read && c->reading) {
+        uv_read_stop((uv_stream_t *) &c->tcp);
+        c->reading = 0;
+    }
+}
+
+/* Accepting */
+
+static void uv__http_server_connection_cb(uv_stream_t *handle, int status) {
+    TJSHttpServer *s = handle->data;
+    CHECK_NOT_NULL(s);
+
+    if (status != 0) {
+        return;
+    }
+
+    JSContext *ctx = s->ctx;
+    TJSHttpConn *c = tjs__mallocz(sizeof(*c));
+    if (!c) {
+        return;
+    }
+
+    CHECK_EQ(uv_tcp_init(tjs_get_loop(ctx), &c->tcp), 0);
+    c->tcp.data = c;
+    c->server = s;
+    c->obj = JS_UNDEFINED;
+    c->finalized = 1; /* Until there is a JS object. */
+    c->msg.req = JS_UNDEFINED;
+    tjs_dbuf_init(ctx, &c->msg.data);
+    tjs_dbuf_init(ctx, &c->msg.headers);
+    tjs_dbuf_init(ctx, &c->msg.body);
+    tjs_dbuf_init(ctx, &c->pending);
+    tjs_dbuf_init(ctx, &c->head);
+    llhttp_init(&c->parser, HTTP_REQUEST, &tjs__http_settings);
+    c->parser.data = c;
+
+    c->next = s->conns;
+    if (s->conns) {
+        s->conns->prev = c;
+    }
+    s->conns = c;
+    s->nconns++;
+
+    if (uv_accept(handle, (uv_stream_t *) &c->tcp) != 0) {
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    if (s->max_connections > 0 && s->nconns > s->max_connections) {
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    JSValue obj = JS_NewObjectClass(ctx, tjs_http_conn_class_id);
+    if (JS_IsException(obj)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        tjs__http_conn_close(c);
+        return;
+    }
+    JS_SetOpaque(obj, c);
+    c->obj = obj;
+    c->finalized = 0;
+
+    uv_tcp_nodelay(&c->tcp, 1);
+
+    tjs__http_conn_set_timeout(c, s->headers_timeout);
+    tjs__http_conn_process(c, NULL, 0);
+}
+
+
+/* Writing */
+
+static int tjs__http_write_head(JSContext *ctx,
+                                TJSHttpConn *c,
+                                DynBuf *dbuf,
+                                int status,
+                                const char *status_text,
+                                JSValue headers,
+                                size_t body_len,
+                                bool send_date) {
+    TJSHttpHeadInfo info;
+
+    tjs__http_put_status_line(dbuf, status, status_text);
+
+    if (tjs__http_put_headers(ctx, dbuf, headers, &info)) {
+        return -1;
+    }
+
+    if (info.connection_close) {
+        c->keep_alive = 0;
+    }
+
+    if (send_date && !info.has_date) {
+        tjs__http_put_date(ctx, dbuf);
+    }
+
+    /* 1xx, 204 and 304 responses never carry a body. */
+    if (status < 200 || status == 204 || status == 304) {
+        c->no_body = 1;
+    } else if (info.has_transfer_encoding) {
+        c->chunked = info.chunked;
+    } else if (info.has_content_length) {
+        /* Framed by the caller. */
+    } else if (body_len != TJS_HTTP_UNKNOWN_LENGTH) {
+        dbuf_printf(dbuf, "Content-Length: %zu\r\n", body_len);
+    } else if (c->http_major > 1 || c->http_minor > 0) {
+        dbuf_putstr(dbuf, "Transfer-Encoding: chunked\r\n");
+        c->chunked = 1;
+    } else {
+        /* HTTP/1.0 peers read until the connection is closed. */
+        c->keep_alive = 0;
+    }
+
+    if (!info.has_connection) {
+        if (!c->keep_alive) {
+            dbuf_putstr(dbuf, "Connection: close\r\n");
+        } else if (c->http_major == 1 && c->http_minor == 0) {
+            dbuf_putstr(dbuf, "Connection: keep-alive\r\n");
+        }
+    }
+
+    dbuf_put(dbuf, (const uint8_t *) "\r\n", 2);
+
+    if (dbuf_error(dbuf)) {
+        JS_ThrowOutOfMemory(ctx);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void tjs__http_write_req_free(JSContext *ctx, TJSHttpWriteReq *wr) {
+    for (uint32_t i = 0; i < wr->nchunks; i++) {
+        JS_FreeValue(ctx, wr->chunks[i]);
+    }
+    dbuf_free(&wr->buf);
+    tjs__free(wr);
+}
+
+static void tjs__http_body_free(JSContext *ctx, TJSHttpBody *body) {
+    JS_FreeCString(ctx, body->str);
+    if (body->bufs != body->stack_bufs) {
+        tjs__free(body->bufs);
+    }
+}
+
+/*
+ * Start a write request for a body given as a string, a Uint8Array or an
+ * array of Uint8Array chunks. Chunks are kept alive by the request and their
+ * buffers go into bufs[1..nchunks], leaving room for the head and framing on
+ * either side.
+ */
+static TJSHttpWriteReq *tjs__http_body_collect(JSContext *ctx, JSValue val, TJSHttpBody *body) {
+    uint32_t nchunks = 0;
+    bool is_array = false;
+
+    body->str = NULL;
+    body->len = 0;
+    body->nchunks = 0;
+    body->bufs = body->stack_bufs;
+
+    if (JS_IsString(val)) {
+        body->str = JS_ToCStringLen(ctx, &body->len, val);
+        if (!body->str) {
+            return NULL;
+        }
+    } else if (JS_IsArray(val)) {
+        int64_t len;
+        if (JS_GetLength(ctx, val, &len)) {
+            return NULL;
+        }
+        if (len > INT32_MAX) {
+            JS_ThrowRangeError(ctx, "too many body chunks");
+            return NULL;
+        }
+        nchunks = len;
+        is_array = true;
+    } else if (!JS_IsUndefined(val) && !JS_IsNull(val)) {
+        nchunks = 1;
+    }
+
+    TJSHttpWriteReq *wr = tjs__mallocz(sizeof(*wr) + nchunks * sizeof(JSValue));
+    if (!wr) {
+        tjs__http_body_free(ctx, body);
+        JS_ThrowOutOfMemory(ctx);
+        return NULL;
+    }
+    tjs_dbuf_init(ctx, &wr->buf);
+
+    if (nchunks + 2 > countof(body->stack_bufs)) {
+        body->bufs = tjs__malloc((nchunks + 2) * sizeof(*body->bufs));
+        if (!body->bufs) {
+            body->bufs = body->stack_bufs;
+            tjs__http_write_req_free(ctx, wr);
+            tjs__http_body_free(ctx, body);
+            JS_ThrowOutOfMemory(ctx);
+            return NULL;
+        }
+    }
+
+    for (uint32_t i = 0; i < nchunks; i++) {
+        wr->chunks[i] = is_array ? JS_GetPropertyUint32(ctx, val, i) : JS_DupValue(ctx, val);
+        wr->nchunks++;
+
+        size_t size;
+        uint8_t *buf = JS_GetUint8Array(ctx, &size, wr->chunks[i]);
+        if (!buf) {
+            tjs__http_write_req_free(ctx, wr);
+            tjs__http_body_free(ctx, body);
+            return NULL;
+        }
+        body->bufs[i + 1] = uv_buf_init((char *) buf, size);
+        body->len += size;
+    }
+    body->nchunks = nchunks;
+
+    return wr;
+}
+
+/*
+ * Append the body to whatever the request buffer holds already (the head, or
+ * nothing) and write it all with a single uv_write. Small bodies are copied,
+ * larger ones are written in place. When the response is chunked the body is
+ * framed as one chunk, and the last write carries the terminating one.
+ *
+ * Returns 0 on success, -1 with an exception pending, or 1 if the connection
+ * is gone. The request is consumed in all cases.
+ */
+static int tjs__http_conn_submit(JSContext *ctx, TJSHttpConn *c, TJSHttpWriteReq *wr, TJSHttpBody *body, bool last) {
+    DynBuf *dbuf = &wr->buf;
+    size_t len = c->no_body ? 0 : body->len;
+    bool chunked = c->chunked && !c->no_body;
+    bool coalesce = body->str || len <= TJS_HTTP_COALESCE_SIZE;
+
+    if (chunked && len > 0) {
+        dbuf_printf(dbuf, "%zx\r\n", len);
+    }
+
+    if (len > 0 && coalesce) {
+        if (body->str) {
+            dbuf_put(dbuf, (const uint8_t *) body->str, len);
+        } else {
+            /* Cheaper to copy than to send another buffer down. */
+            for (uint32_t i = 0; i < body->nchunks; i++) {
+                dbuf_put(dbuf, (const uint8_t *) body->bufs[i + 1].base, body->bufs[i + 1].len);
+            }
+        }
+    }
+
+    size_t prefix = dbuf->size;
+
+    if (chunked && len > 0) {
+        dbuf_put(dbuf, (const uint8_t *) "\r\n", 2);
+    }
+    if (chunked && last) {
+        dbuf_put(dbuf, (const uint8_t *) "0\r\n\r\n", 5);
+    }
+
+    if (dbuf_error(dbuf)) {
+        tjs__http_write_req_free(ctx, wr);
+        JS_ThrowOutOfMemory(ctx);
+        return -1;
+    }
+
+    /* Head and framing around the chunks: one writev. */
+    uv_buf_t *bufs = body->bufs;
+    uint32_t nbufs = 1;
+
+    if (len > 0 && !coalesce) {
+        bufs[0] = uv_buf_init((char *) dbuf->buf, prefix);
+        nbufs += body->nchunks;
+        if (dbuf->size > prefix) {
+            bufs[nbufs++] = uv_buf_init((char *) dbuf->buf + prefix, dbuf->size - prefix);
+        }
+        if (prefix == 0) {
+            bufs++;
+            nbufs--;
+        }
+    } else {
+        bufs[0] = uv_buf_init((char *) dbuf->buf, dbuf->size);
+        if (dbuf->size == 0 && !last) {
+            tjs__http_write_req_free(ctx, wr);
+            return 0;
+        }
+    }
+
+    wr->req.data = wr;
+    wr->conn = c;
+    wr->last = last;
+
+    int r = uv_write(&wr->req, (uv_stream_t *) &c->tcp, bufs, nbufs, uv__http_write_cb);
+    if (r != 0) {
+        tjs__http_write_req_free(ctx, wr);
+        tjs__http_conn_close(c);
+        return 1;
+    }
+
+    if (last) {
+        c->in_flight = 0;
+        c->writing++;
+        tjs__http_conn_queue_process(c);
+    }
+
+    return 0;
+}
+
+static void uv__http_write_cb(uv_write_t *req, int status) {
+    TJSHttpWriteReq *wr = req->data;
+    TJSHttpConn *c = wr->conn;
+    TJSHttpServer *s = c->server;
+    JSContext *ctx = s->ctx;
+    bool last = wr->last;
+    TJSHttpFileReq *file = wr->file;
+
+    tjs__http_write_req_free(ctx, wr);
+
+    if (file) {
+        tjs__http_file_next(file, status);
+        return;
+    }
+
+    if (status < 0) {
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    if (!last) {
+        /* A streamed response can take more. */
+        if (c->need_drain && c->tcp.write_queue_size < TJS_HTTP_HIGH_WATER_MARK) {
+            c->need_drain = 0;
+            if (JS_IsFunction(ctx, s->on_drain) && !JS_IsUndefined(c->obj)) {
+                tjs_call_handler(ctx, s->on_drain, 1, &c->obj);
+            }
+        }
+        return;
+    }
+
+    c->writing--;
+
+    /* Pipelined requests which came after this one have been answered, or are
+     * being, with their own keep-alive decision. */
+    if (c->writing > 0 || c->in_flight) {
+        tjs__http_conn_process(c, NULL, 0);
+        return;
+    }
+
+    if (!c->keep_alive) {
+        tjs__http_conn_close(c);
+        return;
+    }
+
+    /* Unless the next request is already coming in. */
+    if (!c->msg.started) {
+        tjs__http_conn_set_timeout(c, c->server->keep_alive_timeout);
+    }
+    tjs__http_conn_process(c, NULL, 0);
+}
+
+
+/* Sending files */
+
+static void tjs__http_file_done(TJSHttpFileReq *fr, bool ok) {
+    JSContext *ctx = fr->ctx;
+    JSValue obj = fr->obj;
+    JSValue arg = JS_NewBool(ctx, ok);
+
+    fr->conn->file = NULL;
+    TJS_ResolvePromise(ctx, &fr->result, 1, &arg);
+    tjs__free(fr->buf);
+    tjs__free(fr);
+
+    /* This might free the connection. */
+    JS_FreeValue(ctx, obj);
+}
+
+static void tjs__http_file_fail(TJSHttpFileReq *fr) {
+    tjs__http_conn_close(fr->conn);
+    tjs__http_file_done(fr, false);
+}
+
+static void uv__http_file_write_cb(uv_write_t *req, int status) {
+    TJSHttpFileReq *fr = req->data;
+
+    if (status == 0) {
+        fr->offset += fr->nread;
+        fr->remaining -= fr->nread;
+    }
+    tjs__http_file_next(fr, status);
+}
+
+static void uv__http_file_read_cb(uv_fs_t *req) {
+    TJSHttpFileReq *fr = req->data;
+    TJSHttpConn *c = fr->conn;
+    ssize_t r = req->result;
+
+    uv_fs_req_cleanup(req);
+    c->file_busy = 0;
+
+    /* The file can't come up short, the head promised its length. */
+    if (c->close_deferred || r <= 0) {
+        tjs__http_file_fail(fr);
+        return;
+    }
+
+    uv_buf_t b = uv_buf_init(fr->buf, r);
+    fr->nread = r;
+    fr->write_req.data = fr;
+    if (uv_write(&fr->write_req, (uv_stream_t *) &c->tcp, &b, 1, uv__http_file_write_cb) != 0) {
+        tjs__http_file_fail(fr);
+    }
+}
+
+/* Read a chunk to send with a regular write, which waits for the socket. */
+static int tjs__http_file_read(TJSHttpFileReq *fr) {
+    if (!fr->buf) {
+        fr->buf = tjs__malloc(TJS_HTTP_FILE_CHUNK_SIZE);
+        if (!fr->buf) {
+            return UV_ENOMEM;
+        }
+    }
+
+    size_t len = fr->remaining < TJS_HTTP_FILE_CHUNK_SIZE ? fr->remaining : TJS_HTTP_FILE_CHUNK_SIZE;
+    uv_buf_t b = uv_buf_init(fr->buf, len);
+
+    fr->req.data = fr;
+    return uv_fs_read(tjs_get_loop(fr->ctx), &fr->req, fr->fd, &b, 1, fr->offset, uv__http_file_read_cb);
+}
+
+#ifndef _WIN32
+static void uv__http_file_sendfile_cb(uv_fs_t *req) {
+    TJSHttpFileReq *fr = req->data;
+    TJSHttpConn *c = fr->conn;
+    ssize_t r = req->result;
+
+    uv_fs_req_cleanup(req);
+    c->file_busy = 0;
+
+    if (c->close_deferred) {
+        tjs__http_file_fail(fr);
+        return;
+    }
+
+    /* The socket is full. */
+    if (r == UV_EAGAIN) {
+        if (tjs__http_file_read(fr) != 0) {
+            tjs__http_file_fail(fr);
+        } else {
+            c->file_busy = 1;
+        }
+        return;
+    }
+
+    if (r <= 0) {
+        tjs__http_file_fail(fr);
+        return;
+    }
+
+    fr->offset += r;
+    fr->remaining -= r;
+    tjs__http_file_next(fr, 0);
+}
+#endif
+
+static void tjs__http_file_next(TJSHttpFileReq *fr, int status) {
+    JSContext *ctx = fr->ctx;
+    TJSHttpConn *c = fr->conn;
+    int r;
+
+    if (status < 0 || uv_is_closing((uv_handle_t *) &c->tcp)) {
+        tjs__http_file_fail(fr);
+        return;
+    }
+
+    if (fr->remaining == 0) {
+        /* An empty last write, so the response ends like any other. */
+        TJSHttpBody body;
+        TJSHttpWriteReq *wr = tjs__http_body_collect(ctx, JS_UNDEFINED, &body);
+        r = -1;
+        if (wr) {
+            r = tjs__http_conn_submit(ctx, c, wr, &body, true);
+            tjs__http_body_free(ctx, &body);
+        }
+        if (r < 0) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            tjs__http_file_fail(fr);
+        } else {
+            tjs__http_file_done(fr, r == 0);
+        }
+        return;
+    }
+
+    /* A client which stops reading doesn't get to hold the file forever. */
+    tjs__http_conn_set_timeout(c, c->server->timeout);
+
+#ifdef _WIN32
+    r = tjs__http_file_read(fr);
+#else
+    uv_os_fd_t sock;
+    r = uv_fileno((uv_handle_t *) &c->tcp, &sock);
+    if (r == 0) {
+        fr->req.data = fr;
+        r = uv_fs_sendfile(tjs_get_loop(ctx),
+                           &fr->req,
+                           sock,
+                           fr->fd,
+                           fr->offset,
+                           fr->remaining,
+                           uv__http_file_sendfile_cb);
+    }
+#endif
+
+    if (r != 0) {
+        tjs__http_file_fail(fr);
+        return;
+    }
+
+    c->file_busy = 1;
+}
+
+
+/* HttpConnection object */
+
+static void tjs_http_conn_finalizer(JSRuntime *rt, JSValue val) {
+    TJSHttpConn *c = JS_GetOpaque(val, tjs_http_conn_class_id);
+    if (c) {
+        c->finalized = 1;
+        if (c->closed) {
+            tjs__free(c);
+        } else {
+            tjs__http_conn_release(rt, c);
+            tjs__http_conn_close(c);
+        }
+    }
+}
+
+static JSClassDef tjs_http_conn_class = {
+    "HttpConnection",
+    .finalizer = tjs_http_conn_finalizer,
+};
+
+static TJSHttpConn *tjs_http_conn_get(JSContext *ctx, JSValue obj) {
+    return JS_GetOpaque2(ctx, obj, tjs_http_conn_class_id);
+}
+
+/* Parse the status code and text shared by send() and writeHead(). */
+static int tjs__http_get_status(JSContext *ctx, JSValue *argv, int32_t *status, const char **status_text) {
+    if (JS_ToInt32(ctx, status, argv[0])) {
+        return -1;
+    }
+    if (*status < 100 || *status > 999) {
+        JS_ThrowRangeError(ctx, "invalid status code: %d", *status);
+        return -1;
+    }
+
+    /* Without a status text the precomputed status line is used. */
+    *status_text = NULL;
+    if (!JS_IsUndefined(argv[1])) {
+        size_t len;
+        *status_text = JS_ToCStringLen(ctx, &len, argv[1]);
+        if (!*status_text) {
+            return -1;
+        }
+        if (!tjs__http_valid_status_text(*status_text, len)) {
+            JS_FreeCString(ctx, *status_text);
+            JS_ThrowTypeError(ctx, "invalid character in status text");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static JSValue tjs_http_conn_send(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    /* The peer might be gone already, that's not an error for the handler. */
+    if (c->closed || uv_is_closing((uv_handle_t *) &c->tcp) || !c->in_flight || c->file) {
+        return JS_FALSE;
+    }
+    if (c->streaming) {
+        return JS_ThrowTypeError(ctx, "the response head was already written");
+    }
+
+    int32_t status;
+    const char *status_text;
+    if (tjs__http_get_status(ctx, argv, &status, &status_text)) {
+        return JS_EXCEPTION;
+    }
+
+    bool send_date = JS_IsUndefined(argv[4]) || JS_ToBool(ctx, argv[4]);
+
+    /* Collect the body first, the head needs the total length. */
+    TJSHttpBody body;
+    TJSHttpWriteReq *wr = tjs__http_body_collect(ctx, argv[3], &body);
+    if (!wr) {
+        JS_FreeCString(ctx, status_text);
+        return JS_EXCEPTION;
+    }
+
+    /* Size the buffer up front for the head and any body copied after it. */
+    bool coalesce = body.str || body.len <= TJS_HTTP_COALESCE_SIZE;
+    int r = 0;
+    if (dbuf_realloc(&wr->buf, TJS_HTTP_HEAD_SIZE + (coalesce ? body.len : 0))) {
+        JS_ThrowOutOfMemory(ctx);
+        r = -1;
+    }
+
+    if (r == 0) {
+        r = tjs__http_write_head(ctx, c, &wr->buf, status, status_text, argv[2], body.len, send_date);
+    }
+    JS_FreeCString(ctx, status_text);
+
+    if (r == 0) {
+        r = tjs__http_conn_submit(ctx, c, wr, &body, true);
+    } else {
+        tjs__http_write_req_free(ctx, wr);
+    }
+    tjs__http_body_free(ctx, &body);
+
+    if (r < 0) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewBool(ctx, r == 0);
+}
+
+static JSValue tjs_http_conn_write_head(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    if (c->closed || uv_is_closing((uv_handle_t *) &c->tcp) || !c->in_flight || c->file) {
+        return JS_FALSE;
+    }
+    if (c->streaming) {
+        return JS_ThrowTypeError(ctx, "the response head was already written");
+    }
+
+    int32_t status;
+    const char *status_text;
+    if (tjs__http_get_status(ctx, argv, &status, &status_text)) {
+        return JS_EXCEPTION;
+    }
+
+    bool send_date = JS_IsUndefined(argv[3]) || JS_ToBool(ctx, argv[3]);
+
+    /* Kept until the first write so both go out together. */
+    c->head.size = 0;
+    int r = tjs__http_write_head(ctx,
+                                 c,
+                                 &c->head,
+                                 status,
+                                 status_text,
+                                 argv[2],
+                                 TJS_HTTP_UNKNOWN_LENGTH,
+                                 send_date);
+    JS_FreeCString(ctx, status_text);
+    if (r != 0) {
+        return JS_EXCEPTION;
+    }
+
+    c->streaming = 1;
+
+    return JS_TRUE;
+}
+
+/* write() (magic 0) and end() (magic 1) for a response started with writeHead(). */
+static JSValue tjs_http_conn_write(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    if (c->closed || uv_is_closing((uv_handle_t *) &c->tcp) || !c->in_flight || c->file) {
+        return JS_FALSE;
+    }
+    if (!c->streaming) {
+        return JS_ThrowTypeError(ctx, "writeHead() must be called first");
+    }
+
+    TJSHttpBody body;
+    TJSHttpWriteReq *wr = tjs__http_body_collect(ctx, argv[0], &body);
+    if (!wr) {
+        return JS_EXCEPTION;
+    }
+
+    /* A pending head goes first. */
+    if (c->head.size > 0) {
+        DynBuf buf = wr->buf;
+        wr->buf = c->head;
+        c->head = buf;
+    }
+
+    int r = tjs__http_conn_submit(ctx, c, wr, &body, magic == 1);
+    tjs__http_body_free(ctx, &body);
+
+    if (r != 0) {
+        return r < 0 ? JS_EXCEPTION : JS_FALSE;
+    }
+
+    if (magic == 1) {
+        return JS_TRUE;
+    }
+
+    /* Like Node's write(): false means wait for the drain callback. */
+    if (c->tcp.write_queue_size >= TJS_HTTP_HIGH_WATER_MARK) {
+        c->need_drain = 1;
+        return JS_FALSE;
+    }
+
+    return JS_TRUE;
+}
+
+/*
+ * sendFile(status, statusText, headers, sendDate, fd, offset, length) writes
+ * the head and then length bytes of the file from offset. Resolves to false
+ * if the connection went away before all of it was sent.
+ */
+static JSValue tjs_http_conn_send_file(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    if (c->closed || uv_is_closing((uv_handle_t *) &c->tcp) || !c->in_flight || c->file) {
+        JSValue arg = JS_FALSE;
+        return TJS_NewResolvedPromise(ctx, 1, &arg);
+    }
+    if (c->streaming) {
+        return JS_ThrowTypeError(ctx, "the response head was already written");
+    }
+
+    int32_t fd;
+    int64_t offset, length;
+    if (JS_ToInt32(ctx, &fd, argv[4]) || JS_ToInt64(ctx, &offset, argv[5]) || JS_ToInt64(ctx, &length, argv[6])) {
+        return JS_EXCEPTION;
+    }
+    if (offset < 0 || length < 0) {
+        return JS_ThrowRangeError(ctx, "invalid file range");
+    }
+
+    int32_t status;
+    const char *status_text;
+    if (tjs__http_get_status(ctx, argv, &status, &status_text)) {
+        return JS_EXCEPTION;
+    }
+
+    bool send_date = JS_IsUndefined(argv[3]) || JS_ToBool(ctx, argv[3]);
+
+    TJSHttpBody body;
+    TJSHttpWriteReq *wr = tjs__http_body_collect(ctx, JS_UNDEFINED, &body);
+    if (!wr) {
+        JS_FreeCString(ctx, status_text);
+        return JS_EXCEPTION;
+    }
+
+    int r = 0;
+    if (dbuf_realloc(&wr->buf, TJS_HTTP_HEAD_SIZE)) {
+        JS_ThrowOutOfMemory(ctx);
+        r = -1;
+    }
+    if (r == 0) {
+        r = tjs__http_write_head(ctx, c, &wr->buf, status, status_text, argv[2], length, send_date);
+    }
+    JS_FreeCString(ctx, status_text);
+
+    /* The file goes out as is, there is no framing it. */
+    if (r == 0 && c->chunked && !c->no_body) {
+        JS_ThrowTypeError(ctx, "a file can't be sent with chunked encoding");
+        r = -1;
+    }
+
+    if (r != 0) {
+        tjs__http_write_req_free(ctx, wr);
+        tjs__http_body_free(ctx, &body);
+        return JS_EXCEPTION;
+    }
+
+    /* Nothing to send after the head. */
+    if (c->no_body || length == 0) {
+        r = tjs__http_conn_submit(ctx, c, wr, &body, true);
+        tjs__http_body_free(ctx, &body);
+        if (r < 0) {
+            return JS_EXCEPTION;
+        }
+        JSValue arg = JS_NewBool(ctx, r == 0);
+        return TJS_NewResolvedPromise(ctx, 1, &arg);
+    }
+
+    TJSHttpFileReq *fr = tjs__mallocz(sizeof(*fr));
+    if (!fr) {
+        tjs__http_write_req_free(ctx, wr);
+        tjs__http_body_free(ctx, &body);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    JSValue promise = TJS_InitPromise(ctx, &fr->result);
+    if (JS_IsException(promise)) {
+        tjs__free(fr);
+        tjs__http_write_req_free(ctx, wr);
+        tjs__http_body_free(ctx, &body);
+        return promise;
+    }
+
+    fr->ctx = ctx;
+    fr->conn = c;
+    fr->obj = JS_DupValue(ctx, c->obj);
+    fr->fd = fd;
+    fr->offset = offset;
+    fr->remaining = length;
+    c->file = fr;
+
+    /* The file follows once the head is written. */
+    wr->file = fr;
+    r = tjs__http_conn_submit(ctx, c, wr, &body, false);
+    tjs__http_body_free(ctx, &body);
+    if (r != 0) {
+        if (r < 0) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+        tjs__http_file_fail(fr);
+    }
+
+    return promise;
+}
+
+static JSValue tjs_http_conn_write_queue_size_get(JSContext *ctx, JSValue this_val) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewInt64(ctx, c->closed ? 0 : c->tcp.write_queue_size);
+}
+
+static JSValue tjs_http_conn_close(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    if (!c->closed) {
+        tjs__http_conn_close(c);
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_conn_pause_resume(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+
+    if (c->closed || uv_is_closing((uv_handle_t *) &c->tcp)) {
+        return JS_UNDEFINED;
+    }
+
+    c->body_paused = magic == 0;
+
+    /* Waiting on JS doesn't count as idle. */
+    if (c->msg.in_body) {
+        tjs__http_conn_set_timeout(c, c->body_paused ? 0 : c->server->timeout);
+    }
+
+    tjs__http_conn_process(c, NULL, 0);
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_conn_getsockpeername(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSHttpConn *c = tjs_http_conn_get(ctx, this_val);
+    if (!c) {
+        return JS_EXCEPTION;
+    }
+    if (c->closed) {
+        return tjs_throw_errno(ctx, UV_EBADF);
+    }
+
+    int r;
+    int namelen;
+    struct sockaddr_storage addr;
+    namelen = sizeof(addr);
+    if (magic == 0) {
+        r = uv_tcp_getsockname(&c->tcp, (struct sockaddr *) &addr, &namelen);
+    } else {
+        r = uv_tcp_getpeername(&c->tcp, (struct sockaddr *) &addr, &namelen);
+    }
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
+    tjs_addr2obj(ctx, obj, (struct sockaddr *) &addr, false);
+    return obj;
+}
+
+
+/* HttpServer object */
+
+static void tjs__http_server_close(TJSHttpServer *s) {
+    for (TJSHttpConn *c = s->conns; c; c = c->next) {
+        tjs__http_conn_close(c);
+    }
+    if (!uv_is_closing((uv_handle_t *) &s->tcp)) {
+        uv_close((uv_handle_t *) &s->tcp, uv__http_server_close_cb);
+    }
+}
+
+static void tjs_http_server_finalizer(JSRuntime *rt, JSValue val) {
+    TJSHttpServer *s = JS_GetOpaque(val, tjs_http_server_class_id);
+    if (s) {
+        JS_FreeValueRT(rt, s->on_request);
+        s->on_request = JS_UNDEFINED;
+        JS_FreeValueRT(rt, s->on_body);
+        s->on_body = JS_UNDEFINED;
+        JS_FreeValueRT(rt, s->on_drain);
+        s->on_drain = JS_UNDEFINED;
+        for (TJSHttpConn *c = s->conns; c; c = c->next) {
+            JSValue obj = c->obj;
+            c->obj = JS_UNDEFINED;
+            tjs__http_conn_release(rt, c);
+            JS_FreeValueRT(rt, obj);
+        }
+        s->finalized = 1;
+        tjs__http_server_close(s);
+        tjs__http_server_maybe_free(s);
+    }
+}
+
+static void tjs_http_server_mark(JSRuntime *rt, JSValue val, JS_MarkFunc *mark_func) {
+    TJSHttpServer *s = JS_GetOpaque(val, tjs_http_server_class_id);
+    if (s) {
+        JS_MarkValue(rt, s->on_request, mark_func);
+        JS_MarkValue(rt, s->on_body, mark_func);
+        JS_MarkValue(rt, s->on_drain, mark_func);
+        for (TJSHttpConn *c = s->conns; c; c = c->next) {
+            JS_MarkValue(rt, c->obj, mark_func);
+        }
+    }
+}
+
+static JSClassDef tjs_http_server_class = {
+    "HttpServer",
+    .finalizer = tjs_http_server_finalizer,
+    .gc_mark = tjs_http_server_mark,
+};
+
+static JSValue tjs_http_server_constructor(JSContext *ctx, JSValue new_target, int argc, JSValue *argv) {
+    TJSHttpServer *s;
+    JSValue obj;
+    int r;
+
+    TJS_CHECK_ARG_RET(ctx, JS_IsFunction(ctx, argv[0]), 0, "a function");
+    TJS_CHECK_ARG_RET(ctx, JS_IsUndefined(argv[1]) || JS_IsFunction(ctx, argv[1]), 1, "a function");
+    TJS_CHECK_ARG_RET(ctx, JS_IsUndefined(argv[2]) || JS_IsFunction(ctx, argv[2]), 2, "a function");
+
+    obj = JS_NewObjectClass(ctx, tjs_http_server_class_id);
+    if (JS_IsException(obj)) {
+        return obj;
+    }
+
+    s = tjs__mallocz(sizeof(*s));
+    if (!s) {
+        JS_FreeValue(ctx, obj);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    s->read_buf = tjs__malloc(TJS_HTTP_READ_BUF_SIZE);
+    if (!s->read_buf) {
+        JS_FreeValue(ctx, obj);
+        tjs__free(s);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    r = uv_tcp_init_ex(tjs_get_loop(ctx), &s->tcp, AF_UNSPEC);
+    if (r != 0) {
+        JS_FreeValue(ctx, obj);
+        tjs__free(s->read_buf);
+        tjs__free(s);
+        return JS_ThrowInternalError(ctx, "couldn't initialize TCP handle");
+    }
+
+    s->ctx = ctx;
+    s->qrt = TJS_GetRuntime(ctx);
+    s->tcp.data = s;
+    s->on_request = JS_DupValue(ctx, argv[0]);
+    s->on_body = JS_DupValue(ctx, argv[1]);
+    s->on_drain = JS_DupValue(ctx, argv[2]);
+
+    JS_SetOpaque(obj, s);
+    return obj;
+}
+
+static TJSHttpServer *tjs_http_server_get(JSContext *ctx, JSValue obj) {
+    return JS_GetOpaque2(ctx, obj, tjs_http_server_class_id);
+}
+
+static JSValue tjs_http_server_bind(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    struct sockaddr_storage ss;
+    int r;
+    r = tjs_obj2addr(ctx, argv[0], &ss);
+    if (r != 0) {
+        return JS_EXCEPTION;
+    }
+
+    int flags = 0;
+    if (!JS_IsUndefined(argv[1]) && JS_ToInt32(ctx, &flags, argv[1])) {
+        return JS_EXCEPTION;
+    }
+
+    r = uv_tcp_bind(&s->tcp, (struct sockaddr *) &ss, flags);
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_server_listen(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    uint32_t backlog = 511;
+    if (!JS_IsUndefined(argv[0])) {
+        if (JS_ToUint32(ctx, &backlog, argv[0])) {
+            return JS_EXCEPTION;
+        }
+    }
+
+    int r = uv_listen((uv_stream_t *) &s->tcp, (int) backlog, uv__http_server_connection_cb);
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_server_close(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    tjs__http_server_close(s);
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_server_getsockname(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    int r;
+    int namelen;
+    struct sockaddr_storage addr;
+    namelen = sizeof(addr);
+    r = uv_tcp_getsockname(&s->tcp, (struct sockaddr *) &addr, &namelen);
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
+    tjs_addr2obj(ctx, obj, (struct sockaddr *) &addr, false);
+    return obj;
+}
+
+static JSValue tjs_http_server_connections_get(JSContext *ctx, JSValue this_val) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewUint32(ctx, s->nconns);
+}
+
+static JSValue tjs_http_server_limit_get(JSContext *ctx, JSValue this_val, int magic) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    switch (magic) {
+        case 0:
+            return JS_NewUint32(ctx, s->max_connections);
+        case 1:
+            return JS_NewUint32(ctx, s->max_requests);
+        case 2:
+            return JS_NewUint32(ctx, s->timeout);
+        case 3:
+            return JS_NewUint32(ctx, s->headers_timeout);
+        default:
+            return JS_NewUint32(ctx, s->keep_alive_timeout);
+    }
+}
+
+static JSValue tjs_http_server_limit_set(JSContext *ctx, JSValue this_val, JSValue value, int magic) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    uint32_t v;
+    if (JS_ToUint32(ctx, &v, value)) {
+        return JS_EXCEPTION;
+    }
+
+    switch (magic) {
+        case 0:
+            s->max_connections = v;
+            break;
+        case 1:
+            s->max_requests = v;
+            break;
+        case 2:
+            s->timeout = v;
+            break;
+        case 3:
+            s->headers_timeout = v;
+            break;
+        default:
+            s->keep_alive_timeout = v;
+            break;
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_http_server_max_body_size_get(JSContext *ctx, JSValue this_val) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewInt64(ctx, s->max_body_size);
+}
+
+static JSValue tjs_http_server_max_body_size_set(JSContext *ctx, JSValue this_val, JSValue value) {
+    TJSHttpServer *s = tjs_http_server_get(ctx, this_val);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    int64_t v;
+    if (JS_ToInt64(ctx, &v, value)) {
+        return JS_EXCEPTION;
+    }
+
+    s->max_body_size = v > 0 ? v : 0;
+
+    return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry tjs_http_server_proto_funcs[] = {
+    TJS_CFUNC_DEF("bind", 2, tjs_http_server_bind),
+    TJS_CFUNC_DEF("listen", 1, tjs_http_server_listen),
+    TJS_CFUNC_DEF("close", 0, tjs_http_server_close),
+    TJS_CFUNC_DEF("getsockname", 0, tjs_http_server_getsockname),
+    TJS_CGETSET_DEF("connections", tjs_http_server_connections_get, NULL),
+    JS_CGETSET_MAGIC_DEF("maxConnections", tjs_http_server_limit_get, tjs_http_server_limit_set, 0),
+    JS_CGETSET_MAGIC_DEF("maxRequestsPerSocket", tjs_http_server_limit_get, tjs_http_server_limit_set, 1),
+    JS_CGETSET_MAGIC_DEF("timeout", tjs_http_server_limit_get, tjs_http_server_limit_set, 2),
+    JS_CGETSET_MAGIC_DEF("headersTimeout", tjs_http_server_limit_get, tjs_http_server_limit_set, 3),
+    JS_CGETSET_MAGIC_DEF("keepAliveTimeout", tjs_http_server_limit_get, tjs_http_server_limit_set, 4),
+    TJS_CGETSET_DEF("maxBodySize", tjs_http_server_max_body_size_get, tjs_http_server_max_body_size_set),
+};
+
+static const JSCFunctionListEntry tjs_http_conn_proto_funcs[] = {
+    TJS_CFUNC_DEF("send", 5, tjs_http_conn_send),
+    TJS_CFUNC_DEF("writeHead", 4, tjs_http_conn_write_head),
+    JS_CFUNC_MAGIC_DEF("write", 1, tjs_http_conn_write, 0),
+    JS_CFUNC_MAGIC_DEF("end", 1, tjs_http_conn_write, 1),
+    TJS_CFUNC_DEF("sendFile", 7, tjs_http_conn_send_file),
+    TJS_CGETSET_DEF("writeQueueSize", tjs_http_conn_write_queue_size_get, NULL),
+    TJS_CFUNC_DEF("close", 0, tjs_http_conn_close),
+    JS_CFUNC_MAGIC_DEF("pause", 0, tjs_http_conn_pause_resume, 0),
+    JS_CFUNC_MAGIC_DEF("resume", 0, tjs_http_conn_pause_resume, 1),
+    JS_CFUNC_MAGIC_DEF("getsockname", 0, tjs_http_conn_getsockpeername, 0),
+    JS_CFUNC_MAGIC_DEF("getpeername", 0, tjs_http_conn_getsockpeername, 1),
+};
+
+void tjs__mod_httpserver_init(JSContext *ctx, JSValue ns) {
+    JSRuntime *rt = JS_GetRuntime(ctx);
+    JSValue proto, obj;
+
+    /* HttpServer class */
+    JS_NewClassID(rt, &tjs_http_server_class_id);
+    JS_NewClass(rt, tjs_http_server_class_id, &tjs_http_server_class);
+    proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, proto, tjs_http_server_proto_funcs, countof(tjs_http_server_proto_funcs));
+    JS_SetClassProto(ctx, tjs_http_server_class_id, proto);
+
+    /* HttpServer object */
+    obj = JS_NewCFunction2(ctx, tjs_http_server_constructor, "HttpServer", 3, JS_CFUNC_constructor, 0);
+    JS_DefinePropertyValueStr(ctx, ns, "HttpServer", obj, JS_PROP_C_W_E);
+
+    /* HttpConnection class, only created internally */
+    JS_NewClassID(rt, &tjs_http_conn_class_id);
+    JS_NewClass(rt, tjs_http_conn_class_id, &tjs_http_conn_class);
+    proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, proto, tjs_http_conn_proto_funcs, countof(tjs_http_conn_proto_funcs));
+    JS_SetClassProto(ctx, tjs_http_conn_class_id, proto);
+}
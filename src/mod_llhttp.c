@@ -23,6 +23,7 @@
  */
 
 #include "../deps/llhttp/include/llhttp.h"
+#include "http-utils.h"
 #include "private.h"
 #include "tjs.h"
 #include "utils.h"
@@ -34,40 +35,51 @@
 
 static JSClassID tjs_llhttp_class_id;
 
-/* HTTP parse result */
+/* HTTP parse result
+ *
+ * All the message text (method, URL, status text, header names and values) is
+ * appended to a single arena and referenced by offset, so parsing a message
+ * does no per-header allocations once the buffers have grown. The buffers are
+ * only emptied on reset() or when a new message begins, never freed. Headers
+ * are turned into JS values only when getResult() / getRawHeaders() is called.
+ *
+ * A buffer may hold several pipelined messages. Each one but the last is
+ * turned into a result object before the next one begins and queued for
+ * getResults().
+ */
 typedef struct {
-    char *method;
-    char *url;
-    char *status;
-    char *body;
-    size_t body_len;
-    JSValue headers;
+    DynBuf arena;
+    DynBuf headers; /* TJSHttpHeader entries */
+    DynBuf body; /* whole body, or what's not yet handed to onBody */
+    uint64_t body_size;
+    TJSHttpSpan method;
+    TJSHttpSpan url;
+    TJSHttpSpan status;
     int status_code;
     int http_major;
     int http_minor;
     int message_complete;
-    
-    /* Temporary buffers for parsing */
-    char *current_header_field;
-    char *current_header_value;
-    char *body_buffer;
-    size_t body_capacity;
-    
-    /* Header parsing state */
-    int last_was_field;  /* 1 if last callback was header_field, 0 if header_value */
+    int taken; /* already returned by getResults() */
+    int in_field; /* 1 while a header name is being received */
 } TJSLlhttpResult;
 
 typedef struct {
     JSContext *ctx;
     llhttp_t parser;
     llhttp_settings_t settings;
-    JSValue js_this;
     TJSLlhttpResult result;
+    JSValue on_body;
+    JSValue results; /* complete messages not yet returned, or undefined */
+    uint32_t nresults;
+    uint64_t max_body_size; /* 0 means no limit */
 } TJSLlhttp;
 
 /* Forward declarations */
 static void tjs__llhttp_reset_result(TJSLlhttp *s);
+static JSValue tjs__llhttp_new_result(JSContext *ctx, TJSLlhttp *s);
 static JSValue tjs_llhttp_get_result(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue tjs_llhttp_get_results(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue tjs_llhttp_get_raw_headers(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
 static void tjs__llhttp_init_callbacks(TJSLlhttp *s);
 
 /* HTTP parsing callbacks */
@@ -76,6 +88,7 @@ static int tjs__llhttp_on_url(llhttp_t* parser, const char *at, size_t length);
 static int tjs__llhttp_on_status(llhttp_t* parser, const char *at, size_t length);
 static int tjs__llhttp_on_method(llhttp_t* parser, const char *at, size_t length);
 static int tjs__llhttp_on_header_field(llhttp_t* parser, const char *at, size_t length);
+static int tjs__llhttp_on_header_field_complete(llhttp_t* parser);
 static int tjs__llhttp_on_header_value(llhttp_t* parser, const char *at, size_t length);
 static int tjs__llhttp_on_headers_complete(llhttp_t* parser);
 static int tjs__llhttp_on_body(llhttp_t* parser, const char *at, size_t length);
@@ -84,56 +97,42 @@ static int tjs__llhttp_on_message_complete(llhttp_t* parser);
 static void tjs__llhttp_finalizer(JSRuntime *rt, JSValue val) {
     TJSLlhttp *s = JS_GetOpaque(val, tjs_llhttp_class_id);
     if (s) {
-        tjs__llhttp_reset_result(s);
-        JS_FreeValueRT(rt, s->js_this);
+        dbuf_free(&s->result.arena);
+        dbuf_free(&s->result.headers);
+        dbuf_free(&s->result.body);
+        JS_FreeValueRT(rt, s->on_body);
+        JS_FreeValueRT(rt, s->results);
         free(s);
     }
 }
 
+static void tjs__llhttp_mark(JSRuntime *rt, JSValue val, JS_MarkFunc *mark_func) {
+    TJSLlhttp *s = JS_GetOpaque(val, tjs_llhttp_class_id);
+    if (s) {
+        JS_MarkValue(rt, s->on_body, mark_func);
+        JS_MarkValue(rt, s->results, mark_func);
+    }
+}
+
 static void tjs__llhttp_reset_result(TJSLlhttp *s) {
     if (!s) {
         return;
     }
 
-    if (s->result.method) {
-        free(s->result.method);
-        s->result.method = NULL;
-    }
-    if (s->result.url) {
-        free(s->result.url);
-        s->result.url = NULL;
-    }
-    if (s->result.status) {
-        free(s->result.status);
-        s->result.status = NULL;
-    }
-    if (s->result.body) {
-        free(s->result.body);
-        s->result.body = NULL;
-    }
-    if (s->result.current_header_field) {
-        free(s->result.current_header_field);
-        s->result.current_header_field = NULL;
-    }
-    if (s->result.current_header_value) {
-        free(s->result.current_header_value);
-        s->result.current_header_value = NULL;
-    }
-    if (s->result.body_buffer) {
-        free(s->result.body_buffer);
-        s->result.body_buffer = NULL;
-    }
-    if (!JS_IsUndefined(s->result.headers)) {
-        JS_FreeValue(s->ctx, s->result.headers);
-        s->result.headers = JS_UNDEFINED;
-    }
-    s->result.body_len = 0;
-    s->result.body_capacity = 0;
+    /* Keep the memory around for the next message. */
+    s->result.arena.size = 0;
+    s->result.headers.size = 0;
+    s->result.body.size = 0;
+    s->result.body_size = 0;
+    memset(&s->result.method, 0, sizeof(s->result.method));
+    memset(&s->result.url, 0, sizeof(s->result.url));
+    memset(&s->result.status, 0, sizeof(s->result.status));
     s->result.status_code = 0;
     s->result.http_major = 0;
     s->result.http_minor = 0;
     s->result.message_complete = 0;
-    s->result.last_was_field = 0;
+    s->result.taken = 0;
+    s->result.in_field = 0;
 }
 
 static void tjs__llhttp_init_callbacks(TJSLlhttp *s) {
@@ -145,150 +144,88 @@ static void tjs__llhttp_init_callbacks(TJSLlhttp *s) {
     s->settings.on_status = tjs__llhttp_on_status;
     s->settings.on_method = tjs__llhttp_on_method;
     s->settings.on_header_field = tjs__llhttp_on_header_field;
+    s->settings.on_header_field_complete = tjs__llhttp_on_header_field_complete;
     s->settings.on_header_value = tjs__llhttp_on_header_value;
     s->settings.on_headers_complete = tjs__llhttp_on_headers_complete;
     s->settings.on_body = tjs__llhttp_on_body;
     s->settings.on_message_complete = tjs__llhttp_on_message_complete;
 }
 
+/* Append a fragment to the arena. Fragments of the same span always arrive
+ * back to back, so the span just grows. */
+static int tjs__llhttp_span_append(TJSLlhttp *s, TJSHttpSpan *span, const char *at, size_t length) {
+    if (span->len == 0) {
+        span->off = s->result.arena.size;
+    }
+    if (dbuf_put(&s->result.arena, (const uint8_t *) at, length)) {
+        return -1;
+    }
+    span->len += length;
+    return 0;
+}
+
+static TJSHttpHeader *tjs__llhttp_last_header(TJSLlhttp *s) {
+    return (TJSHttpHeader *) (s->result.headers.buf + s->result.headers.size - sizeof(TJSHttpHeader));
+}
+
+static JSValue tjs__llhttp_span_to_string(JSContext *ctx, TJSLlhttp *s, TJSHttpSpan *span) {
+    return JS_NewStringLen(ctx, (const char *) s->result.arena.buf + span->off, span->len);
+}
+
 /* Callback implementations */
 static int tjs__llhttp_on_message_begin(llhttp_t* parser) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
     tjs__llhttp_reset_result(s);
-    s->result.headers = JS_NewObject(s->ctx);
     return 0;
 }
 
 static int tjs__llhttp_on_url(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    if (s->result.url) {
-        size_t old_len = strlen(s->result.url);
-        char *new_url = realloc(s->result.url, old_len + length + 1);
-        if (!new_url) return -1;
-        s->result.url = new_url;
-        memcpy(s->result.url + old_len, at, length);
-        s->result.url[old_len + length] = '\0';
-    } else {
-        s->result.url = malloc(length + 1);
-        if (!s->result.url) return -1;
-        memcpy(s->result.url, at, length);
-        s->result.url[length] = '\0';
-    }
-    return 0;
+    return tjs__llhttp_span_append(s, &s->result.url, at, length);
 }
 
 static int tjs__llhttp_on_status(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    if (s->result.status) {
-        size_t old_len = strlen(s->result.status);
-        char *new_status = realloc(s->result.status, old_len + length + 1);
-        if (!new_status) return -1;
-        s->result.status = new_status;
-        memcpy(s->result.status + old_len, at, length);
-        s->result.status[old_len + length] = '\0';
-    } else {
-        s->result.status = malloc(length + 1);
-        if (!s->result.status) return -1;
-        memcpy(s->result.status, at, length);
-        s->result.status[length] = '\0';
-    }
-    return 0;
+    return tjs__llhttp_span_append(s, &s->result.status, at, length);
 }
 
 static int tjs__llhttp_on_method(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    if (s->result.method) {
-        size_t old_len = strlen(s->result.method);
-        char *new_method = realloc(s->result.method, old_len + length + 1);
-        if (!new_method) return -1;
-        s->result.method = new_method;
-        memcpy(s->result.method + old_len, at, length);
-        s->result.method[old_len + length] = '\0';
-    } else {
-        s->result.method = malloc(length + 1);
-        if (!s->result.method) return -1;
-        memcpy(s->result.method, at, length);
-        s->result.method[length] = '\0';
-    }
-    return 0;
+    return tjs__llhttp_span_append(s, &s->result.method, at, length);
 }
 
 static int tjs__llhttp_on_header_field(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
     
-    /* If this is a new header field (after a value), save the previous header */
-    if (!s->result.last_was_field && s->result.current_header_field && s->result.current_header_value) {
-        JS_SetPropertyStr(s->ctx, s->result.headers, s->result.current_header_field, 
-                         JS_NewString(s->ctx, s->result.current_header_value));
-        free(s->result.current_header_field);
-        free(s->result.current_header_value);
-        s->result.current_header_field = NULL;
-        s->result.current_header_value = NULL;
+    /* First fragment of a new header */
+    if (!s->result.in_field) {
+        TJSHttpHeader h = { 0 };
+        if (dbuf_put(&s->result.headers, (const uint8_t *) &h, sizeof(h))) {
+            return -1;
+        }
+        s->result.in_field = 1;
     }
     
-    /* Append to current header field or create new one */
-    if (s->result.current_header_field && s->result.last_was_field) {
-        /* Continue building the same field */
-        size_t old_len = strlen(s->result.current_header_field);
-        char *new_field = realloc(s->result.current_header_field, old_len + length + 1);
-        if (!new_field) return -1;
-        s->result.current_header_field = new_field;
-        memcpy(s->result.current_header_field + old_len, at, length);
-        s->result.current_header_field[old_len + length] = '\0';
-    } else {
-        /* Start new field */
-        s->result.current_header_field = malloc(length + 1);
-        if (!s->result.current_header_field) return -1;
-        memcpy(s->result.current_header_field, at, length);
-        s->result.current_header_field[length] = '\0';
-    }
+    return tjs__llhttp_span_append(s, &tjs__llhttp_last_header(s)->name, at, length);
+}
+
+static int tjs__llhttp_on_header_field_complete(llhttp_t* parser) {
+    TJSLlhttp *s = (TJSLlhttp*)parser->data;
     
-    s->result.last_was_field = 1;
+    /* Empty values get no on_header_value call, point them at the end of the arena. */
+    tjs__llhttp_last_header(s)->value.off = s->result.arena.size;
+    s->result.in_field = 0;
     return 0;
 }
 
 static int tjs__llhttp_on_header_value(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    if (s->result.current_header_value && !s->result.last_was_field) {
-        /* Continue building the same value */
-        size_t old_len = strlen(s->result.current_header_value);
-        char *new_value = realloc(s->result.current_header_value, old_len + length + 1);
-        if (!new_value) return -1;
-        s->result.current_header_value = new_value;
-        memcpy(s->result.current_header_value + old_len, at, length);
-        s->result.current_header_value[old_len + length] = '\0';
-    } else {
-        /* Start new value */
-        if (s->result.current_header_value) {
-            free(s->result.current_header_value);
-        }
-        s->result.current_header_value = malloc(length + 1);
-        if (!s->result.current_header_value) return -1;
-        memcpy(s->result.current_header_value, at, length);
-        s->result.current_header_value[length] = '\0';
-    }
-    
-    s->result.last_was_field = 0;
-    return 0;
+    return tjs__llhttp_span_append(s, &tjs__llhttp_last_header(s)->value, at, length);
 }
 
 static int tjs__llhttp_on_headers_complete(llhttp_t* parser) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
     
-    /* Save the last header if any */
-    if (s->result.current_header_field && s->result.current_header_value) {
-        JS_SetPropertyStr(s->ctx, s->result.headers, s->result.current_header_field, 
-                         JS_NewString(s->ctx, s->result.current_header_value));
-        free(s->result.current_header_field);
-        free(s->result.current_header_value);
-        s->result.current_header_field = NULL;
-        s->result.current_header_value = NULL;
-    }
-    
     /* Store parser state */
     s->result.status_code = llhttp_get_status_code(parser);
     s->result.http_major = llhttp_get_http_major(parser);
@@ -299,49 +236,32 @@ static int tjs__llhttp_on_headers_complete(llhttp_t* parser) {
 
 static int tjs__llhttp_on_body(llhttp_t* parser, const char *at, size_t length) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    /* Expand body buffer if needed */
-    if (s->result.body_len + length > s->result.body_capacity) {
-        size_t new_capacity = s->result.body_capacity * 2;
-        if (new_capacity < s->result.body_len + length) {
-            new_capacity = s->result.body_len + length;
-        }
-        if (new_capacity < 1024) {
-            new_capacity = 1024;
-        }
-        
-        char *new_buffer = realloc(s->result.body_buffer, new_capacity);
-        if (!new_buffer) return -1;
-        s->result.body_buffer = new_buffer;
-        s->result.body_capacity = new_capacity;
+
+    s->result.body_size += length;
+    if (s->max_body_size > 0 && s->result.body_size > s->max_body_size) {
+        llhttp_set_error_reason(parser, "Body exceeds maxBodySize");
+        return HPE_USER;
+    }
+
+    if (dbuf_put(&s->result.body, (const uint8_t *) at, length)) {
+        return -1;
     }
-    
-    /* Append to body */
-    memcpy(s->result.body_buffer + s->result.body_len, at, length);
-    s->result.body_len += length;
     
     return 0;
 }
 
 static int tjs__llhttp_on_message_complete(llhttp_t* parser) {
     TJSLlhttp *s = (TJSLlhttp*)parser->data;
-    
-    /* Finalize body */
-    if (s->result.body_len > 0 && s->result.body_buffer) {
-        s->result.body = malloc(s->result.body_len + 1);
-        if (s->result.body) {
-            memcpy(s->result.body, s->result.body_buffer, s->result.body_len);
-            s->result.body[s->result.body_len] = '\0';
-        }
-    }
-    
     s->result.message_complete = 1;
-    return 0;
+
+    /* Stop so the result can be saved if another message follows. */
+    return HPE_PAUSED;
 }
 
 static JSClassDef tjs_llhttp_class = {
     "Llhttp",
     .finalizer = tjs__llhttp_finalizer,
+    .gc_mark = tjs__llhttp_mark,
 };
 
 static JSValue tjs_llhttp_constructor(JSContext *ctx, JSValueConst new_target, int argc, JSValueConst *argv) {
@@ -351,8 +271,11 @@ static JSValue tjs_llhttp_constructor(JSContext *ctx, JSValueConst new_target, i
     }
 
     s->ctx = ctx;
-    s->js_this = JS_UNDEFINED;
-    s->result.headers = JS_UNDEFINED;
+    s->on_body = JS_UNDEFINED;
+    s->results = JS_UNDEFINED;
+    tjs_dbuf_init(ctx, &s->result.arena);
+    tjs_dbuf_init(ctx, &s->result.headers);
+    tjs_dbuf_init(ctx, &s->result.body);
 
     llhttp_settings_init(&s->settings);
     tjs__llhttp_init_callbacks(s);
@@ -386,17 +309,62 @@ static JSValue tjs_llhttp_constructor(JSContext *ctx, JSValueConst new_target, i
     }
 
     JS_SetOpaque(obj, s);
-    s->js_this = JS_DupValue(ctx, obj);
     return obj;
 
 fail:
     if (s) {
-        tjs__llhttp_reset_result(s);
         free(s);
     }
     return JS_EXCEPTION;
 }
 
+/* With an onBody handler the body received so far is handed over instead of
+ * being kept until the message is complete. */
+static int tjs__llhttp_flush_body(JSContext *ctx, TJSLlhttp *s, JSValueConst this_val) {
+    if (!JS_IsFunction(ctx, s->on_body) || s->result.body.size == 0) {
+        return 0;
+    }
+
+    JSValue chunk = TJS_NewUint8Array(ctx, s->result.body.buf, s->result.body.size);
+    tjs_dbuf_init(ctx, &s->result.body);
+    if (JS_IsException(chunk)) {
+        return -1;
+    }
+
+    JSValue ret = JS_Call(ctx, s->on_body, this_val, 1, &chunk);
+    JS_FreeValue(ctx, chunk);
+    if (JS_IsException(ret)) {
+        return -1;
+    }
+    JS_FreeValue(ctx, ret);
+
+    return 0;
+}
+
+static int tjs__llhttp_queue_result(JSContext *ctx, TJSLlhttp *s) {
+    if (JS_IsUndefined(s->results)) {
+        s->results = JS_NewArray(ctx);
+        if (JS_IsException(s->results)) {
+            s->results = JS_UNDEFINED;
+            return -1;
+        }
+    }
+
+    JSValue obj = tjs__llhttp_new_result(ctx, s);
+    if (JS_IsException(obj)) {
+        return -1;
+    }
+
+    if (JS_DefinePropertyValueUint32(ctx, s->results, s->nresults++, obj, JS_PROP_C_W_E) < 0) {
+        return -1;
+    }
+
+    /* Don't report it again from getResults() if only CR/LF follows. */
+    s->result.taken = 1;
+
+    return 0;
+}
+
 static JSValue tjs_llhttp_execute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
     if (!s) {
@@ -407,14 +375,47 @@ static JSValue tjs_llhttp_execute(JSContext *ctx, JSValueConst this_val, int arg
         return JS_ThrowTypeError(ctx, "expected data argument");
     }
 
+    /* Binary data is parsed in place, strings are converted to UTF-8. */
     size_t len;
-    const char *data = JS_ToCStringLen(ctx, &len, argv[0]);
+    const char *str = NULL;
+    const char *data = (const char *) JS_GetUint8Array(ctx, &len, argv[0]);
     if (!data) {
-        return JS_EXCEPTION;
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        data = str = JS_ToCStringLen(ctx, &len, argv[0]);
+        if (!data) {
+            return JS_EXCEPTION;
+        }
     }
 
-    llhttp_errno_t err = llhttp_execute(&s->parser, data, len);
-    JS_FreeCString(ctx, data);
+    const char *p = data;
+    size_t left = len;
+    llhttp_errno_t err;
+
+    for (;;) {
+        err = llhttp_execute(&s->parser, p, left);
+        if (err != HPE_PAUSED) {
+            break;
+        }
+
+        /* A message is complete. */
+        const char *pos = llhttp_get_error_pos(&s->parser);
+        llhttp_resume(&s->parser);
+        left -= pos - p;
+        p = pos;
+
+        if (left == 0) {
+            err = HPE_OK;
+            break;
+        }
+
+        /* Another one follows, queue this one before it's reset. */
+        if (tjs__llhttp_flush_body(ctx, s, this_val) || tjs__llhttp_queue_result(ctx, s)) {
+            JS_FreeCString(ctx, str);
+            return JS_EXCEPTION;
+        }
+    }
+
+    JS_FreeCString(ctx, str);
 
     if (err != HPE_OK) {
         return JS_ThrowInternalError(ctx,
@@ -423,6 +424,10 @@ static JSValue tjs_llhttp_execute(JSContext *ctx, JSValueConst this_val, int arg
                                      llhttp_get_error_reason(&s->parser));
     }
 
+    if (tjs__llhttp_flush_body(ctx, s, this_val)) {
+        return JS_EXCEPTION;
+    }
+
     return JS_NewInt32(ctx, len);
 }
 
@@ -433,6 +438,11 @@ static JSValue tjs_llhttp_finish(JSContext *ctx, JSValueConst this_val, int argc
     }
 
     llhttp_errno_t err = llhttp_finish(&s->parser);
+    if (err == HPE_PAUSED) {
+        /* The message ended with the connection. */
+        llhttp_resume(&s->parser);
+        err = HPE_OK;
+    }
     if (err != HPE_OK) {
         return JS_ThrowInternalError(ctx, "Finish error: %s", llhttp_errno_name(err));
     }
@@ -448,9 +458,11 @@ static JSValue tjs_llhttp_reset(JSContext *ctx, JSValueConst this_val, int argc,
     
     // 重置解析器前先清理结果数据
     tjs__llhttp_reset_result(s);
+    JS_FreeValue(ctx, s->results);
+    s->results = JS_UNDEFINED;
+    s->nresults = 0;
     
     llhttp_reset(&s->parser);
-    s->result.headers = JS_NewObject(s->ctx);
     
     return JS_UNDEFINED;
 }
@@ -461,13 +473,7 @@ static JSValue tjs_llhttp_get_method_name(JSContext *ctx, JSValueConst this_val,
         return JS_EXCEPTION;
     }
     
-    if (s->result.method) {
-        return JS_NewString(ctx, s->result.method);
-    }
-    
-    uint8_t method = llhttp_get_method(&s->parser);
-    const char* method_name = llhttp_method_name((llhttp_method_t)method);
-    return JS_NewString(ctx, method_name);
+    return tjs__http_method_string(ctx, llhttp_get_method(&s->parser));
 }
 
 static JSValue tjs_llhttp_get_status_code(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
@@ -503,116 +509,117 @@ static JSValue tjs_llhttp_should_keep_alive(JSContext *ctx, JSValueConst this_va
 
 static JSValue tjs_llhttp_create_response(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     int status = 200;
-    const char *status_text = "OK";
-    JSValue headers = JS_UNDEFINED;
-    JSValue body = JS_UNDEFINED;
-    JSValue response = JS_UNDEFINED;
-    char *response_str = NULL;
-    size_t response_len = 0;
-
-    // Parse arguments
+    JSValue headers = argc > 1 ? argv[1] : JS_UNDEFINED;
+    JSValue body = argc > 2 ? argv[2] : JS_UNDEFINED;
+    const char *body_str = NULL;
+    size_t body_len = 0;
+    TJSHttpHeadInfo info;
+    DynBuf dbuf;
+
     if (argc > 0 && JS_ToInt32(ctx, &status, argv[0])) {
-        goto fail;
-    }
-    if (argc > 1) {
-        headers = JS_DupValue(ctx, argv[1]);
+        return JS_EXCEPTION;
     }
-    if (argc > 2) {
-        body = JS_DupValue(ctx, argv[2]);
+
+    if (!JS_IsUndefined(body)) {
+        body_str = JS_ToCStringLen(ctx, &body_len, body);
+        if (!body_str) {
+            return JS_EXCEPTION;
+        }
     }
 
-    // Create response line
-    response_len = snprintf(NULL, 0, "HTTP/1.1 %d %s\r\n", status, status_text);
-    response_str = malloc(response_len + 1);
-    if (!response_str) {
-        goto fail;
+    /* Single buffer, sized up front for the head and the body. */
+    tjs_dbuf_init(ctx, &dbuf);
+    if (dbuf_realloc(&dbuf, 256 + body_len)) {
+        JS_FreeCString(ctx, body_str);
+        return JS_ThrowOutOfMemory(ctx);
     }
-    snprintf(response_str, response_len + 1, "HTTP/1.1 %d %s\r\n", status, status_text);
 
-    // Add headers
-    if (!JS_IsUndefined(headers) && JS_IsObject(headers)) {
-        JSPropertyEnum *props = NULL;
-        uint32_t count = 0;
-        if (JS_GetOwnPropertyNames(ctx, &props, &count, headers, JS_GPN_STRING_MASK)) {
-            goto fail;
-        }
+    tjs__http_put_status_line(&dbuf, status, NULL);
 
-        for (uint32_t i = 0; i < count; i++) {
-            JSValue val = JS_GetProperty(ctx, headers, props[i].atom);
-            const char *key = JS_AtomToCString(ctx, props[i].atom);
-            const char *value = JS_ToCString(ctx, val);
-
-            if (key && value) {
-                size_t header_len = snprintf(NULL, 0, "%s: %s\r\n", key, value);
-                char *header_str = realloc(response_str, response_len + header_len + 1);
-                if (!header_str) {
-                    JS_FreeCString(ctx, key);
-                    JS_FreeCString(ctx, value);
-                    JS_FreeValue(ctx, val);
-                    js_free(ctx, props);
-                    goto fail;
-                }
-                response_str = header_str;
-                snprintf(response_str + response_len, header_len + 1, "%s: %s\r\n", key, value);
-                response_len += header_len;
-            }
+    if (tjs__http_put_headers(ctx, &dbuf, headers, &info)) {
+        JS_FreeCString(ctx, body_str);
+        dbuf_free(&dbuf);
+        return JS_EXCEPTION;
+    }
 
-            if (key) {
-                JS_FreeCString(ctx, key);
-            }
-            if (value) {
-                JS_FreeCString(ctx, value);
-            }
-            JS_FreeValue(ctx, val);
-        }
-        js_free(ctx, props);
+    dbuf_put(&dbuf, (const uint8_t *) "\r\n", 2);
+    if (body_str) {
+        dbuf_put(&dbuf, (const uint8_t *) body_str, body_len);
+        JS_FreeCString(ctx, body_str);
     }
 
-    // Add body
-    if (!JS_IsUndefined(body)) {
-        size_t body_len;
-        const char *body_str = JS_ToCStringLen(ctx, &body_len, body);
-        if (body_str) {
-            char *new_response = realloc(response_str, response_len + body_len + 3);  // +3 for \r\n\0
-            if (!new_response) {
-                JS_FreeCString(ctx, body_str);
-                goto fail;
-            }
-            response_str = new_response;
-            memcpy(response_str + response_len, "\r\n", 2);
-            memcpy(response_str + response_len + 2, body_str, body_len);
-            response_len += 2 + body_len;
-            response_str[response_len] = '\0';
-            JS_FreeCString(ctx, body_str);
-        }
-    } else {
-        char *new_response = realloc(response_str, response_len + 3);  // +3 for \r\n\0
-        if (!new_response) {
-            goto fail;
-        }
-        response_str = new_response;
-        memcpy(response_str + response_len, "\r\n", 2);
-        response_len += 2;
-        response_str[response_len] = '\0';
+    if (dbuf_error(&dbuf)) {
+        dbuf_free(&dbuf);
+        return JS_ThrowOutOfMemory(ctx);
     }
 
-    response = JS_NewStringLen(ctx, response_str, response_len);
-    free(response_str);
-    JS_FreeValue(ctx, headers);
-    JS_FreeValue(ctx, body);
+    JSValue response = JS_NewStringLen(ctx, (const char *) dbuf.buf, dbuf.size);
+    dbuf_free(&dbuf);
+
     return response;
+}
 
-fail:
-    if (response_str) {
-        free(response_str);
+static JSValue tjs_llhttp_get_body(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
     }
-    if (!JS_IsUndefined(headers)) {
-        JS_FreeValue(ctx, headers);
+
+    if (!s->result.message_complete) {
+        return JS_UNDEFINED;
     }
-    if (!JS_IsUndefined(body)) {
-        JS_FreeValue(ctx, body);
+
+    return JS_NewUint8ArrayCopy(ctx, s->result.body.buf, s->result.body.size);
+}
+
+static JSValue tjs_llhttp_on_body_get(JSContext *ctx, JSValueConst this_val) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
     }
-    return JS_EXCEPTION;
+
+    return JS_DupValue(ctx, s->on_body);
+}
+
+static JSValue tjs_llhttp_on_body_set(JSContext *ctx, JSValueConst this_val, JSValueConst value) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    if (!JS_IsFunction(ctx, value) && !JS_IsUndefined(value) && !JS_IsNull(value)) {
+        return JS_ThrowTypeError(ctx, "onBody must be a function");
+    }
+
+    JS_FreeValue(ctx, s->on_body);
+    s->on_body = JS_DupValue(ctx, value);
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_llhttp_max_body_size_get(JSContext *ctx, JSValueConst this_val) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewInt64(ctx, s->max_body_size);
+}
+
+static JSValue tjs_llhttp_max_body_size_set(JSContext *ctx, JSValueConst this_val, JSValueConst value) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    int64_t v;
+    if (JS_ToInt64(ctx, &v, value)) {
+        return JS_EXCEPTION;
+    }
+
+    s->max_body_size = v > 0 ? v : 0;
+
+    return JS_UNDEFINED;
 }
 
 static const JSCFunctionListEntry tjs_llhttp_proto_funcs[] = {
@@ -620,11 +627,16 @@ static const JSCFunctionListEntry tjs_llhttp_proto_funcs[] = {
     JS_CFUNC_DEF("finish", 0, tjs_llhttp_finish),
     JS_CFUNC_DEF("reset", 0, tjs_llhttp_reset),
     JS_CFUNC_DEF("getResult", 0, tjs_llhttp_get_result),
+    JS_CFUNC_DEF("getResults", 0, tjs_llhttp_get_results),
+    JS_CFUNC_DEF("getRawHeaders", 0, tjs_llhttp_get_raw_headers),
     JS_CFUNC_DEF("getMethodName", 0, tjs_llhttp_get_method_name),
     JS_CFUNC_DEF("getStatusCode", 0, tjs_llhttp_get_status_code),
     JS_CFUNC_DEF("getHttpVersion", 0, tjs_llhttp_get_http_version),
     JS_CFUNC_DEF("shouldKeepAlive", 0, tjs_llhttp_should_keep_alive),
     JS_CFUNC_DEF("createResponse", 3, tjs_llhttp_create_response),
+    JS_CFUNC_DEF("getBody", 0, tjs_llhttp_get_body),
+    JS_CGETSET_DEF("onBody", tjs_llhttp_on_body_get, tjs_llhttp_on_body_set),
+    JS_CGETSET_DEF("maxBodySize", tjs_llhttp_max_body_size_get, tjs_llhttp_max_body_size_set),
 };
 
 static const JSCFunctionListEntry tjs_llhttp_class_funcs[] = {
@@ -659,23 +671,49 @@ static const JSCFunctionListEntry tjs_llhttp_class_funcs[] = {
     JS_PROP_INT32_DEF("HTTP_STATUS_SERVICE_UNAVAILABLE", 503, JS_PROP_CONFIGURABLE),
 };
 
-static JSValue tjs_llhttp_get_result(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+static JSValue tjs_llhttp_get_raw_headers(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
     if (!s) {
         return JS_EXCEPTION;
     }
 
+    JSValue arr = JS_NewArray(ctx);
+    if (JS_IsException(arr)) {
+        return arr;
+    }
+
+    /* Flat [name, value, ...] list, in wire order and with duplicates kept. */
+    size_t count = s->result.headers.size / sizeof(TJSHttpHeader);
+    TJSHttpHeader *h = (TJSHttpHeader *) s->result.headers.buf;
+    for (size_t i = 0; i < count; i++, h++) {
+        JSValue name = tjs__llhttp_span_to_string(ctx, s, &h->name);
+        JSValue value = tjs__llhttp_span_to_string(ctx, s, &h->value);
+        JS_DefinePropertyValueUint32(ctx, arr, 2 * i, name, JS_PROP_C_W_E);
+        JS_DefinePropertyValueUint32(ctx, arr, 2 * i + 1, value, JS_PROP_C_W_E);
+    }
+
+    return arr;
+}
+
+static JSValue tjs__llhttp_new_result(JSContext *ctx, TJSLlhttp *s) {
+    const char *arena = (const char *) s->result.arena.buf;
+    size_t nheaders = s->result.headers.size / sizeof(TJSHttpHeader);
+    JSValue headers = tjs__http_new_headers(ctx, arena, (TJSHttpHeader *) s->result.headers.buf, nheaders);
+    if (JS_IsException(headers)) {
+        return headers;
+    }
+
     JSValue obj = JS_NewObject(ctx);
     
     /* Basic message info */
-    if (s->result.method) {
-        JS_SetPropertyStr(ctx, obj, "method", JS_NewString(ctx, s->result.method));
+    if (s->result.method.len > 0) {
+        JS_SetPropertyStr(ctx, obj, "method", tjs__http_method_string(ctx, llhttp_get_method(&s->parser)));
     }
-    if (s->result.url) {
-        JS_SetPropertyStr(ctx, obj, "url", JS_NewString(ctx, s->result.url));
+    if (s->result.url.len > 0) {
+        JS_SetPropertyStr(ctx, obj, "url", tjs__llhttp_span_to_string(ctx, s, &s->result.url));
     }
-    if (s->result.status) {
-        JS_SetPropertyStr(ctx, obj, "status", JS_NewString(ctx, s->result.status));
+    if (s->result.status.len > 0) {
+        JS_SetPropertyStr(ctx, obj, "status", tjs__llhttp_span_to_string(ctx, s, &s->result.status));
     }
     
     /* Status code and HTTP version */
@@ -684,15 +722,12 @@ static JSValue tjs_llhttp_get_result(JSContext *ctx, JSValueConst this_val, int
     JS_SetPropertyStr(ctx, obj, "httpMinor", JS_NewInt32(ctx, s->result.http_minor));
     
     /* Headers */
-    if (!JS_IsUndefined(s->result.headers)) {
-        JS_SetPropertyStr(ctx, obj, "headers", JS_DupValue(ctx, s->result.headers));
-    } else {
-        JS_SetPropertyStr(ctx, obj, "headers", JS_NewObject(ctx));
-    }
+    JS_SetPropertyStr(ctx, obj, "headers", headers);
     
-    /* Body */
-    if (s->result.body) {
-        JS_SetPropertyStr(ctx, obj, "body", JS_NewStringLen(ctx, s->result.body, s->result.body_len));
+    /* Body, only once the message is complete */
+    if (s->result.message_complete && s->result.body.size > 0) {
+        const char *body = (const char *) s->result.body.buf;
+        JS_SetPropertyStr(ctx, obj, "body", JS_NewStringLen(ctx, body, s->result.body.size));
     } else {
         JS_SetPropertyStr(ctx, obj, "body", JS_NewString(ctx, ""));
     }
@@ -703,6 +738,47 @@ static JSValue tjs_llhttp_get_result(JSContext *ctx, JSValueConst this_val, int
     return obj;
 }
 
+static JSValue tjs_llhttp_get_result(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    return tjs__llhttp_new_result(ctx, s);
+}
+
+/* All the complete messages parsed since the last call, in order. */
+static JSValue tjs_llhttp_get_results(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    TJSLlhttp *s = JS_GetOpaque2(ctx, this_val, tjs_llhttp_class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    JSValue arr = s->results;
+    if (JS_IsUndefined(arr)) {
+        arr = JS_NewArray(ctx);
+        if (JS_IsException(arr)) {
+            return arr;
+        }
+    }
+
+    uint32_t n = s->nresults;
+    s->results = JS_UNDEFINED;
+    s->nresults = 0;
+
+    if (s->result.message_complete && !s->result.taken) {
+        JSValue obj = tjs__llhttp_new_result(ctx, s);
+        if (JS_IsException(obj)) {
+            JS_FreeValue(ctx, arr);
+            return obj;
+        }
+        JS_DefinePropertyValueUint32(ctx, arr, n, obj, JS_PROP_C_W_E);
+        s->result.taken = 1;
+    }
+
+    return arr;
+}
+
 static void tjs__llhttp_register_class(JSContext *ctx) {
     if (!tjs_llhttp_class_id) {
         JS_NewClassID(JS_GetRuntime(ctx), &tjs_llhttp_class_id);
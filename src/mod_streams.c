@@ -27,6 +27,10 @@
 #include "utils.h"
 
 #include <string.h>
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 
 /* Forward declarations */
@@ -37,6 +41,7 @@ static JSValue tjs_new_tcp(JSContext *ctx, int af);
 
 typedef struct {
     JSContext *ctx;
+    TJSRuntime *qrt;
     int closed;
     int finalized;
     union {
@@ -53,10 +58,17 @@ typedef struct {
             size_t len;
         } b;
         TJSPromise result;
+        JSValue on_data; /* set while reading continuously */
     } read;
     struct {
         TJSPromise result;
+        JSValue batch; /* array being filled for acceptMany() */
+        uint32_t batch_len;
+        uint32_t batch_max; /* 0 for a plain accept() */
+        int pending; /* a connection is waiting in libuv for uv_accept() */
     } accept;
+    struct TJSStreamPipe *pipe_out; /* piping from this stream */
+    struct TJSStreamPipe *pipe_in;  /* piping into this stream */
 } TJSStream;
 
 typedef struct {
@@ -71,19 +83,115 @@ typedef struct {
 
 typedef struct {
     uv_write_t req;
-    JSValue tarray;
     TJSPromise result;
+    uint32_t nbufs;
+    bool pooled;
+    JSValue tarrays[]; /* kept alive until the write completes */
 } TJSWriteReq;
 
+/* Buffers which fit here are collected on the stack when writing. */
+#define TJS__STREAM_WRITE_NBUFS 16
+
+/*
+ * Streams and their requests are recycled through per-runtime free lists, so
+ * short lived connections don't go through the allocator every time.
+ */
+
+#define TJS__POOL_MAX_FREE 64
+
+/* Write requests with up to this many buffers come from the pool. */
+#define TJS__WRITE_REQ_POOL_SIZE (sizeof(TJSWriteReq) + TJS__STREAM_WRITE_NBUFS * sizeof(JSValue))
+
+static void *tjs__pool_get(TJSFreeList *l, size_t size) {
+    void *ptr = l->head;
+
+    if (!ptr) {
+        l->misses++;
+        return tjs__mallocz(size);
+    }
+
+    l->head = *(void **) ptr;
+    l->len--;
+    l->hits++;
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+static void tjs__pool_put(TJSRuntime *qrt, TJSFreeList *l, void *ptr) {
+    if (qrt->freeing || l->len >= TJS__POOL_MAX_FREE) {
+        tjs__free(ptr);
+        return;
+    }
+
+    *(void **) ptr = l->head;
+    l->head = ptr;
+    l->len++;
+}
+
+static void tjs__pool_drain(TJSFreeList *l) {
+    void *ptr;
+
+    while ((ptr = l->head)) {
+        l->head = *(void **) ptr;
+        tjs__free(ptr);
+    }
+    l->len = 0;
+}
+
+static TJSStream *tjs__stream_alloc(JSContext *ctx) {
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    TJSStream *s = tjs__pool_get(&qrt->stream_pools.streams, sizeof(TJSStream));
+
+    if (s) {
+        s->qrt = qrt;
+    }
+
+    return s;
+}
+
+static void tjs__stream_release(TJSStream *s) {
+    tjs__pool_put(s->qrt, &s->qrt->stream_pools.streams, s);
+}
+
+static TJSWriteReq *tjs__write_req_alloc(JSContext *ctx, uint32_t nbufs) {
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    TJSWriteReq *wr;
+
+    if (nbufs <= TJS__STREAM_WRITE_NBUFS) {
+        wr = tjs__pool_get(&qrt->stream_pools.write_reqs, TJS__WRITE_REQ_POOL_SIZE);
+        if (wr) {
+            wr->pooled = true;
+        }
+    } else {
+        wr = tjs__mallocz(sizeof(*wr) + nbufs * sizeof(JSValue));
+    }
+
+    if (!wr) {
+        JS_ThrowOutOfMemory(ctx);
+    }
+
+    return wr;
+}
+
+static void tjs__write_req_free(TJSRuntime *qrt, TJSWriteReq *wr) {
+    if (wr->pooled) {
+        tjs__pool_put(qrt, &qrt->stream_pools.write_reqs, wr);
+    } else {
+        tjs__free(wr);
+    }
+}
+
 static TJSStream *tjs_tcp_get(JSContext *ctx, JSValue obj);
 static TJSStream *tjs_pipe_get(JSContext *ctx, JSValue obj);
+static void tjs__pipe_abort(struct TJSStreamPipe *p, int error);
 
 static void uv__stream_close_cb(uv_handle_t *handle) {
     TJSStream *s = handle->data;
     CHECK_NOT_NULL(s);
     s->closed = 1;
     if (s->finalized) {
-        tjs__free(s);
+        tjs__stream_release(s);
     }
 }
 
@@ -109,6 +217,16 @@ static JSValue tjs_stream_close(JSContext *ctx, JSValue this_val, int argc, JSVa
         TJS_SettlePromise(ctx, &s->accept.result, 0, 1, &arg);
         TJS_ClearPromise(ctx, &s->accept.result);
     }
+    JS_FreeValue(ctx, s->accept.batch);
+    s->accept.batch = JS_UNDEFINED;
+    JS_FreeValue(ctx, s->read.on_data);
+    s->read.on_data = JS_UNDEFINED;
+    if (s->pipe_out) {
+        tjs__pipe_abort(s->pipe_out, UV_ECANCELED);
+    }
+    if (s->pipe_in) {
+        tjs__pipe_abort(s->pipe_in, UV_ECANCELED);
+    }
 
     maybe_close(s);
     return JS_UNDEFINED;
@@ -156,7 +274,7 @@ static JSValue tjs_stream_read(JSContext *ctx, JSValue this_val, int argc, JSVal
     if (!s) {
         return JS_EXCEPTION;
     }
-    if (TJS_IsPromisePending(ctx, &s->read.result)) {
+    if (TJS_IsPromisePending(ctx, &s->read.result) || !JS_IsUndefined(s->read.on_data) || s->pipe_out) {
         return tjs_throw_errno(ctx, UV_EBUSY);
     }
 
@@ -182,6 +300,208 @@ static JSValue tjs_stream_read(JSContext *ctx, JSValue this_val, int argc, JSVal
     return TJS_InitPromise(ctx, &s->read.result);
 }
 
+/*
+ * Continuous reads.
+ *
+ * Instead of reading into a buffer JS passes for every read, readStart() keeps
+ * reading into slabs shared by all the streams in the runtime and hands every
+ * chunk to the callback as a Uint8Array pointing into its slab, no copies.
+ * A slab is filled by successive reads and goes back to the pool once JS has
+ * let go of all of its chunks. Reading goes on until readStop(), which the
+ * consumer calls when it can't take more.
+ */
+
+typedef struct TJSReadSlab TJSReadSlab;
+
+struct TJSReadSlab {
+    TJSReadSlab *next;
+    TJSRuntime *qrt;
+    uint32_t refs; /* one per chunk in JS, plus one while it's the current slab */
+    size_t used;
+    uint8_t data[];
+};
+
+#define TJS__READ_SLAB_SIZE (256 * 1024)
+/* A read gets at least this much room, or a new slab is started. */
+#define TJS__READ_MIN_SIZE (64 * 1024)
+/* Spare slabs kept around. */
+#define TJS__READ_MAX_FREE_SLABS 8
+
+static void tjs__read_slab_unref(TJSReadSlab *slab) {
+    TJSRuntime *qrt = slab->qrt;
+
+    if (--slab->refs > 0) {
+        return;
+    }
+
+    if (!qrt->freeing && qrt->read_slabs.nfree < TJS__READ_MAX_FREE_SLABS) {
+        slab->used = 0;
+        slab->next = qrt->read_slabs.free;
+        qrt->read_slabs.free = slab;
+        qrt->read_slabs.nfree++;
+    } else {
+        tjs__free(slab);
+    }
+}
+
+static void tjs__read_slab_free_chunk(JSRuntime *rt, void *opaque, void *ptr) {
+    tjs__read_slab_unref(opaque);
+}
+
+/* The current slab, with room for another read. */
+static TJSReadSlab *tjs__read_slab_get(TJSRuntime *qrt) {
+    TJSReadSlab *slab = qrt->read_slabs.current;
+
+    if (slab && TJS__READ_SLAB_SIZE - slab->used >= TJS__READ_MIN_SIZE) {
+        return slab;
+    }
+
+    if (slab) {
+        qrt->read_slabs.current = NULL;
+        tjs__read_slab_unref(slab);
+    }
+
+    slab = qrt->read_slabs.free;
+    if (slab) {
+        qrt->read_slabs.free = slab->next;
+        qrt->read_slabs.nfree--;
+    } else {
+        slab = tjs__malloc(sizeof(*slab) + TJS__READ_SLAB_SIZE);
+        if (!slab) {
+            return NULL;
+        }
+        slab->qrt = qrt;
+        slab->used = 0;
+    }
+
+    slab->next = NULL;
+    slab->refs = 1;
+    qrt->read_slabs.current = slab;
+
+    return slab;
+}
+
+void tjs__stream_pools_free(TJSRuntime *qrt) {
+    TJSReadSlab *slab = qrt->read_slabs.current;
+
+    /* Nothing in JS points into slabs any more, the runtime is gone. From now on
+     * released memory is freed right away instead of being pooled. */
+    if (slab) {
+        qrt->read_slabs.current = NULL;
+        tjs__read_slab_unref(slab);
+    }
+
+    while ((slab = qrt->read_slabs.free)) {
+        qrt->read_slabs.free = slab->next;
+        tjs__free(slab);
+    }
+    qrt->read_slabs.nfree = 0;
+
+    tjs__pool_drain(&qrt->stream_pools.streams);
+    tjs__pool_drain(&qrt->stream_pools.write_reqs);
+    tjs__pool_drain(&qrt->stream_pools.shutdown_reqs);
+}
+
+static void uv__stream_slab_alloc_cb(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf) {
+    TJSStream *s = handle->data;
+    CHECK_NOT_NULL(s);
+
+    TJSReadSlab *slab = tjs__read_slab_get(TJS_GetRuntime(s->ctx));
+
+    /* libuv reports UV_ENOBUFS to the read callback. */
+    if (!slab) {
+        *buf = uv_buf_init(NULL, 0);
+        return;
+    }
+
+    *buf = uv_buf_init((char *) slab->data + slab->used, TJS__READ_SLAB_SIZE - slab->used);
+}
+
+static void uv__stream_continuous_read_cb(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf) {
+    TJSStream *s = handle->data;
+    CHECK_NOT_NULL(s);
+
+    JSContext *ctx = s->ctx;
+    JSValue arg;
+
+    if (nread == 0) {
+        return;
+    }
+
+    if (nread > 0) {
+        TJSReadSlab *slab = TJS_GetRuntime(ctx)->read_slabs.current;
+        CHECK_NOT_NULL(slab);
+        CHECK_EQ((uint8_t *) buf->base, slab->data + slab->used);
+
+        arg = JS_NewUint8Array(ctx, slab->data + slab->used, nread, tjs__read_slab_free_chunk, slab, false);
+        if (JS_IsException(arg)) {
+            arg = JS_GetException(ctx);
+        } else {
+            slab->refs++;
+            /* Keep the next chunk aligned. */
+            slab->used += (nread + 7) & ~7;
+            if (slab->used > TJS__READ_SLAB_SIZE) {
+                slab->used = TJS__READ_SLAB_SIZE;
+            }
+        }
+    } else {
+        arg = nread == UV_EOF ? JS_NULL : tjs_new_error(ctx, nread);
+    }
+
+    /* The end of the stream or an error, nothing more will come. */
+    JSValue func = s->read.on_data;
+    if (nread < 0) {
+        uv_read_stop(handle);
+        s->read.on_data = JS_UNDEFINED;
+    } else {
+        JS_DupValue(ctx, func);
+    }
+
+    tjs_call_handler(ctx, func, 1, &arg);
+    JS_FreeValue(ctx, arg);
+    JS_FreeValue(ctx, func);
+}
+
+static JSValue tjs_stream_read_start(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    JSClassID class_id;
+    TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+    if (TJS_IsPromisePending(ctx, &s->read.result) || s->pipe_out) {
+        return tjs_throw_errno(ctx, UV_EBUSY);
+    }
+    if (!JS_IsFunction(ctx, argv[0])) {
+        return TJS_THROW_ARG_ERR(ctx, 0, "a function");
+    }
+
+    int r = uv_read_start(&s->h.stream, uv__stream_slab_alloc_cb, uv__stream_continuous_read_cb);
+    if (r != 0 && r != UV_EALREADY) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    JS_FreeValue(ctx, s->read.on_data);
+    s->read.on_data = JS_DupValue(ctx, argv[0]);
+
+    return JS_UNDEFINED;
+}
+
+static JSValue tjs_stream_read_stop(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    JSClassID class_id;
+    TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    if (!JS_IsUndefined(s->read.on_data)) {
+        uv_read_stop(&s->h.stream);
+        JS_FreeValue(ctx, s->read.on_data);
+        s->read.on_data = JS_UNDEFINED;
+    }
+
+    return JS_UNDEFINED;
+}
+
 static void uv__stream_write_cb(uv_write_t *req, int status) {
     TJSStream *s = req->handle->data;
     CHECK_NOT_NULL(s);
@@ -199,10 +519,23 @@ static void uv__stream_write_cb(uv_write_t *req, int status) {
     }
 
     TJS_SettlePromise(ctx, &wr->result, is_reject, 1, &arg);
-    JS_FreeValue(ctx, wr->tarray);
-    js_free(ctx, wr);
+    for (uint32_t i = 0; i < wr->nbufs; i++) {
+        JS_FreeValue(ctx, wr->tarrays[i]);
+    }
+    tjs__write_req_free(s->qrt, wr);
 }
 
+static void tjs__stream_free_tarrays(JSContext *ctx, JSValue *tarrays, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        JS_FreeValue(ctx, tarrays[i]);
+    }
+}
+
+/*
+ * Accepts a single Uint8Array or an array of them. In the latter case all the
+ * buffers go out in a single (vectored) write, so callers don't need to
+ * concatenate them first.
+ */
 static JSValue tjs_stream_write(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     JSClassID class_id;
     TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
@@ -210,46 +543,100 @@ static JSValue tjs_stream_write(JSContext *ctx, JSValue this_val, int argc, JSVa
         return JS_EXCEPTION;
     }
 
-    size_t size;
-    uint8_t *buf = JS_GetUint8Array(ctx, &size, argv[0]);
-    if (!buf) {
-        return JS_EXCEPTION;
+    JSValue data = argv[0];
+    bool is_array = JS_IsArray(data);
+    uint32_t nbufs = 1;
+
+    if (is_array) {
+        int64_t len;
+        if (JS_GetLength(ctx, data, &len)) {
+            return JS_EXCEPTION;
+        }
+        if (len > INT32_MAX) {
+            return JS_ThrowRangeError(ctx, "too many buffers");
+        }
+        nbufs = len;
+    }
+
+    JSValue stack_tarrays[TJS__STREAM_WRITE_NBUFS];
+    uv_buf_t stack_bufs[TJS__STREAM_WRITE_NBUFS];
+    JSValue *tarrays = stack_tarrays;
+    uv_buf_t *bufs = stack_bufs;
+
+    if (nbufs > TJS__STREAM_WRITE_NBUFS) {
+        tarrays = js_malloc(ctx, nbufs * (sizeof(*tarrays) + sizeof(*bufs)));
+        if (!tarrays) {
+            return JS_EXCEPTION;
+        }
+        bufs = (uv_buf_t *) (tarrays + nbufs);
+    }
+
+    JSValue ret = JS_EXCEPTION;
+    size_t total = 0;
+    uint32_t n;
+
+    for (n = 0; n < nbufs; n++) {
+        tarrays[n] = is_array ? JS_GetPropertyUint32(ctx, data, n) : JS_DupValue(ctx, data);
+
+        size_t size;
+        uint8_t *buf = JS_GetUint8Array(ctx, &size, tarrays[n]);
+        if (!buf) {
+            n++;
+            goto end;
+        }
+
+        bufs[n] = uv_buf_init((char *) buf, size);
+        total += size;
     }
 
     /* First try to do the write inline */
-    int r;
-    uv_buf_t b;
-    b = uv_buf_init((char *) buf, size);
-    r = uv_try_write(&s->h.stream, &b, 1);
+    int r = nbufs > 0 ? uv_try_write(&s->h.stream, bufs, nbufs) : 0;
 
-    if (r == size) {
-        JSValue val = JS_NewInt64(ctx, size);
-        return TJS_NewResolvedPromise(ctx, 1, &val);
+    if (r == total) {
+        JSValue val = JS_NewInt64(ctx, total);
+        ret = TJS_NewResolvedPromise(ctx, 1, &val);
+        goto end;
     }
 
-    /* Do an async write, copy the data. */
-    if (r >= 0) {
-        buf += r;
-        size -= r;
+    /* Do an async write of whatever is left, keeping the buffers alive. */
+    uint32_t first = 0;
+    if (r > 0) {
+        size_t written = r;
+        while (written >= bufs[first].len) {
+            written -= bufs[first].len;
+            first++;
+        }
+        bufs[first].base += written;
+        bufs[first].len -= written;
     }
 
-    TJSWriteReq *wr = js_malloc(ctx, sizeof(*wr));
+    TJSWriteReq *wr = tjs__write_req_alloc(ctx, nbufs);
     if (!wr) {
-        return JS_EXCEPTION;
+        goto end;
     }
 
     wr->req.data = wr;
-    wr->tarray = JS_DupValue(ctx, argv[0]);
+    wr->nbufs = nbufs;
+    memcpy(wr->tarrays, tarrays, nbufs * sizeof(JSValue));
 
-    b = uv_buf_init((char *) buf, size);
-    r = uv_write(&wr->req, &s->h.stream, &b, 1, uv__stream_write_cb);
+    r = uv_write(&wr->req, &s->h.stream, bufs + first, nbufs - first, uv__stream_write_cb);
     if (r != 0) {
-        JS_FreeValue(ctx, wr->tarray);
-        js_free(ctx, wr);
-        return tjs_throw_errno(ctx, r);
+        tjs__write_req_free(s->qrt, wr);
+        ret = tjs_throw_errno(ctx, r);
+        goto end;
+    }
+
+    /* The request owns the buffers now. */
+    n = 0;
+    ret = TJS_InitPromise(ctx, &wr->result);
+
+end:
+    tjs__stream_free_tarrays(ctx, tarrays, n);
+    if (tarrays != stack_tarrays) {
+        js_free(ctx, tarrays);
     }
 
-    return TJS_InitPromise(ctx, &wr->result);
+    return ret;
 }
 
 static void uv__stream_shutdown_cb(uv_shutdown_t *req, int status) {
@@ -269,7 +656,7 @@ static void uv__stream_shutdown_cb(uv_shutdown_t *req, int status) {
 
     TJS_SettlePromise(ctx, &sr->result, is_reject, 1, &arg);
 
-    js_free(ctx, sr);
+    tjs__pool_put(s->qrt, &s->qrt->stream_pools.shutdown_reqs, sr);
 }
 
 static JSValue tjs_stream_shutdown(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
@@ -279,20 +666,32 @@ static JSValue tjs_stream_shutdown(JSContext *ctx, JSValue this_val, int argc, J
         return JS_EXCEPTION;
     }
 
-    TJSShutdownReq *sr = js_malloc(ctx, sizeof(*sr));
+    TJSShutdownReq *sr = tjs__pool_get(&s->qrt->stream_pools.shutdown_reqs, sizeof(*sr));
     if (!sr) {
-        return JS_EXCEPTION;
+        return JS_ThrowOutOfMemory(ctx);
     }
     sr->req.data = sr;
 
     int r = uv_shutdown(&sr->req, &s->h.stream, uv__stream_shutdown_cb);
     if (r != 0) {
+        tjs__pool_put(s->qrt, &s->qrt->stream_pools.shutdown_reqs, sr);
         return tjs_throw_errno(ctx, r);
     }
 
     return TJS_InitPromise(ctx, &sr->result);
 }
 
+static JSValue tjs_stream_write_queue_size_get(JSContext *ctx, JSValue this_val) {
+    JSClassID class_id;
+    TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    /* Bytes handed to write() which are still waiting for the kernel to take them. */
+    return JS_NewInt64(ctx, uv_stream_get_write_queue_size(&s->h.stream));
+}
+
 static JSValue tjs_stream_fileno(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     JSClassID class_id;
     TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
@@ -334,45 +733,129 @@ static void uv__stream_connect_cb(uv_connect_t *req, int status) {
     js_free(ctx, cr);
 }
 
+static JSValue tjs__stream_accept_one(JSContext *ctx, TJSStream *s) {
+    JSValue obj;
+    TJSStream *t2;
+
+    switch (s->h.handle.type) {
+        case UV_TCP:
+            obj = tjs_new_tcp(ctx, AF_UNSPEC);
+            if (JS_IsException(obj)) {
+                return obj;
+            }
+            t2 = tjs_tcp_get(ctx, obj);
+            break;
+        case UV_NAMED_PIPE:
+            obj = tjs_new_pipe(ctx);
+            if (JS_IsException(obj)) {
+                return obj;
+            }
+            t2 = tjs_pipe_get(ctx, obj);
+            break;
+        default:
+            abort();
+    }
+
+    s->accept.pending = 0;
+
+    int r = uv_accept(&s->h.stream, &t2->h.stream);
+    if (r != 0) {
+        JS_FreeValue(ctx, obj);
+        return JS_Throw(ctx, tjs_new_error(ctx, r));
+    }
+
+    return obj;
+}
+
+/* Runs once the current I/O callbacks are done, handing the whole batch to JS. */
+static JSValue tjs__stream_accept_batch_job(JSContext *ctx, int argc, JSValue *argv) {
+    JSValue ret = JS_Call(ctx, argv[0], JS_UNDEFINED, 1, &argv[1]);
+    JS_FreeValue(ctx, ret);
+
+    return JS_UNDEFINED;
+}
+
+/* Forget about a batch JS already got. */
+static void tjs__stream_accept_batch_reset(JSContext *ctx, TJSStream *s) {
+    if (JS_IsUndefined(s->accept.batch) || JS_PromiseState(ctx, s->accept.result.p) == JS_PROMISE_PENDING) {
+        return;
+    }
+
+    TJS_FreePromise(ctx, &s->accept.result);
+    TJS_ClearPromise(ctx, &s->accept.result);
+    JS_FreeValue(ctx, s->accept.batch);
+    s->accept.batch = JS_UNDEFINED;
+    s->accept.batch_len = 0;
+    s->accept.batch_max = 0;
+}
+
+static int tjs__stream_accept_batch_add(JSContext *ctx, TJSStream *s) {
+    JSValue obj = tjs__stream_accept_one(ctx, s);
+    if (JS_IsException(obj)) {
+        return -1;
+    }
+
+    if (JS_IsUndefined(s->accept.batch)) {
+        s->accept.batch = JS_NewArray(ctx);
+        JSValue args[2] = { s->accept.result.rfuncs[0], s->accept.batch };
+        CHECK_EQ(JS_EnqueueJob(ctx, tjs__stream_accept_batch_job, 2, args), 0);
+    }
+
+    JS_SetPropertyUint32(ctx, s->accept.batch, s->accept.batch_len++, obj);
+
+    return 0;
+}
+
 static void uv__stream_connection_cb(uv_stream_t *handle, int status) {
     TJSStream *s = handle->data;
     CHECK_NOT_NULL(s);
 
-    if (!TJS_IsPromisePending(s->ctx, &s->accept.result)) {
-        // TODO - handle this.
-        return;
-    }
     JSContext *ctx = s->ctx;
-    JSValue arg;
-    int is_reject = 0;
-    if (status == 0) {
-        TJSStream *t2;
-        switch (handle->type) {
-            case UV_TCP:
-                arg = tjs_new_tcp(ctx, AF_UNSPEC);
-                t2 = tjs_tcp_get(ctx, arg);
-                break;
-            case UV_NAMED_PIPE:
-                arg = tjs_new_pipe(ctx);
-                t2 = tjs_pipe_get(ctx, arg);
-                break;
-            default:
-                abort();
+
+    tjs__stream_accept_batch_reset(ctx, s);
+
+    bool batching = s->accept.batch_max > 0;
+    bool waiting = TJS_IsPromisePending(ctx, &s->accept.result) &&
+                   (!batching || s->accept.batch_len < s->accept.batch_max);
+
+    /* Nobody is accepting (or the batch is full): libuv holds on to the
+     * connection, and stops watching for more, until uv_accept() is called. */
+    if (!waiting) {
+        if (status == 0) {
+            s->accept.pending = 1;
         }
+        return;
+    }
 
-        int r = uv_accept(handle, &t2->h.stream);
-        if (r != 0) {
-            JS_FreeValue(ctx, arg);
-            arg = tjs_new_error(ctx, r);
-            is_reject = 1;
+    JSValue arg;
+    if (status != 0) {
+        arg = tjs_new_error(ctx, status);
+    } else if (batching) {
+        /* All the connections libuv reports before the loop gets to run jobs
+         * end up in the same array. */
+        if (tjs__stream_accept_batch_add(ctx, s) == 0) {
+            return;
         }
+        arg = JS_GetException(ctx);
     } else {
-        arg = tjs_new_error(ctx, status);
-        is_reject = 1;
+        arg = tjs__stream_accept_one(ctx, s);
+        if (!JS_IsException(arg)) {
+            TJS_SettlePromise(ctx, &s->accept.result, 0, 1, &arg);
+            TJS_ClearPromise(ctx, &s->accept.result);
+            return;
+        }
+        arg = JS_GetException(ctx);
+    }
+
+    /* A batch is already on its way to JS, don't lose it for an error. */
+    if (!JS_IsUndefined(s->accept.batch)) {
+        JS_FreeValue(ctx, arg);
+        return;
     }
 
-    TJS_SettlePromise(ctx, &s->accept.result, is_reject, 1, &arg);
+    TJS_SettlePromise(ctx, &s->accept.result, 1, 1, &arg);
     TJS_ClearPromise(ctx, &s->accept.result);
+    s->accept.batch_max = 0;
 }
 
 static JSValue tjs_stream_listen(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
@@ -400,12 +883,70 @@ static JSValue tjs_stream_accept(JSContext *ctx, JSValue this_val, int argc, JSV
     if (!s) {
         return JS_EXCEPTION;
     }
+
+    tjs__stream_accept_batch_reset(ctx, s);
+
     if (TJS_IsPromisePending(ctx, &s->accept.result)) {
         return tjs_throw_errno(ctx, UV_EBUSY);
     }
+
+    if (s->accept.pending) {
+        JSValue obj = tjs__stream_accept_one(ctx, s);
+        if (JS_IsException(obj)) {
+            JSValue err = JS_GetException(ctx);
+            return TJS_NewRejectedPromise(ctx, 1, &err);
+        }
+        return TJS_NewResolvedPromise(ctx, 1, &obj);
+    }
+
     return TJS_InitPromise(ctx, &s->accept.result);
 }
 
+/*
+ * Like accept() but resolves to an array with up to `max` connections: every
+ * connection which becomes ready before the loop gets back to running JS, so
+ * a burst costs a single promise resolution.
+ */
+static JSValue tjs_stream_accept_many(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    JSClassID class_id;
+    TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
+    if (!s) {
+        return JS_EXCEPTION;
+    }
+
+    uint32_t max = 128;
+    if (!JS_IsUndefined(argv[0]) && JS_ToUint32(ctx, &max, argv[0])) {
+        return JS_EXCEPTION;
+    }
+    if (max == 0) {
+        return JS_ThrowRangeError(ctx, "max must be greater than 0");
+    }
+
+    tjs__stream_accept_batch_reset(ctx, s);
+
+    if (TJS_IsPromisePending(ctx, &s->accept.result)) {
+        return tjs_throw_errno(ctx, UV_EBUSY);
+    }
+
+    JSValue promise = TJS_InitPromise(ctx, &s->accept.result);
+    if (JS_IsException(promise)) {
+        return promise;
+    }
+
+    s->accept.batch_max = max;
+
+    /* A connection libuv held on to goes first, it also makes libuv resume
+     * watching the socket. */
+    if (s->accept.pending && tjs__stream_accept_batch_add(ctx, s) != 0) {
+        JSValue err = JS_GetException(ctx);
+        TJS_SettlePromise(ctx, &s->accept.result, 1, 1, &err);
+        TJS_ClearPromise(ctx, &s->accept.result);
+        s->accept.batch_max = 0;
+    }
+
+    return promise;
+}
+
 static JSValue tjs_stream_set_blocking(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
     JSClassID class_id;
     TJSStream *s = JS_GetAnyOpaque(this_val, &class_id);
@@ -431,9 +972,13 @@ static JSValue tjs_init_stream(JSContext *ctx, JSValue obj, TJSStream *s) {
     s->read.b.tarray = JS_UNDEFINED;
     s->read.b.data = NULL;
     s->read.b.len = 0;
+    s->read.on_data = JS_UNDEFINED;
+    s->pipe_out = NULL;
+    s->pipe_in = NULL;
 
     TJS_ClearPromise(ctx, &s->read.result);
     TJS_ClearPromise(ctx, &s->accept.result);
+    s->accept.batch = JS_UNDEFINED;
 
     JS_SetOpaque(obj, s);
     return obj;
@@ -444,9 +989,11 @@ static void tjs_stream_finalizer(JSRuntime *rt, TJSStream *s) {
         TJS_FreePromiseRT(rt, &s->accept.result);
         TJS_FreePromiseRT(rt, &s->read.result);
         JS_FreeValueRT(rt, s->read.b.tarray);
+        JS_FreeValueRT(rt, s->read.on_data);
+        JS_FreeValueRT(rt, s->accept.batch);
         s->finalized = 1;
         if (s->closed) {
-            js_free_rt(rt, s);
+            tjs__stream_release(s);
         } else {
             maybe_close(s);
         }
@@ -456,8 +1003,10 @@ static void tjs_stream_finalizer(JSRuntime *rt, TJSStream *s) {
 static void tjs_stream_mark(JSRuntime *rt, TJSStream *s, JS_MarkFunc *mark_func) {
     if (s) {
         JS_MarkValue(rt, s->read.b.tarray, mark_func);
+        JS_MarkValue(rt, s->read.on_data, mark_func);
         TJS_MarkPromise(rt, &s->read.result, mark_func);
         TJS_MarkPromise(rt, &s->accept.result, mark_func);
+        JS_MarkValue(rt, s->accept.batch, mark_func);
     }
 }
 
@@ -492,7 +1041,7 @@ static JSValue tjs_new_tcp(JSContext *ctx, int af) {
         return obj;
     }
 
-    s = tjs__mallocz(sizeof(*s));
+    s = tjs__stream_alloc(ctx);
     if (!s) {
         JS_FreeValue(ctx, obj);
         return JS_ThrowOutOfMemory(ctx);
@@ -501,7 +1050,7 @@ static JSValue tjs_new_tcp(JSContext *ctx, int af) {
     r = uv_tcp_init_ex(tjs_get_loop(ctx), &s->h.tcp, af);
     if (r != 0) {
         JS_FreeValue(ctx, obj);
-        tjs__free(s);
+        tjs__stream_release(s);
         return JS_ThrowInternalError(ctx, "couldn't initialize TCP handle");
     }
 
@@ -640,6 +1189,95 @@ static JSValue tjs_tcp_nodelay(JSContext *ctx, JSValue this_val, int argc, JSVal
     return JS_UNDEFINED;
 }
 
+static JSValue tjs_tcp_buffer_size(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSStream *t = tjs_tcp_get(ctx, this_val);
+    if (!t) {
+        return JS_EXCEPTION;
+    }
+
+    int size;
+    if (JS_ToInt32(ctx, &size, argv[0])) {
+        return JS_EXCEPTION;
+    }
+
+    /* libuv reads the current size when given 0. */
+    if (size <= 0) {
+        return tjs_throw_errno(ctx, UV_EINVAL);
+    }
+
+    int r;
+    if (magic == 0) {
+        r = uv_send_buffer_size(&t->h.handle, &size);
+    } else {
+        r = uv_recv_buffer_size(&t->h.handle, &size);
+    }
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    return JS_UNDEFINED;
+}
+
+enum {
+    TJS_TCP_OPT_FASTOPEN,
+    TJS_TCP_OPT_DEFER_ACCEPT,
+    TJS_TCP_OPT_QUICKACK,
+};
+
+/* Options libuv doesn't cover, set on the socket where the platform has them. */
+static JSValue tjs_tcp_setopt(JSContext *ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+    TJSStream *t = tjs_tcp_get(ctx, this_val);
+    if (!t) {
+        return JS_EXCEPTION;
+    }
+
+    int value;
+    if (magic == TJS_TCP_OPT_QUICKACK) {
+        if ((value = JS_ToBool(ctx, argv[0])) == -1) {
+            return JS_EXCEPTION;
+        }
+    } else if (JS_ToInt32(ctx, &value, argv[0])) {
+        return JS_EXCEPTION;
+    }
+
+    int optname;
+    switch (magic) {
+#ifdef TCP_FASTOPEN
+        case TJS_TCP_OPT_FASTOPEN:
+            optname = TCP_FASTOPEN;
+            break;
+#endif
+#ifdef TCP_DEFER_ACCEPT
+        case TJS_TCP_OPT_DEFER_ACCEPT:
+            optname = TCP_DEFER_ACCEPT;
+            break;
+#endif
+#ifdef TCP_QUICKACK
+        case TJS_TCP_OPT_QUICKACK:
+            optname = TCP_QUICKACK;
+            break;
+#endif
+        default:
+            return tjs_throw_errno(ctx, UV_ENOTSUP);
+    }
+
+    uv_os_fd_t fd;
+    int r = uv_fileno(&t->h.handle, &fd);
+    if (r != 0) {
+        return tjs_throw_errno(ctx, r);
+    }
+
+    if (setsockopt((uv_os_sock_t) fd, IPPROTO_TCP, optname, (const char *) &value, sizeof(value)) != 0) {
+#ifdef _WIN32
+        return tjs_throw_errno(ctx, uv_translate_sys_error(WSAGetLastError()));
+#else
+        return tjs_throw_errno(ctx, uv_translate_sys_error(errno));
+#endif
+    }
+
+    return JS_UNDEFINED;
+}
+
 
 /* TTY */
 
@@ -679,7 +1317,7 @@ static JSValue tjs_tty_constructor(JSContext *ctx, JSValue new_target, int argc,
         return obj;
     }
 
-    s = tjs__mallocz(sizeof(*s));
+    s = tjs__stream_alloc(ctx);
     if (!s) {
         JS_FreeValue(ctx, obj);
         return JS_ThrowOutOfMemory(ctx);
@@ -688,7 +1326,7 @@ static JSValue tjs_tty_constructor(JSContext *ctx, JSValue new_target, int argc,
     r = uv_tty_init(tjs_get_loop(ctx), &s->h.tty, fd, readable);
     if (r != 0) {
         JS_FreeValue(ctx, obj);
-        tjs__free(s);
+        tjs__stream_release(s);
         return JS_ThrowInternalError(ctx, "couldn't initialize TTY handle");
     }
 
@@ -767,7 +1405,7 @@ JSValue tjs_new_pipe(JSContext *ctx) {
         return obj;
     }
 
-    s = tjs__mallocz(sizeof(*s));
+    s = tjs__stream_alloc(ctx);
     if (!s) {
         JS_FreeValue(ctx, obj);
         return JS_ThrowOutOfMemory(ctx);
@@ -776,7 +1414,7 @@ JSValue tjs_new_pipe(JSContext *ctx) {
     r = uv_pipe_init(tjs_get_loop(ctx), &s->h.pipe, 0);
     if (r != 0) {
         JS_FreeValue(ctx, obj);
-        tjs__free(s);
+        tjs__stream_release(s);
         return JS_ThrowInternalError(ctx, "couldn't initialize Pipe handle");
     }
 
@@ -898,16 +1536,355 @@ static JSValue tjs_pipe_open(JSContext *ctx, JSValue this_val, int argc, JSValue
     return JS_UNDEFINED;
 }
 
+/*
+ * Piping between streams.
+ *
+ * pipe(src, dst) moves everything read from one stream into the other
+ * without calling into JS: reads land in the slab pool and are written with
+ * uv_try_write(), only what doesn't go through right away is queued with
+ * uv_write(), keeping its slab alive. Reading stops while the destination has
+ * highWaterMark bytes queued and starts again as they are written.
+ */
+
+typedef struct TJSStreamPipe {
+    struct TJSStreamPipe *prev; /* in the runtime's list of live pipes */
+    struct TJSStreamPipe *next;
+    JSContext *ctx; /* NULL once detached from JS */
+    TJSStream *src;
+    TJSStream *dst;
+    JSValue src_obj; /* the streams are kept alive while piping */
+    JSValue dst_obj;
+    TJSPromise result;
+    uv_shutdown_t shutdown_req;
+    size_t high_water_mark;
+    uint64_t bytes;
+    uint32_t nwrites;
+    int error;
+    bool end;       /* shut down the destination at the end */
+    bool done;      /* no more reads */
+    bool paused;    /* reading stopped because of backpressure */
+    bool finishing; /* waiting for the shutdown */
+} TJSStreamPipe;
+
+typedef struct {
+    uv_write_t req;
+    TJSStreamPipe *pipe;
+    TJSReadSlab *slab;
+} TJSStreamPipeWriteReq;
+
+static void uv__pipe_read_cb(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf);
+
+/* Settles the promise and lets go of the streams. */
+static void tjs__pipe_detach(TJSStreamPipe *p) {
+    JSContext *ctx = p->ctx;
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    JSValue arg;
+
+    if (p->prev) {
+        p->prev->next = p->next;
+    } else {
+        qrt->pipes = p->next;
+    }
+    if (p->next) {
+        p->next->prev = p->prev;
+    }
+
+    p->src->pipe_out = NULL;
+    p->dst->pipe_in = NULL;
+    p->src = NULL;
+    p->dst = NULL;
+    p->ctx = NULL;
+
+    if (p->error) {
+        arg = tjs_new_error(ctx, p->error);
+    } else {
+        arg = JS_NewInt64(ctx, p->bytes);
+    }
+
+    TJS_SettlePromise(ctx, &p->result, p->error != 0, 1, &arg);
+    JS_FreeValue(ctx, p->src_obj);
+    JS_FreeValue(ctx, p->dst_obj);
+}
+
+static void tjs__pipe_settle(TJSStreamPipe *p) {
+    if (p->ctx) {
+        tjs__pipe_detach(p);
+    }
+
+    tjs__free(p);
+}
+
+static void uv__pipe_shutdown_cb(uv_shutdown_t *req, int status) {
+    TJSStreamPipe *p = req->data;
+
+    if (status < 0 && status != UV_ECANCELED && !p->error) {
+        p->error = status;
+    }
+
+    tjs__pipe_settle(p);
+}
+
+static void tjs__pipe_maybe_finish(TJSStreamPipe *p) {
+    if (!p->done || p->nwrites > 0 || p->finishing) {
+        return;
+    }
+
+    if (!p->error && p->end && !uv_is_closing(&p->dst->h.handle)) {
+        p->shutdown_req.data = p;
+        if (uv_shutdown(&p->shutdown_req, &p->dst->h.stream, uv__pipe_shutdown_cb) == 0) {
+            p->finishing = true;
+            return;
+        }
+    }
+
+    tjs__pipe_settle(p);
+}
+
+static void tjs__pipe_abort(TJSStreamPipe *p, int error) {
+    if (!p->error) {
+        p->error = error;
+    }
+
+    if (!p->done) {
+        p->done = true;
+        uv_read_stop(&p->src->h.stream);
+    }
+
+    tjs__pipe_maybe_finish(p);
+}
+
+static void uv__pipe_write_cb(uv_write_t *req, int status) {
+    TJSStreamPipeWriteReq *wr = req->data;
+    TJSStreamPipe *p = wr->pipe;
+
+    tjs__read_slab_unref(wr->slab);
+    tjs__free(wr);
+    p->nwrites--;
+
+    if (status < 0) {
+        tjs__pipe_abort(p, status);
+        return;
+    }
+
+    if (p->paused && !p->done &&
+        uv_stream_get_write_queue_size(&p->dst->h.stream) < p->high_water_mark) {
+        int r = uv_read_start(&p->src->h.stream, uv__stream_slab_alloc_cb, uv__pipe_read_cb);
+        if (r != 0) {
+            tjs__pipe_abort(p, r);
+            return;
+        }
+        p->paused = false;
+    }
+
+    tjs__pipe_maybe_finish(p);
+}
+
+static void uv__pipe_read_cb(uv_stream_t *handle, ssize_t nread, const uv_buf_t *buf) {
+    TJSStream *s = handle->data;
+    CHECK_NOT_NULL(s);
+
+    TJSStreamPipe *p = s->pipe_out;
+    CHECK_NOT_NULL(p);
+
+    if (nread == 0) {
+        return;
+    }
+
+    if (nread < 0) {
+        tjs__pipe_abort(p, nread == UV_EOF ? 0 : nread);
+        return;
+    }
+
+    p->bytes += nread;
+
+    uv_stream_t *dst = &p->dst->h.stream;
+    uv_buf_t wbuf = uv_buf_init(buf->base, nread);
+    int r = uv_try_write(dst, &wbuf, 1);
+
+    /* All written, the slab space can be read into again. */
+    if (r == nread) {
+        return;
+    }
+
+    if (r < 0 && r != UV_EAGAIN) {
+        tjs__pipe_abort(p, r);
+        return;
+    }
+
+    if (r > 0) {
+        wbuf.base += r;
+        wbuf.len -= r;
+    }
+
+    TJSReadSlab *slab = TJS_GetRuntime(p->ctx)->read_slabs.current;
+    CHECK_NOT_NULL(slab);
+
+    TJSStreamPipeWriteReq *wr = tjs__malloc(sizeof(*wr));
+    if (!wr) {
+        tjs__pipe_abort(p, UV_ENOMEM);
+        return;
+    }
+
+    wr->req.data = wr;
+    wr->pipe = p;
+    wr->slab = slab;
+
+    r = uv_write(&wr->req, dst, &wbuf, 1, uv__pipe_write_cb);
+    if (r != 0) {
+        tjs__free(wr);
+        tjs__pipe_abort(p, r);
+        return;
+    }
+
+    /* The slab holds the data until it's written. */
+    slab->refs++;
+    slab->used += (nread + 7) & ~7;
+    if (slab->used > TJS__READ_SLAB_SIZE) {
+        slab->used = TJS__READ_SLAB_SIZE;
+    }
+    p->nwrites++;
+
+    if (uv_stream_get_write_queue_size(dst) >= p->high_water_mark) {
+        uv_read_stop(handle);
+        p->paused = true;
+    }
+}
+
+static TJSStream *tjs__stream_get(JSContext *ctx, JSValue obj) {
+    JSClassID class_id;
+    TJSStream *s = JS_GetAnyOpaque(obj, &class_id);
+    if (!s || (class_id != tjs_tcp_class_id && class_id != tjs_tty_class_id && class_id != tjs_pipe_class_id)) {
+        JS_ThrowTypeError(ctx, "expected a stream");
+        return NULL;
+    }
+
+    return s;
+}
+
+static JSValue tjs_stream_pipe(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSStream *src = tjs__stream_get(ctx, argv[0]);
+    if (!src) {
+        return JS_EXCEPTION;
+    }
+
+    TJSStream *dst = tjs__stream_get(ctx, argv[1]);
+    if (!dst) {
+        return JS_EXCEPTION;
+    }
+
+    if (src == dst) {
+        return tjs_throw_errno(ctx, UV_EINVAL);
+    }
+
+    if (src->pipe_out || dst->pipe_in || TJS_IsPromisePending(ctx, &src->read.result) ||
+        !JS_IsUndefined(src->read.on_data)) {
+        return tjs_throw_errno(ctx, UV_EBUSY);
+    }
+
+    int64_t hwm = 0;
+    if (!JS_IsUndefined(argv[3]) && JS_ToInt64(ctx, &hwm, argv[3])) {
+        return JS_EXCEPTION;
+    }
+
+    /* Not owned by the JS runtime, writes may still complete after it's gone. */
+    TJSStreamPipe *p = tjs__mallocz(sizeof(*p));
+    if (!p) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    p->ctx = ctx;
+    p->src = src;
+    p->dst = dst;
+    p->end = JS_ToBool(ctx, argv[2]);
+    p->high_water_mark = hwm > 0 ? hwm : TJS__READ_SLAB_SIZE;
+
+    int r = uv_read_start(&src->h.stream, uv__stream_slab_alloc_cb, uv__pipe_read_cb);
+    if (r != 0) {
+        tjs__free(p);
+        return tjs_throw_errno(ctx, r);
+    }
+
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    p->next = qrt->pipes;
+    if (p->next) {
+        p->next->prev = p;
+    }
+    qrt->pipes = p;
+
+    src->pipe_out = p;
+    dst->pipe_in = p;
+    p->src_obj = JS_DupValue(ctx, argv[0]);
+    p->dst_obj = JS_DupValue(ctx, argv[1]);
+
+    return TJS_InitPromise(ctx, &p->result);
+}
+
+/*
+ * Pipes hold strong references to their streams, so they are aborted before the
+ * JS runtime goes away. Pending writes and shutdowns are cancelled once the
+ * streams are closed, the last of them frees the pipe.
+ */
+void tjs__stream_pipes_abort(TJSRuntime *qrt) {
+    TJSStreamPipe *p;
+
+    while ((p = qrt->pipes)) {
+        if (!p->error) {
+            p->error = UV_ECANCELED;
+        }
+        if (!p->done) {
+            p->done = true;
+            uv_read_stop(&p->src->h.stream);
+        }
+
+        tjs__pipe_detach(p);
+        tjs__pipe_maybe_finish(p);
+    }
+}
+
+static JSValue tjs__pool_stats(JSContext *ctx, TJSFreeList *l) {
+    JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
+
+    JS_DefinePropertyValueStr(ctx, obj, "hits", JS_NewInt64(ctx, l->hits), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, obj, "misses", JS_NewInt64(ctx, l->misses), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, obj, "free", JS_NewUint32(ctx, l->len), JS_PROP_C_W_E);
+
+    return obj;
+}
+
+static JSValue tjs_stream_pool_stats(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+    TJSRuntime *qrt = TJS_GetRuntime(ctx);
+    JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
+
+    JS_DefinePropertyValueStr(ctx, obj, "streams", tjs__pool_stats(ctx, &qrt->stream_pools.streams), JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx,
+                              obj,
+                              "writeReqs",
+                              tjs__pool_stats(ctx, &qrt->stream_pools.write_reqs),
+                              JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx,
+                              obj,
+                              "shutdownReqs",
+                              tjs__pool_stats(ctx, &qrt->stream_pools.shutdown_reqs),
+                              JS_PROP_C_W_E);
+    JS_DefinePropertyValueStr(ctx, obj, "freeSlabs", JS_NewUint32(ctx, qrt->read_slabs.nfree), JS_PROP_C_W_E);
+
+    return obj;
+}
+
 /* clang-format off */
 static const JSCFunctionListEntry tjs_stream_proto_funcs[] = {
     TJS_CFUNC_DEF("listen", 1, tjs_stream_listen),
     TJS_CFUNC_DEF("accept", 0, tjs_stream_accept),
+    TJS_CFUNC_DEF("acceptMany", 1, tjs_stream_accept_many),
     TJS_CFUNC_DEF("shutdown", 0, tjs_stream_shutdown),
     TJS_CFUNC_DEF("setBlocking", 1, tjs_stream_set_blocking),
     TJS_CFUNC_DEF("close", 0, tjs_stream_close),
     TJS_CFUNC_DEF("read", 1, tjs_stream_read),
+    TJS_CFUNC_DEF("readStart", 1, tjs_stream_read_start),
+    TJS_CFUNC_DEF("readStop", 0, tjs_stream_read_stop),
     TJS_CFUNC_DEF("write", 1, tjs_stream_write),
     TJS_CFUNC_DEF("fileno", 0, tjs_stream_fileno),
+    TJS_CGETSET_DEF("writeQueueSize", tjs_stream_write_queue_size_get, NULL),
 };
 /* clang-format on */
 
@@ -918,6 +1895,11 @@ static const JSCFunctionListEntry tjs_tcp_proto_funcs[] = {
     TJS_CFUNC_DEF("bind", 2, tjs_tcp_bind),
     TJS_CFUNC_DEF("setKeepAlive", 2, tjs_tcp_keepalive),
     TJS_CFUNC_DEF("setNoDelay", 1, tjs_tcp_nodelay),
+    JS_CFUNC_MAGIC_DEF("setSendBufferSize", 1, tjs_tcp_buffer_size, 0),
+    JS_CFUNC_MAGIC_DEF("setRecvBufferSize", 1, tjs_tcp_buffer_size, 1),
+    JS_CFUNC_MAGIC_DEF("setFastOpen", 1, tjs_tcp_setopt, TJS_TCP_OPT_FASTOPEN),
+    JS_CFUNC_MAGIC_DEF("setDeferAccept", 1, tjs_tcp_setopt, TJS_TCP_OPT_DEFER_ACCEPT),
+    JS_CFUNC_MAGIC_DEF("setQuickAck", 1, tjs_tcp_setopt, TJS_TCP_OPT_QUICKACK),
 };
 
 static const JSCFunctionListEntry tjs_tty_proto_funcs[] = {
@@ -935,8 +1917,13 @@ static const JSCFunctionListEntry tjs_pipe_proto_funcs[] = {
 
 static const JSCFunctionListEntry tjs_streams_funcs[] = {
     TJS_UVCONST(TCP_IPV6ONLY),
+#if UV_VERSION_HEX >= ((1 << 16) | (49 << 8))
+    TJS_UVCONST(TCP_REUSEPORT),
+#endif
     TJS_UVCONST(TTY_MODE_NORMAL),
     TJS_UVCONST(TTY_MODE_RAW),
+    TJS_CFUNC_DEF("pipe", 4, tjs_stream_pipe),
+    TJS_CFUNC_DEF("streamPoolStats", 0, tjs_stream_pool_stats),
 };
 
 void tjs__mod_streams_init(JSContext *ctx, JSValue ns) {
@@ -38,6 +38,14 @@
 
 typedef struct TJSTimer TJSTimer;
 
+/* Recycled fixed size allocations, linked through their first word. */
+typedef struct {
+    void *head;
+    uint32_t len;
+    uint64_t hits;
+    uint64_t misses;
+} TJSFreeList;
+
 struct TJSRuntime {
     TJSRunOptions options;
     JSRuntime *rt;
@@ -58,10 +66,34 @@ struct TJSRuntime {
     struct {
         IM3Environment env;
     } wasm_ctx;
+    struct {
+        JSAtom *atoms; /* well-known HTTP header names and methods */
+        uv_timer_t date_timer;
+        char date[64]; /* cached "Date: ...\r\n" line */
+        size_t date_len;
+        struct {
+            uv_timer_t handle;
+            struct TJSHttpTimer *slots; /* list heads, allocated on first use */
+            uint64_t tick;
+            uint32_t count;
+        } wheel;
+    } http_ctx;
+    struct {
+        struct TJSReadSlab *current; /* reads go here until it's full */
+        struct TJSReadSlab *free; /* no longer referenced from JS */
+        uint32_t nfree;
+    } read_slabs;
+    struct TJSStreamPipe *pipes; /* live stream pipes, aborted at teardown */
+    struct {
+        TJSFreeList streams;
+        TJSFreeList write_reqs;
+        TJSFreeList shutdown_reqs;
+    } stream_pools;
     struct {
         TJSTimer *timers;
         int64_t next_timer;
     } timers;
+    struct TJSMapping *mappings; /* live tjs.mmap() buffers, keyed by their data */
     struct {
         JSValue promise_event_ctor;
         JSValue dispatch_event_func;
@@ -74,6 +106,7 @@ void tjs__mod_error_init(JSContext *ctx, JSValue ns);
 void tjs__mod_ffi_init(JSContext *ctx, JSValue ns);
 void tjs__mod_fs_init(JSContext *ctx, JSValue ns);
 void tjs__mod_fswatch_init(JSContext *ctx, JSValue ns);
+void tjs__mod_httpserver_init(JSContext *ctx, JSValue ns);
 void tjs__mod_os_init(JSContext *ctx, JSValue ns);
 void tjs__mod_process_init(JSContext *ctx, JSValue ns);
 void tjs__mod_signals_init(JSContext *ctx, JSValue ns);
@@ -92,6 +125,9 @@ void tjs__mod_llhttp_init(JSContext *ctx, JSValue ns);
 void tjs__mod_posix_socket_init(JSContext *ctx, JSValue ns);
 #endif
 
+void tjs__stream_pipes_abort(TJSRuntime *qrt);
+void tjs__stream_pools_free(TJSRuntime *qrt);
+
 JSValue tjs_new_error(JSContext *ctx, int err);
 JSValue tjs_throw_errno(JSContext *ctx, int err);
 
@@ -100,6 +136,11 @@ uv_stream_t *tjs_pipe_get_stream(JSContext *ctx, JSValue obj);
 
 void tjs__execute_jobs(JSContext *ctx);
 JSModuleDef *tjs__load_builtin(JSContext *ctx, const char *name);
+/* Loaders read files into a buffer sized from fstat(), plus this much room, and grow it by
+ * TJS__LOAD_FILE_GROW when a file turns out to be bigger. */
+#define TJS__LOAD_FILE_SLACK 64
+#define TJS__LOAD_FILE_GROW  (64 * 1024)
+
 int tjs__load_file(JSContext *ctx, DynBuf *dbuf, const char *filename);
 JSModuleDef *tjs_module_loader(JSContext *ctx, const char *module_name, void *opaque);
 char *tjs_module_normalizer(JSContext *ctx, const char *base_name, const char *name, void *opaque);
@@ -33,6 +33,7 @@ typedef struct TJSRuntime TJSRuntime;
 typedef struct TJSRunOptions {
     int mem_limit;
     size_t stack_size;
+    bool io_uring; /* file operations through io_uring where available (Linux) */
 } TJSRunOptions;
 
 void TJS_DefaultOptions(TJSRunOptions *options);
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 
+#include "http-utils.h"
 #include "mem.h"
 #include "private.h"
 #include "tjs.h"
@@ -124,6 +125,7 @@ static void tjs__bootstrap_core(JSContext *ctx, JSValue ns) {
     tjs__mod_ffi_init(ctx, ns);
     tjs__mod_fs_init(ctx, ns);
     tjs__mod_fswatch_init(ctx, ns);
+    tjs__mod_httpserver_init(ctx, ns);
     tjs__mod_os_init(ctx, ns);
     tjs__mod_process_init(ctx, ns);
     tjs__mod_signals_init(ctx, ns);
@@ -220,6 +222,31 @@ void TJS_DefaultOptions(TJSRunOptions *options) {
     static TJSRunOptions default_options = { .mem_limit = 0, .stack_size = TJS__DEFAULT_STACK_SIZE };
 
     memcpy(options, &default_options, sizeof(*options));
+
+    /* Opt-in, see tjs__loop_configure(). */
+    char buf[8];
+    size_t size = sizeof(buf);
+    options->io_uring = uv_os_getenv("TJS_IO_URING", buf, &size) == 0 && strcmp(buf, "1") == 0;
+}
+
+static void tjs__loop_configure(uv_loop_t *loop, TJSRunOptions *options) {
+    if (!options->io_uring) {
+        return;
+    }
+
+#if defined(__linux__) && UV_VERSION_HEX >= ((1 << 16) | (49 << 8))
+    /* libuv submits file operations (open, close, read, write, stat, fsync...) to an io_uring
+     * from the loop thread instead of handing them to the thread pool. If the kernel doesn't
+     * support it, they keep going to the thread pool. */
+    int r = uv_loop_configure(loop, UV_LOOP_USE_IO_URING_SQPOLL);
+#else
+    (void) loop;
+    int r = UV_ENOTSUP;
+#endif
+
+    if (r != 0) {
+        fprintf(stderr, "Warning: io_uring was requested but can't be used: %s\n", uv_strerror(r));
+    }
 }
 
 TJSRuntime *TJS_NewRuntime(void) {
@@ -270,6 +297,7 @@ TJSRuntime *TJS_NewRuntimeInternal(bool is_worker, TJSRunOptions *options) {
     JS_SetCanBlock(rt, is_worker);
 
     CHECK_EQ(uv_loop_init(&qrt->loop), 0);
+    tjs__loop_configure(&qrt->loop, options);
 
     /* handle which runs the job queue */
     CHECK_EQ(uv_prepare_init(&qrt->loop, &qrt->jobs.prepare), 0);
@@ -339,10 +367,20 @@ void TJS_FreeRuntime(TJSRuntime *qrt) {
     if (qrt->curl_ctx.curlm_h) {
         uv_close((uv_handle_t *) &qrt->curl_ctx.timer, NULL);
     }
+    if (qrt->http_ctx.date_len) {
+        uv_close((uv_handle_t *) &qrt->http_ctx.date_timer, NULL);
+    }
+    tjs__http_timers_close(qrt);
 
     /* Destroy all timers */
     tjs__destroy_timers(qrt);
 
+    /* Stop stream pipes, they keep their streams alive. */
+    tjs__stream_pipes_abort(qrt);
+
+    /* Release cached HTTP atoms. */
+    tjs__http_free_atoms(qrt);
+
     /* Destroy the JS engine. */
     JS_FreeValue(qrt->ctx, qrt->builtins.dispatch_event_func);
     qrt->builtins.dispatch_event_func = JS_UNDEFINED;
@@ -350,6 +388,8 @@ void TJS_FreeRuntime(TJSRuntime *qrt) {
     qrt->builtins.promise_event_ctor = JS_UNDEFINED;
     JS_FreeContext(qrt->ctx);
     JS_FreeRuntime(qrt->rt);
+    tjs__http_timers_free(qrt);
+    tjs__stream_pools_free(qrt);
 
     /* Destroy CURLM handle. */
     if (qrt->curl_ctx.curlm_h) {
@@ -509,22 +549,35 @@ int tjs__load_file(JSContext *ctx, DynBuf *dbuf, const char *filename) {
     }
 
     fd = r;
-    char buf[64 * 1024];
-    uv_buf_t b = uv_buf_init(buf, sizeof(buf));
+
+    /* Allocate once for the whole file, plus some room for what callers append (a NUL
+     * terminator, the end of the JSON module template). */
+    r = uv_fs_fstat(NULL, &req, fd, NULL);
+    size_t size_hint = r == 0 ? req.statbuf.st_size : 0;
+    uv_fs_req_cleanup(&req);
+
+    r = dbuf_realloc(dbuf, dbuf->size + size_hint + TJS__LOAD_FILE_SLACK) ? UV_ENOMEM : 0;
     size_t offset = 0;
 
-    do {
+    /* Read straight into the buffer. Files may be bigger than reported (e.g. in /proc) or grow
+     * meanwhile, so read until EOF. */
+    while (r == 0) {
+        if (dbuf->allocated_size - dbuf->size < TJS__LOAD_FILE_SLACK &&
+            dbuf_realloc(dbuf, dbuf->allocated_size + TJS__LOAD_FILE_GROW)) {
+            r = UV_ENOMEM;
+            break;
+        }
+
+        uv_buf_t b = uv_buf_init((char *) dbuf->buf + dbuf->size, dbuf->allocated_size - dbuf->size);
         r = uv_fs_read(NULL, &req, fd, &b, 1, offset, NULL);
         uv_fs_req_cleanup(&req);
         if (r <= 0) {
             break;
         }
         offset += r;
-        r = dbuf_put(dbuf, (const uint8_t *) b.base, r);
-        if (r != 0) {
-            break;
-        }
-    } while (1);
+        dbuf->size += r;
+        r = 0;
+    }
 
     uv_fs_close(NULL, &req, fd, NULL);
     uv_fs_req_cleanup(&req);
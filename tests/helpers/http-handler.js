@@ -0,0 +1,11 @@
+// Workers import their own copy of this module, so this stays 'worker' there.
+let servedBy = 'worker';
+
+export function markMain() {
+    servedBy = 'main';
+}
+
+export default function handler(req, res) {
+    res.writeHead(200, { 'Content-Type': 'text/plain', 'X-Served-By': servedBy });
+    res.end(`ok ${req.url}`);
+}
@@ -0,0 +1,18 @@
+// Starts a pipe which never finishes: the source stays open and the sink never reads.
+const source = await tjs.listen('tcp', '127.0.0.1');
+const sink = await tjs.listen('tcp', '127.0.0.1');
+
+(async () => {
+    const conn = await source.accept();
+
+    await conn.write(new Uint8Array(1024 * 1024));
+})();
+
+sink.accept();
+
+const from = await tjs.connect('tcp', '127.0.0.1', source.localAddress.port);
+const to = await tjs.connect('tcp', '127.0.0.1', sink.localAddress.port);
+
+from.pipeTo(to);
+
+postMessage('piping');
@@ -25,7 +25,7 @@ function testChunkedParsing() {
   
   console.assert(result.method === "GET", `Method should be GET, got: ${result.method}`);
   console.assert(result.url === "/api/test", `URL should be /api/test, got: ${result.url}`);
-  console.assert(result.headers.Host === "localhost:3000", `Host header incorrect, got: ${result.headers.Host}`);
+  console.assert(result.headers.host === "localhost:3000", `Host header incorrect, got: ${result.headers.host}`);
   console.assert(result.body === '{"key": "value123"}', `Body incorrect, got: ${result.body}`);
   console.assert(result.complete === true, "Message should be complete");
   
@@ -51,7 +51,7 @@ function testParserReset() {
   result = parser.getResult();
   console.assert(result.method === "POST", `Method should be POST, got: ${result.method}`);
   console.assert(result.url === "/second", `Second URL should be /second, got: ${result.url}`);
-  console.assert(result.headers.Host === "test.com", `Host should be test.com, got: ${result.headers.Host}`);
+  console.assert(result.headers.host === "test.com", `Host should be test.com, got: ${result.headers.host}`);
   
   console.log("✓ Parser reset test passed!");
 }
@@ -80,8 +80,124 @@ function testConstants() {
   console.log("✓ Constants test passed!");
 }
 
+// Test raw headers, split across execute() calls and reused after reset
+function testRawHeaders() {
+  const parser = new LLHttp("request");
+
+  for (let round = 0; round < 2; round++) {
+    parser.execute("GET / HTTP/1.1\r\nX-Spl");
+    parser.execute("it: a\r\nSet-Cookie: one\r\nSet-Cookie: two\r\nX-Empty:\r\n\r\n");
+
+    const raw = parser.getRawHeaders();
+    const expected = ["X-Split", "a", "Set-Cookie", "one", "Set-Cookie", "two", "X-Empty", ""];
+    console.assert(
+      JSON.stringify(raw) === JSON.stringify(expected),
+      `Raw headers mismatch, got: ${JSON.stringify(raw)}`
+    );
+
+    const result = parser.getResult();
+    console.assert(result.headers["x-split"] === "a", `X-Split mismatch, got: ${result.headers["x-split"]}`);
+    console.assert(result.headers["x-empty"] === "", `X-Empty mismatch, got: ${result.headers["x-empty"]}`);
+
+    parser.reset();
+  }
+
+  console.log("✓ Raw headers test passed!");
+}
+
+// Test header names are lowercased and duplicates merged like Node
+function testHeaderNormalization() {
+  const parser = new LLHttp("request");
+  parser.execute("GET / HTTP/1.1\r\nHOST: a\r\nAccept: x\r\naccept: y\r\nSet-Cookie: 1\r\nSet-Cookie: 2\r\n\r\n");
+
+  const result = parser.getResult();
+  console.assert(result.method === "GET", `Method should be GET, got: ${result.method}`);
+  console.assert(result.headers.host === "a", `host mismatch, got: ${result.headers.host}`);
+  console.assert(result.headers.accept === "x, y", `accept mismatch, got: ${result.headers.accept}`);
+  console.assert(
+    JSON.stringify(result.headers["set-cookie"]) === '["1","2"]',
+    `set-cookie mismatch, got: ${JSON.stringify(result.headers["set-cookie"])}`
+  );
+
+  console.log("✓ Header normalization test passed!");
+}
+
+// Test binary bodies are streamed through onBody and limited by maxBodySize
+function testBinaryBody() {
+  const parser = new LLHttp("request");
+  const head = new TextEncoder().encode("POST / HTTP/1.1\r\nContent-Length: 4\r\n\r\n");
+  const chunks = [];
+
+  parser.onBody = chunk => chunks.push(...chunk);
+  parser.execute(head);
+  parser.execute(new Uint8Array([ 0x00, 0xff ]));
+  parser.execute(new Uint8Array([ 0xfe, 0x80 ]));
+
+  console.assert(parser.getResult().complete === true, "Message should be complete");
+  console.assert(chunks.join() === "0,255,254,128", `Body bytes mismatch, got: ${chunks.join()}`);
+
+  const limited = new LLHttp("request");
+  limited.maxBodySize = 2;
+
+  try {
+    limited.execute("POST / HTTP/1.1\r\nContent-Length: 4\r\n\r\nabcd");
+    console.assert(false, "Should have thrown an error");
+  } catch (e) {
+    console.assert(e.message.includes("maxBodySize"), `Should be a body size error, got: ${e.message}`);
+  }
+
+  console.log("✓ Binary body test passed!");
+}
+
+// Test pipelined messages in one buffer are all returned, in order
+function testPipelining() {
+  const parser = new LLHttp("request");
+
+  parser.execute(
+    "GET /a HTTP/1.1\r\nHost: x\r\n\r\n" +
+    "POST /b HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi" +
+    "GET /c HTTP/1.1\r\n"
+  );
+
+  const results = parser.getResults();
+
+  console.assert(results.length === 2, `Should have 2 complete messages, got: ${results.length}`);
+  console.assert(results[0].url === "/a" && results[0].method === "GET", "First message mismatch");
+  console.assert(results[1].url === "/b" && results[1].body === "hi", "Second message mismatch");
+  console.assert(parser.getResults().length === 0, "Results should only be returned once");
+
+  parser.execute("\r\n");
+
+  const last = parser.getResults();
+
+  console.assert(last.length === 1 && last[0].url === "/c", "Third message should complete on its own");
+  console.assert(parser.getResult().url === "/c", "getResult() should return the last message");
+
+  console.log("✓ Pipelining test passed!");
+}
+
+// Test a trailing CRLF after a message doesn't report it twice
+function testPipeliningTrailingCRLF() {
+  const parser = new LLHttp("request");
+
+  parser.execute("GET /a HTTP/1.1\r\nHost: x\r\n\r\n\r\n");
+
+  const results = parser.getResults();
+
+  console.assert(results.length === 1, `Should have 1 complete message, got: ${results.length}`);
+  console.assert(results[0].url === "/a", "Message mismatch");
+  console.assert(parser.getResults().length === 0, "Results should only be returned once");
+
+  console.log("✓ Pipelining trailing CRLF test passed!");
+}
+
 // Run tests
 testChunkedParsing();
 testParserReset();
 testErrorHandling();
-testConstants();
\ No newline at end of file
+testConstants();
+testRawHeaders();
+testHeaderNormalization();
+testBinaryBody();
+testPipelining();
+testPipeliningTrailingCRLF();
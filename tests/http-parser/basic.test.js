@@ -16,12 +16,12 @@ function testBasicRequestParsing() {
   console.assert(result.httpMajor === 1, `HTTP major should be 1, got: ${result.httpMajor}`);
   console.assert(result.httpMinor === 1, `HTTP minor should be 1, got: ${result.httpMinor}`);
   console.assert(
-    result.headers.Host === "example.com",
-    `Host header mismatch, got: ${result.headers.Host}`
+    result.headers.host === "example.com",
+    `Host header mismatch, got: ${result.headers.host}`
   );
   console.assert(
-    result.headers["Content-Type"] === "text/plain",
-    `Content-Type header mismatch, got: ${result.headers["Content-Type"]}`
+    result.headers["content-type"] === "text/plain",
+    `Content-Type header mismatch, got: ${result.headers["content-type"]}`
   );
   console.assert(result.body === "Hello World", `Body mismatch, got: ${result.body}`);
   console.assert(result.complete === true, "Message should be complete");
@@ -43,8 +43,8 @@ function testBasicResponseParsing() {
   console.assert(result.httpMajor === 1, `HTTP major should be 1, got: ${result.httpMajor}`);
   console.assert(result.httpMinor === 1, `HTTP minor should be 1, got: ${result.httpMinor}`);
   console.assert(
-    result.headers["Content-Type"] === "application/json",
-    `Content-Type header mismatch, got: ${result.headers["Content-Type"]}`
+    result.headers["content-type"] === "application/json",
+    `Content-Type header mismatch, got: ${result.headers["content-type"]}`
   );
   console.assert(result.body === '{"message":"success"}', `Body mismatch, got: ${result.body}`);
   console.assert(result.complete === true, "Message should be complete");
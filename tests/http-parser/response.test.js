@@ -30,6 +30,10 @@ function testResponseCreationWithStatusCodes() {
   const errorResponse = parser.createResponse(500, {"Content-Type": "application/json"}, '{"error":"Internal Server Error"}');
   const expected500 = `HTTP/1.1 500 Internal Server Error\r\nContent-Type: application/json\r\n\r\n{"error":"Internal Server Error"}`;
   console.assert(errorResponse === expected500, "500 response creation failed");
+
+  // Test response without headers and body
+  const createdResponse = parser.createResponse(201);
+  console.assert(createdResponse === "HTTP/1.1 201 Created\r\n\r\n", "201 response creation failed");
   
   console.log("✓ Response creation with status codes test passed!");
 }
@@ -0,0 +1,68 @@
+import assert from 'tjs:assert';
+
+
+if (tjs.system.platform !== 'windows') {
+    const encoder = new TextEncoder();
+    const decoder = new TextDecoder();
+    const content = 'abcdefghijklmnopqrstuvwxyz'.repeat(1000);
+    const f = await tjs.makeTempFile('test_mmapXXXXXX');
+    const path = f.path;
+
+    await f.write(encoder.encode(content));
+    await f.close();
+
+    let buf = await tjs.mmap(path);
+
+    assert.ok(buf instanceof ArrayBuffer, 'an ArrayBuffer is returned');
+    assert.eq(decoder.decode(buf), content, 'the whole file is mapped');
+
+    tjs.madvise(buf, 'sequential');
+    assert.throws(() => tjs.madvise(buf, 'nope'), TypeError, 'advice is validated');
+
+    // Private mappings can be written to without changing the file.
+    new Uint8Array(buf)[0] = 120;
+    assert.eq(decoder.decode(await tjs.readFile(path)), content, 'read-only mappings leave the file alone');
+
+    // Offsets don't need to be page aligned.
+    buf = await tjs.mmap(path, { offset: 5000, length: 26 });
+    assert.eq(decoder.decode(buf), content.slice(5000, 5026), 'a range is mapped');
+
+    let error;
+
+    try {
+        await tjs.mmap(path, { offset: content.length - 1, length: 2 });
+    } catch (e) {
+        error = e;
+    }
+
+    assert.eq(error?.code, 'EINVAL', 'mappings stop at the end of the file');
+
+    // Shared mappings write through to the file.
+    const handle = await tjs.open(path, 'r+');
+
+    buf = await tjs.mmap(handle, { mode: 'rw', length: 3 });
+    new Uint8Array(buf).set(encoder.encode('xyz'));
+    tjs.msync(buf);
+    await handle.close();
+
+    const data = decoder.decode(await tjs.readFile(path));
+
+    assert.eq(data.slice(0, 4), 'xyzd', 'writes to shared mappings reach the file');
+
+    tjs.madvise(buf, 'dontneed');
+
+    // Only buffers returned by mmap() are accepted.
+    for (const fn of [ b => tjs.msync(b), b => tjs.madvise(b, 'dontneed') ]) {
+        error = undefined;
+
+        try {
+            fn(new ArrayBuffer(64));
+        } catch (e) {
+            error = e;
+        }
+
+        assert.eq(error?.code, 'EINVAL', 'other buffers are refused');
+    }
+
+    await tjs.remove(path);
+}
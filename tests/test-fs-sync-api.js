@@ -0,0 +1,34 @@
+import assert from 'tjs:assert';
+import path from 'tjs:path';
+
+
+const dir = await tjs.makeTempDir('test_syncXXXXXX');
+const file = path.join(dir, 'config.json');
+
+assert.notOk(tjs.existsSync(file), 'file does not exist yet');
+
+tjs.writeFileSync(file, '{"a": 1}');
+
+assert.ok(tjs.existsSync(file), 'file was created');
+assert.eq(tjs.readFileSync(file, 'utf-8'), '{"a": 1}', 'text is read back');
+
+tjs.writeFileSync(file, new Uint8Array([ 1, 2, 3 ]));
+
+const data = tjs.readFileSync(file);
+
+assert.eq(data[Symbol.toStringTag], 'Uint8Array', 'returns Uint8Array');
+assert.eq(data.join(), '1,2,3', 'file is replaced');
+assert.eq(tjs.readFileSync(file).join(), (await tjs.readFile(file)).join(), 'same as readFile');
+
+const entries = tjs.readDirSync(dir);
+
+assert.eq(entries.length, 1, 'directory is listed');
+assert.eq(entries[0].name, 'config.json', 'entry has a name');
+assert.ok(entries[0].isFile, 'entry has a type');
+
+assert.eq(tjs.realPathSync(file), await tjs.realPath(file), 'same as realPath');
+
+assert.throws(() => tjs.readFileSync(path.join(dir, 'missing')), Error, 'missing file throws');
+assert.throws(() => tjs.readDirSync(file), Error, 'listing a file throws');
+
+await tjs.remove(dir);
@@ -0,0 +1,69 @@
+import assert from 'tjs:assert';
+import path from 'tjs:path';
+
+const encoder = new TextEncoder();
+const root = await tjs.makeTempDir('test_walkXXXXXX');
+
+async function writeFile(name, text) {
+    const f = await tjs.open(path.join(root, name), 'w');
+
+    await f.write(encoder.encode(text));
+    await f.close();
+}
+
+await tjs.makeDir(path.join(root, 'a', 'b'), { recursive: true });
+await writeFile('top.txt', 'top');
+await writeFile(path.join('a', 'one.txt'), 'one');
+await writeFile(path.join('a', 'b', 'two.txt'), 'two!');
+
+const entries = new Map();
+
+for await (const item of await tjs.readDir(root, { recursive: true, withStats: true })) {
+    entries.set(item.name.replaceAll('\\', '/'), item);
+}
+
+assert.eq([ ...entries.keys() ].sort().join(), 'a,a/b,a/b/two.txt,a/one.txt,top.txt', 'all entries are listed');
+assert.ok(entries.get('a/b').isDirectory, 'directories are flagged');
+assert.ok(entries.get('a/b/two.txt').isFile, 'files are flagged');
+assert.eq(entries.get('a/b/two.txt').size, 4, 'size is filled in');
+assert.ok(entries.get('top.txt').mtime instanceof Date, 'mtime is filled in');
+
+// Lots of files, more than a single batch.
+const many = path.join(root, 'many');
+
+await tjs.makeDir(many);
+
+for (let i = 0; i < 1500; i++) {
+    await writeFile(path.join('many', `f${i}`), '');
+}
+
+let count = 0;
+
+for await (const item of await tjs.readDir(many, { recursive: true })) {
+    assert.eq(item.size, undefined, 'no stats unless asked');
+    count++;
+}
+
+assert.eq(count, 1500, 'entries spanning batches are all listed');
+
+// Breaking out stops the walk.
+const walker = await tjs.readDir(root, { recursive: true });
+
+for await (const item of walker) {
+    assert.ok(item.name, 'entry has a name');
+    break;
+}
+
+assert.ok((await walker.next()).done, 'walk is over after closing');
+
+let error;
+
+try {
+    await tjs.readDir(path.join(root, 'missing'), { recursive: true });
+} catch (e) {
+    error = e;
+}
+
+assert.eq(error?.code, 'ENOENT', 'missing directory is reported');
+
+await tjs.remove(root);
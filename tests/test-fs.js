@@ -20,6 +20,25 @@ async function readWrite() {
     await tjs.remove(path);
 };
 
+async function readvWritev() {
+    const f = await tjs.makeTempFile('test_fileXXXXXX');
+    const path = f.path;
+    const nwritten = await f.writev([ encoder.encode('head'), encoder.encode(' payload') ]);
+    assert.eq(nwritten, 12, 'all buffers are written');
+    await f.writev([ encoder.encode('HEAD') ], 0);
+    await f.close();
+    const f2 = await tjs.open(path, 'r');
+    const a = new Uint8Array(4);
+    const b = new Uint8Array(32);
+    const nread = await f2.readv([ a, b ], 0);
+    assert.eq(nread, 12, 'buffers are filled in order');
+    assert.eq(decoder.decode(a) + decoder.decode(b.subarray(0, nread - a.length)), 'HEAD payload');
+    assert.eq(await f2.readv([ a ], 12), null, 'null at EOF');
+    assert.throws(() => f2.readv([ a, 'nope' ]), TypeError, 'only buffers are accepted');
+    await f2.close();
+    await tjs.remove(path);
+};
+
 async function mkstemp() {
     const f = await tjs.makeTempFile('test_fileXXXXXX');
     assert.ok(f.path, 'file was created ok');
@@ -81,6 +100,7 @@ async function chdir() {
 };
 
 await readWrite();
+await readvWritev();
 await mkstemp();
 await mkdir();
 await chmod();
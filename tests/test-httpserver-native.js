@@ -0,0 +1,186 @@
+import assert from 'tjs:assert';
+
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+
+async function readAll(conn) {
+    const buf = new Uint8Array(4096);
+    let data = '';
+
+    while (true) {
+        const nread = await conn.read(buf);
+
+        if (nread === null) {
+            break;
+        }
+
+        data += decoder.decode(buf.subarray(0, nread));
+    }
+
+    return data;
+}
+
+function checksum(bytes) {
+    let sum = 0;
+
+    for (const b of bytes) {
+        sum = (sum * 31 + b) % 65521;
+    }
+
+    return sum;
+}
+
+async function roundTrip(port, raw) {
+    const conn = await tjs.connect('tcp', '127.0.0.1', port);
+
+    await conn.write(encoder.encode(raw));
+
+    const data = await readAll(conn);
+
+    conn.close();
+
+    return data;
+}
+
+const server = tjs.createServer((req, res) => {
+    if (req.url === '/hello') {
+        res.writeHead(200, { 'Content-Type': 'text/plain' });
+        res.end('Hello World');
+    } else if (req.url === '/upload') {
+        req.text().then(body => {
+            res.writeHead(200, { 'Content-Type': 'text/plain' });
+            res.end(`${req.method} ${body.length} ${req.headers['x-test']}`);
+        });
+    } else if (req.url === '/binary') {
+        req.arrayBuffer().then(buf => {
+            res.end(`${buf.byteLength} ${checksum(new Uint8Array(buf))} ${req.complete}`);
+        });
+    } else if (req.url === '/stream') {
+        res.write('a');
+        setTimeout(() => {
+            res.write('b');
+            res.end('c');
+        }, 10);
+    } else if (req.url === '/drain') {
+        const ok = res.write(new Uint8Array(256 * 1024).fill(120));
+
+        res.on('drain', () => res.end(`${ok}`));
+    } else if (req.url === '/chunks') {
+        res.write('a'.repeat(2000));
+        res.write(encoder.encode('b'.repeat(2000)));
+        res.end('c');
+    } else if (req.url === '/split') {
+        const attempts = [
+            [ 'OK\r\nX-Injected: yes', {} ],
+            [ undefined, { 'X-A\r\nX-Injected': 'yes' } ],
+            [ undefined, { 'Bad Name': 'yes' } ],
+        ];
+        const errors = [];
+
+        for (const [ text, headers ] of attempts) {
+            try {
+                res.socket.send(200, text, headers, 'x');
+            } catch (e) {
+                errors.push(e.name);
+            }
+        }
+
+        res.end(errors.join());
+    } else {
+        res.writeHead(404);
+        res.end();
+    }
+});
+
+server.maxBodySize = 4 * 1024 * 1024;
+server.listen(0, '127.0.0.1');
+
+const { port } = server.address();
+
+assert.ok(port > 0, 'server is listening');
+
+let data = await roundTrip(port, 'GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(data.startsWith('HTTP/1.1 200 OK\r\n'), 'status line is sent');
+assert.ok(data.includes('Content-Length: 11\r\n'), 'content length is added');
+assert.ok(data.includes('Connection: close\r\n'), 'connection is closed');
+assert.ok(/\r\nDate: \w{3}, \d{2} \w{3} \d{4} \d{2}:\d{2}:\d{2} GMT\r\n/.test(data), 'date is added');
+assert.ok(data.endsWith('\r\n\r\nHello World'), 'body is sent');
+
+data = await roundTrip(port, 'POST /upload HTTP/1.1\r\nHost: localhost\r\nX-Test: yes\r\n' +
+    'Content-Length: 5\r\nConnection: close\r\n\r\nabcde');
+
+assert.ok(data.endsWith('POST 5 yes'), 'request body and headers are received');
+
+// Large binary bodies are streamed in chunks and arrive intact.
+const payload = new Uint8Array(3 * 1024 * 1024);
+
+for (let i = 0; i < payload.length; i++) {
+    payload[i] = (i * 7) & 0xff;
+}
+
+let conn = await tjs.connect('tcp', '127.0.0.1', port);
+
+await conn.write(encoder.encode('POST /binary HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n' +
+    `Content-Length: ${payload.length}\r\n\r\n`));
+await conn.write(payload);
+data = await readAll(conn);
+conn.close();
+
+assert.ok(data.endsWith(`${payload.length} ${checksum(payload)} true`), 'binary body is received intact');
+
+// Bodies over maxBodySize are refused before they are read.
+data = await roundTrip(port, 'POST /binary HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10000000\r\n\r\n');
+
+assert.ok(data.startsWith('HTTP/1.1 413 Payload Too Large'), 'oversized bodies get a 413');
+
+// Body chunks are written after the head without being concatenated first.
+data = await roundTrip(port, 'GET /chunks HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(data.includes('Content-Length: 4001\r\n'), 'content length covers all chunks');
+assert.ok(data.endsWith(`\r\n\r\n${'a'.repeat(2000)}${'b'.repeat(2000)}c`), 'all chunks are sent in order');
+
+// Writes spread over several ticks are streamed with chunked framing.
+data = await roundTrip(port, 'GET /stream HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(data.includes('Transfer-Encoding: chunked\r\n'), 'streamed responses are chunked');
+assert.ok(!data.includes('Content-Length'), 'streamed responses have no length');
+assert.ok(data.endsWith('\r\n\r\n1\r\na\r\n2\r\nbc\r\n0\r\n\r\n'), 'chunks are framed');
+
+// write() reports backpressure and 'drain' follows.
+data = await roundTrip(port, 'GET /drain HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(data.includes(`\r\n40000\r\n${'x'.repeat(256 * 1024)}\r\n`), 'large chunk is sent');
+assert.ok(data.endsWith('\r\n5\r\nfalse\r\n0\r\n\r\n'), 'drain is emitted after write() returned false');
+
+// Pipelined requests are answered in order on the same connection.
+data = await roundTrip(port, 'GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n' +
+    'GET /missing HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+const first = data.indexOf('HTTP/1.1 200 OK');
+const second = data.indexOf('HTTP/1.1 404 Not Found');
+
+assert.ok(first === 0 && second > first, 'pipelined responses are in order');
+
+// A streamed response holds back the ones pipelined behind it.
+data = await roundTrip(port, 'GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n' +
+    'GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n' +
+    'GET /missing HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+const responses = data.split(/(?=HTTP\/1\.1 )/).map(r => r.slice(9, 12));
+
+assert.eq(responses.join(), '200,200,404', 'pipelined responses follow a streamed one in order');
+assert.ok(data.indexOf('0\r\n\r\n') < data.indexOf('Hello World'), 'streamed response is complete first');
+
+// Status texts and header names can't be used to inject headers.
+data = await roundTrip(port, 'GET /split HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(!data.includes('X-Injected'), 'nothing is injected');
+assert.ok(data.endsWith('TypeError,TypeError,TypeError'), 'bad status texts and header names throw');
+
+data = await roundTrip(port, 'NOT HTTP\r\n\r\n');
+
+assert.ok(data.startsWith('HTTP/1.1 400 Bad Request'), 'parse errors get a 400');
+
+server.close();
@@ -0,0 +1,118 @@
+import assert from 'tjs:assert';
+
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+
+async function roundTrip(port, raw) {
+    const conn = await tjs.connect('tcp', '127.0.0.1', port);
+    const buf = new Uint8Array(65536);
+    let data = '';
+
+    await conn.write(encoder.encode(raw));
+
+    while (true) {
+        const nread = await conn.read(buf);
+
+        if (nread === null) {
+            break;
+        }
+
+        data += decoder.decode(buf.subarray(0, nread));
+    }
+
+    conn.close();
+
+    const idx = data.indexOf('\r\n\r\n');
+
+    return { head: data.slice(0, idx), body: data.slice(idx + 4) };
+}
+
+function header(head, name) {
+    const m = new RegExp(`\r\n${name}: ([^\r]*)`, 'i').exec(head);
+
+    return m?.[1];
+}
+
+// Big enough for the socket to fill up while it's being sent.
+const content = 'abcdefghijklmnopqrstuvwxyz0123456789'.repeat(100000);
+const file = await tjs.makeTempFile('testFile_XXXXXX');
+const path = file.path;
+
+await file.write(encoder.encode(content));
+await file.close();
+
+const results = [];
+const server = tjs.createServer((req, res) => {
+    if (req.url === '/file') {
+        res.setHeader('Content-Type', 'text/plain');
+        res.sendFile(path).then(ok => results.push(ok));
+    } else {
+        res.sendFile('/this/file/does/not/exist').catch(() => {
+            res.writeHead(404);
+            res.end();
+        });
+    }
+});
+
+server.listen(0, '127.0.0.1');
+
+const { port } = server.address();
+const get = headers => `GET /file HTTP/1.1\r\nHost: localhost\r\n${headers}Connection: close\r\n\r\n`;
+
+// The whole file.
+let r = await roundTrip(port, get(''));
+
+assert.ok(r.head.startsWith('HTTP/1.1 200 OK'), 'file is sent');
+assert.eq(header(r.head, 'Content-Length'), String(content.length), 'content length is the file size');
+assert.eq(header(r.head, 'Content-Type'), 'text/plain', 'headers set before are kept');
+assert.eq(header(r.head, 'Accept-Ranges'), 'bytes', 'ranges are advertised');
+assert.ok(r.body === content, 'file content is intact');
+
+const etag = header(r.head, 'ETag');
+const lastModified = header(r.head, 'Last-Modified');
+
+assert.ok(etag && lastModified, 'validators are sent');
+
+// Ranges.
+r = await roundTrip(port, get('Range: bytes=10-19\r\n'));
+
+assert.ok(r.head.startsWith('HTTP/1.1 206 Partial Content'), 'range gets a 206');
+assert.eq(header(r.head, 'Content-Range'), `bytes 10-19/${content.length}`, 'content range is sent');
+assert.eq(r.body, content.slice(10, 20), 'range is sent');
+
+r = await roundTrip(port, get('Range: bytes=-5\r\n'));
+
+assert.eq(r.body, content.slice(-5), 'suffix range is sent');
+
+r = await roundTrip(port, get(`Range: bytes=${content.length}-\r\n`));
+
+assert.ok(r.head.startsWith('HTTP/1.1 416 Range Not Satisfiable'), 'bad range gets a 416');
+assert.eq(header(r.head, 'Content-Range'), `bytes */${content.length}`, 'file size is sent');
+
+r = await roundTrip(port, get(`Range: bytes=0-0\r\nIf-Range: "stale"\r\n`));
+
+assert.ok(r.head.startsWith('HTTP/1.1 200 OK') && r.body === content, 'stale If-Range gets the whole file');
+
+// Conditional requests.
+r = await roundTrip(port, get(`If-None-Match: ${etag}\r\n`));
+
+assert.ok(r.head.startsWith('HTTP/1.1 304 Not Modified'), 'matching etag gets a 304');
+assert.eq(r.body, '', '304 has no body');
+
+r = await roundTrip(port, get(`If-Modified-Since: ${lastModified}\r\n`));
+
+assert.ok(r.head.startsWith('HTTP/1.1 304 Not Modified'), 'unmodified file gets a 304');
+
+r = await roundTrip(port, 'HEAD /file HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.eq(header(r.head, 'Content-Length'), String(content.length), 'HEAD gets the length');
+assert.eq(r.body, '', 'HEAD gets no body');
+
+r = await roundTrip(port, 'GET /missing HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n');
+
+assert.ok(r.head.startsWith('HTTP/1.1 404 Not Found'), 'missing files can be answered by the caller');
+assert.ok(results.length > 0 && results.every(ok => ok), 'sendFile() resolves to true');
+
+server.close();
+await tjs.remove(path);
@@ -0,0 +1,61 @@
+import assert from 'tjs:assert';
+
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+
+async function readAll(conn) {
+    const buf = new Uint8Array(4096);
+    let data = '';
+
+    while (true) {
+        const nread = await conn.read(buf);
+
+        if (nread === null) {
+            break;
+        }
+
+        data += decoder.decode(buf.subarray(0, nread));
+    }
+
+    return data;
+}
+
+const server = tjs.createServer((req, res) => {
+    res.end('ok');
+});
+
+server.headersTimeout = 300;
+server.keepAliveTimeout = 300;
+server.listen(0, '127.0.0.1');
+
+const { port } = server.address();
+
+// A request whose headers never finish is answered with a 408 and dropped.
+let conn = await tjs.connect('tcp', '127.0.0.1', port);
+let start = Date.now();
+
+await conn.write(encoder.encode('GET / HTTP/1.1\r\nHost: localhost\r\n'));
+
+let data = await readAll(conn);
+
+conn.close();
+
+assert.ok(data.startsWith('HTTP/1.1 408 Request Timeout\r\n'), 'slow headers get a 408');
+assert.ok(Date.now() - start >= 300, 'headers timeout is honored');
+
+// An idle keep-alive connection is closed after the response.
+conn = await tjs.connect('tcp', '127.0.0.1', port);
+start = Date.now();
+
+await conn.write(encoder.encode('GET / HTTP/1.1\r\nHost: localhost\r\n\r\n'));
+
+data = await readAll(conn);
+
+conn.close();
+
+assert.ok(data.startsWith('HTTP/1.1 200 OK\r\n') && data.endsWith('\r\n\r\nok'), 'response is sent');
+assert.ok(!data.includes('408'), 'idle keep-alive connections are closed silently');
+assert.ok(Date.now() - start >= 300, 'keep-alive timeout is honored');
+
+server.close();
@@ -0,0 +1,91 @@
+import assert from 'tjs:assert';
+import path from 'tjs:path';
+
+import handler, { markMain } from './helpers/http-handler.js';
+
+const core = globalThis[Symbol.for('tjs.internal.core')];
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+
+async function get(port, url) {
+    const conn = await tjs.connect('tcp', '127.0.0.1', port);
+    const buf = new Uint8Array(4096);
+    let data = '';
+
+    await conn.write(encoder.encode(`GET ${url} HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n`));
+
+    while (true) {
+        const nread = await conn.read(buf);
+
+        if (nread === null) {
+            break;
+        }
+
+        data += decoder.decode(buf.subarray(0, nread));
+    }
+
+    conn.close();
+
+    return data;
+}
+
+markMain();
+
+if (core.TCP_REUSEPORT !== undefined) {
+    // Two servers can share a port when both ask for it.
+    const a = tjs.createServer(handler);
+
+    a.listen({ port: 0, host: '127.0.0.1', reusePort: true });
+
+    const b = tjs.createServer(handler);
+
+    b.listen({ port: a.address().port, host: '127.0.0.1', reusePort: true });
+
+    assert.eq(a.address().port, b.address().port, 'both servers listen on the same port');
+
+    a.close();
+    b.close();
+
+    // Worker pool, every worker runs the handler module.
+    const server = tjs.createServer(handler);
+    let error;
+
+    server.on('error', err => {
+        error = err;
+    });
+    server.listen({
+        port: 0,
+        host: '127.0.0.1',
+        workers: 2,
+        module: path.join(import.meta.dirname, 'helpers', 'http-handler.js'),
+    });
+
+    assert.eq(server.workers, 2, 'workers are started');
+
+    const { port } = server.address();
+
+    // The main thread serves on the same port, and the workers take a moment
+    // to start listening, so keep going until one of them answers.
+    let byWorker = 0;
+
+    for (let i = 0; i < 200 && byWorker === 0; i++) {
+        const data = await get(port, `/${i}`);
+
+        assert.ok(data.endsWith(`ok /${i}`), 'request is served');
+
+        if (data.includes('\r\nX-Served-By: worker\r\n')) {
+            byWorker++;
+        } else {
+            await new Promise(resolve => setTimeout(resolve, 10));
+        }
+    }
+
+    assert.ok(byWorker > 0, 'a worker served a request');
+
+    assert.ok(!error, 'workers start without errors');
+
+    server.close();
+
+    assert.eq(server.workers, 0, 'workers are terminated on close');
+}
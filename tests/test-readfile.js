@@ -4,3 +4,25 @@ import assert from 'tjs:assert';
 const data = await tjs.readFile(import.meta.path);
 
 assert.eq(data[Symbol.toStringTag], 'Uint8Array', 'returns Uint8Array');
+
+const text = await tjs.readFile(import.meta.path, 'utf-8');
+
+assert.eq(typeof text, 'string', 'returns a string with an encoding');
+assert.eq(text, new TextDecoder().decode(data), 'string matches the decoded bytes');
+
+const f = await tjs.makeTempFile('test_readfileXXXXXX');
+
+await f.write(new Uint8Array([ 0xef, 0xbb, 0xbf, 0x68, 0xc3, 0xa9 ]));
+await f.close();
+assert.eq(await tjs.readFile(f.path, 'utf8'), 'hé', 'BOM is skipped');
+await tjs.remove(f.path);
+
+let error;
+
+try {
+    await tjs.readFile(import.meta.path, 'latin1');
+} catch (e) {
+    error = e;
+}
+
+assert.ok(error instanceof RangeError, 'other encodings are refused');
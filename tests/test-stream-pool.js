@@ -0,0 +1,36 @@
+import assert from 'tjs:assert';
+
+
+const server = await tjs.listen('tcp', '127.0.0.1');
+const { port } = server.localAddress;
+
+async function connectMany(n) {
+    for (let i = 0; i < n; i++) {
+        const client = await tjs.connect('tcp', '127.0.0.1', port);
+        const conn = await server.accept();
+
+        await client.write(new Uint8Array(16));
+        client.shutdown();
+        conn.close();
+        client.close();
+    }
+
+    // Let the handles close and their objects go away.
+    await new Promise(resolve => setTimeout(resolve, 50));
+    tjs.engine.gc.run();
+}
+
+await connectMany(10);
+
+const before = tjs.engine.streamPoolStats();
+
+assert.ok(before.streams.free > 0, 'closed streams are kept for reuse');
+
+await connectMany(10);
+
+const after = tjs.engine.streamPoolStats();
+
+assert.ok(after.streams.hits > before.streams.hits, 'streams are reused');
+assert.ok(after.shutdownReqs.hits > 0, 'shutdown requests are reused');
+
+server.close();
@@ -0,0 +1,37 @@
+import assert from 'tjs:assert';
+
+
+const server = await tjs.listen('tcp', '127.0.0.1');
+const { ip, port } = server.localAddress;
+
+const clients = await Promise.all([ 1, 2, 3, 4, 5 ].map(() => tjs.connect('tcp', ip, port)));
+
+let accepted = [];
+
+while (accepted.length < clients.length) {
+    const conns = await server.acceptMany(3);
+
+    assert.ok(conns.length > 0 && conns.length <= 3, 'batches are bounded by max');
+    accepted = accepted.concat(conns);
+}
+
+assert.eq(accepted.length, clients.length, 'all connections are accepted');
+
+for (const conn of [ ...accepted, ...clients ]) {
+    conn.close();
+}
+
+// Regular accept() still works after batching.
+const client = await tjs.connect('tcp', ip, port);
+const conn = await server.accept();
+
+assert.ok(conn, 'single accept works');
+
+conn.close();
+client.close();
+
+const pending = server.acceptMany();
+
+server.close();
+
+assert.eq(await pending, undefined, 'closing resolves pending batches with undefined');
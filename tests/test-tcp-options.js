@@ -0,0 +1,37 @@
+import assert from 'tjs:assert';
+
+
+const linux = tjs.system.platform === 'linux';
+const server = await tjs.listen('tcp', '127.0.0.1', 0, {
+    sendBufferSize: 65536,
+    recvBufferSize: 65536,
+    fastOpen: linux,
+    deferAccept: linux
+});
+const accepted = server.accept();
+const client = await tjs.connect('tcp', '127.0.0.1', server.localAddress.port, {
+    noDelay: true,
+    sendBufferSize: 32768,
+    recvBufferSize: 32768
+});
+
+// With TCP_DEFER_ACCEPT the connection is only accepted once data arrives.
+await client.write(new TextEncoder().encode('x'));
+
+const conn = await accepted;
+
+assert.ok(conn, 'connection is accepted');
+
+client.setSendBufferSize(65536);
+client.setRecvBufferSize(65536);
+assert.throws(() => client.setSendBufferSize(0), Error, 'buffer sizes must be positive');
+
+if (linux) {
+    client.setQuickAck(true);
+} else {
+    assert.throws(() => client.setQuickAck(true), Error, 'quick ack is not supported');
+}
+
+conn.close();
+client.close();
+server.close();
@@ -0,0 +1,15 @@
+import assert from 'tjs:assert';
+import path from 'tjs:path';
+
+
+// The worker's runtime goes away while the pipe is still running.
+const w = new Worker(path.join(import.meta.dirname, 'helpers', 'tcp-pipe-worker.js'));
+const timer = setTimeout(() => {
+    w.terminate();
+    assert.fail('Timeout out waiting for worker');
+}, 1000);
+w.onmessage = event => {
+    clearTimeout(timer);
+    assert.eq(event.data, 'piping', 'the pipe is started');
+    setTimeout(() => w.terminate(), 50);
+};
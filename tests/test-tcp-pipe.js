@@ -0,0 +1,67 @@
+import assert from 'tjs:assert';
+
+
+const size = 4 * 1024 * 1024;
+const payload = new Uint8Array(size);
+
+for (let i = 0; i < size; i++) {
+    payload[i] = (i * 7) & 0xff;
+}
+
+// Sends the payload and closes.
+const source = await tjs.listen('tcp', '127.0.0.1');
+
+(async () => {
+    const conn = await source.accept();
+
+    await conn.write(payload);
+    conn.close();
+})();
+
+// Reads slowly until the end, so the pipe has to wait for it.
+const sink = await tjs.listen('tcp', '127.0.0.1');
+const received = (async () => {
+    const conn = await sink.accept();
+    const buf = new Uint8Array(size + 1);
+    let n = 0;
+
+    while (true) {
+        const nread = await conn.read(buf.subarray(n, n + 65536));
+
+        if (nread === null) {
+            break;
+        }
+
+        n += nread;
+
+        if (n % 8 === 0) {
+            await new Promise(resolve => setTimeout(resolve, 1));
+        }
+    }
+
+    conn.close();
+
+    return buf.subarray(0, n);
+})();
+
+const from = await tjs.connect('tcp', '127.0.0.1', source.localAddress.port);
+const to = await tjs.connect('tcp', '127.0.0.1', sink.localAddress.port);
+const piped = from.pipeTo(to, { highWaterMark: 65536 });
+
+assert.throws(() => from.read(new Uint8Array(16)), Error, 'reading is refused while piping');
+
+assert.eq(await piped, size, 'all bytes are piped');
+
+const data = await received;
+let intact = data.length === size;
+
+for (let i = 0; intact && i < size; i++) {
+    intact = data[i] === payload[i];
+}
+
+assert.ok(intact, 'data is piped intact and the destination is shut down');
+
+from.close();
+to.close();
+source.close();
+sink.close();
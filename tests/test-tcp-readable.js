@@ -0,0 +1,127 @@
+import assert from 'tjs:assert';
+
+
+const size = 4 * 1024 * 1024;
+const payload = new Uint8Array(size);
+
+for (let i = 0; i < size; i++) {
+    payload[i] = i & 0xff;
+}
+
+const server = await tjs.listen('tcp', '127.0.0.1');
+
+(async () => {
+    const conn = await server.accept();
+
+    await conn.write(payload);
+    conn.close();
+})();
+
+const { ip, port } = server.localAddress;
+const client = await tjs.connect('tcp', ip, port);
+const chunks = [];
+let total = 0;
+
+for await (const chunk of client.readable) {
+    chunks.push(chunk);
+    total += chunk.byteLength;
+
+    // Let the queue fill up so reading stops and starts again.
+    if (chunks.length % 8 === 0) {
+        await new Promise(resolve => setTimeout(resolve, 5));
+    }
+}
+
+assert.eq(total, size, 'all data is read');
+
+let offset = 0;
+let intact = true;
+
+for (const chunk of chunks) {
+    for (let i = 0; i < chunk.length; i++) {
+        if (chunk[i] !== ((offset + i) & 0xff)) {
+            intact = false;
+        }
+    }
+
+    offset += chunk.length;
+}
+
+assert.ok(intact, 'chunks arrive in order and intact');
+
+server.close();
+
+// BYOB readers get the data copied into their own buffers.
+const byobServer = await tjs.listen('tcp', '127.0.0.1');
+
+(async () => {
+    const conn = await byobServer.accept();
+
+    await conn.write(payload.subarray(0, 100000));
+    conn.close();
+})();
+
+const byobClient = await tjs.connect('tcp', byobServer.localAddress.ip, byobServer.localAddress.port);
+const reader = byobClient.readable.getReader({ mode: 'byob' });
+let byobTotal = 0;
+let byobIntact = true;
+
+while (true) {
+    const { done, value } = await reader.read(new Uint8Array(1000));
+
+    if (done) {
+        break;
+    }
+
+    assert.ok(value.byteLength <= 1000, 'reads fit the given buffer');
+
+    for (let i = 0; i < value.length; i++) {
+        if (value[i] !== ((byobTotal + i) & 0xff)) {
+            byobIntact = false;
+        }
+    }
+
+    byobTotal += value.byteLength;
+}
+
+assert.eq(byobTotal, 100000, 'all data is read with a BYOB reader');
+assert.ok(byobIntact, 'BYOB reads are in order and intact');
+
+byobServer.close();
+
+// Writes through the writable stream don't wait on each other.
+const sink = await tjs.listen('tcp', '127.0.0.1');
+const received = (async () => {
+    const conn = await sink.accept();
+    const buf = new Uint8Array(65536);
+    let n = 0;
+
+    while (true) {
+        const nread = await conn.read(buf);
+
+        if (nread === null) {
+            break;
+        }
+
+        n += nread;
+    }
+
+    conn.close();
+
+    return n;
+})();
+
+const writer = await tjs.connect('tcp', '127.0.0.1', sink.localAddress.port);
+const w = writer.writable.getWriter();
+
+for (let i = 0; i < 1000; i++) {
+    w.write(new Uint8Array(1024).fill(i & 0xff));
+}
+
+assert.ok(writer.writeQueueSize >= 0, 'write queue size is reported');
+
+await w.close();
+
+assert.eq(await received, 1000 * 1024, 'all writes are sent before closing');
+
+sink.close();
@@ -36,9 +36,36 @@ let dataStr, nread;
 nread = await client.read(readBuf);
 dataStr = decoder.decode(readBuf.subarray(0, nread));
 assert.eq(dataStr, "PING", "sending works");
+client.write([ encoder.encode('PI'), encoder.encode(''), encoder.encode('NG') ]);
+dataStr = '';
+while (dataStr.length < 4) {
+    nread = await client.read(readBuf);
+    dataStr += decoder.decode(readBuf.subarray(0, nread));
+}
+assert.eq(dataStr, "PING", "sending multiple buffers works");
 assert.throws(() => { client.write("PING"); }, TypeError, "sending anything else gives TypeError");
 assert.throws(() => { client.write(1234); }, TypeError, "sending anything else gives TypeError");
+assert.throws(() => { client.write([ encoder.encode('PI'), 'NG' ]); }, TypeError, "sending arrays of anything else gives TypeError");
+client.cork();
+const corked = [ client.write(encoder.encode('PI')), client.write([ encoder.encode('N'), encoder.encode('G') ]) ];
+client.uncork();
+assert.eq((await Promise.all(corked)).join(), "2,2", "corked writes resolve to their own size");
+dataStr = '';
+while (dataStr.length < 4) {
+    nread = await client.read(readBuf);
+    dataStr += decoder.decode(readBuf.subarray(0, nread));
+}
+assert.eq(dataStr, "PING", "corked writes are sent on uncork");
+client.cork();
+const dropped = client.write(encoder.encode('LOST'));
 client.close();
+let droppedErr;
+try {
+    await dropped;
+} catch (e) {
+    droppedErr = e;
+}
+assert.eq(droppedErr?.code, "ECANCELED", "corked writes are rejected on close");
 server.close();
 
 const server1 = await tjs.listen('tcp', '127.0.0.1');
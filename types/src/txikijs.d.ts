@@ -106,6 +106,12 @@ declare global {
 
         type CompiledCode = unknown;
 
+        interface PoolStats {
+            hits: number;
+            misses: number;
+            free: number;
+        }
+
         /** @namespace 
          * 
          */
@@ -162,6 +168,18 @@ declare global {
                 threshold: number;
             }
 
+            /**
+            * Reuse of the memory behind streams (TCP, pipes, TTYs) and their
+            * write and shutdown requests, for tuning and diagnostics.
+            * `free` is how many are currently kept for reuse.
+            */
+            streamPoolStats: () => {
+                streams: PoolStats;
+                writeReqs: PoolStats;
+                shutdownReqs: PoolStats;
+                freeSlabs: number;
+            };
+
             /**
             * Versions of all included libraries and txiki.js itself.
             */
@@ -319,6 +337,26 @@ declare global {
             */
             write(buffer: Uint8Array, offset?: number): Promise<number>;
             
+            /**
+            * Reads data into several buffers in a single request, filling them in order.
+            * Returns the total amount of read data or null for EOF.
+            * See [preadv(2)](https://man7.org/linux/man-pages/man2/preadv.2.html)
+            *
+            * @param buffers Buffers to read data into.
+            * @param offset Offset in the file to read from.
+            */
+            readv(buffers: Uint8Array[], offset?: number): Promise<number|null>;
+            
+            /**
+            * Writes data from several buffers in a single request, without concatenating them
+            * first. Returns the total amount of data written.
+            * See [pwritev(2)](https://man7.org/linux/man-pages/man2/pwritev.2.html)
+            *
+            * @param buffers Buffers to write.
+            * @param offset Offset in the file to write to.
+            */
+            writev(buffers: Uint8Array[], offset?: number): Promise<number>;
+            
             /**
             * Closes the file.
             */
@@ -566,6 +604,55 @@ declare global {
         */
         function readDir(path: string): Promise<DirHandle>;
         
+        interface ReadDirOptions {
+            /**
+            * Also list the content of every subdirectory. Entry names are relative to `path`.
+            * Symbolic links to directories are not followed.
+            */
+            recursive?: boolean;
+            
+            /**
+            * Fill in the `size` and `mtime` of every entry, see [lstat(2)](https://man7.org/linux/man-pages/man2/lstat.2.html).
+            */
+            withStats?: boolean;
+        }
+        
+        interface WalkEnt extends DirEnt {
+            size?: number;
+            mtime?: Date;
+        }
+        
+        interface WalkHandle extends AsyncIterableIterator<WalkEnt> {
+            
+            /**
+            * Stops the walk.
+            */
+            close(): Promise<void>;
+            
+            /**
+            * Path of the directory.
+            */
+            path: string;
+        }
+        
+        /**
+        * Lists a directory, and optionally all the ones below it. The directories are
+        * read on the thread pool in large batches, which is much cheaper than one
+        * request per entry.
+        *
+        * ```js
+        * for await (const item of await tjs.readDir('src', { recursive: true, withStats: true })) {
+        *     console.log(item.name, item.size);
+        * }
+        * ```
+        *
+        * Subdirectories that can't be read are skipped.
+        *
+        * @param path Path to the directory.
+        * @param options Walk options.
+        */
+        function readDir(path: string, options: ReadDirOptions): Promise<WalkHandle>;
+        
         /**
         * Reads the value of a symbolic link.
         * See [readlink(2)](https://man7.org/linux/man-pages/man2/readlink.2.html)
@@ -581,6 +668,97 @@ declare global {
         */
         function readFile(path: string): Promise<Uint8Array>;
 
+        /**
+        * Reads the entire contents of a file as text. A leading BOM is skipped.
+        *
+        * @param path File path.
+        * @param encoding Only UTF-8 is supported.
+        */
+        function readFile(path: string, encoding: 'utf-8' | 'utf8'): Promise<string>;
+
+        /**
+        * Synchronous version of {@link readFile}. It blocks until the file is read, which
+        * is cheaper than going through the thread pool for small files, e.g. at startup.
+        *
+        * @param path File path.
+        */
+        function readFileSync(path: string): Uint8Array;
+
+        /**
+        * Synchronous version of {@link readFile} returning text. A leading BOM is skipped.
+        *
+        * @param path File path.
+        * @param encoding Only UTF-8 is supported.
+        */
+        function readFileSync(path: string, encoding: 'utf-8' | 'utf8'): string;
+
+        /**
+        * Writes a file synchronously, creating it or replacing its content.
+        *
+        * @param path File path.
+        * @param data Data to write, strings are written as UTF-8.
+        * @param mode Permissions for a newly created file. Defaults to 0o666.
+        */
+        function writeFileSync(path: string, data: string | Uint8Array, mode?: number): void;
+
+        /**
+        * Lists the entries of a directory synchronously.
+        *
+        * @param path Path to the directory.
+        */
+        function readDirSync(path: string): DirEnt[];
+
+        /**
+        * Checks synchronously whether a path exists. Symbolic links are followed.
+        *
+        * @param path Path to check.
+        */
+        function existsSync(path: string): boolean;
+
+        /**
+        * Synchronous version of {@link realPath}.
+        *
+        * @param path Path to convert.
+        */
+        function realPathSync(path: string): string;
+
+        interface MmapOptions {
+            /* Where the mapping starts in the file. Defaults to 0. */
+            offset?: number;
+            /* Bytes to map. Defaults to the rest of the file, and can't go past its end. */
+            length?: number;
+            /**
+            * 'r' (the default) maps a private copy: writes to the buffer don't reach the
+            * file. 'rw' maps the file shared, writes go to the file (see {@link msync}).
+            */
+            mode?: 'r' | 'rw';
+        }
+
+        /**
+        * Maps a file into memory. The returned `ArrayBuffer` is backed by the mapping,
+        * which is removed when the buffer is garbage collected. It doesn't count
+        * against the memory limit. Not available on Windows.
+        *
+        * The file must not shrink while mapped: accessing pages past its end
+        * terminates the process.
+        *
+        * @param file File path, or an open file handle.
+        * @param options Mapping options.
+        */
+        function mmap(file: string | FileHandle, options?: MmapOptions): Promise<ArrayBuffer>;
+
+        /**
+        * Writes back the changes made to a buffer returned by {@link mmap} in 'rw' mode,
+        * waiting for them to reach the file.
+        */
+        function msync(buffer: ArrayBuffer): void;
+
+        /**
+        * Tells the kernel how a buffer returned by {@link mmap} will be accessed.
+        * Like {@link msync}, it throws EINVAL for any other buffer.
+        */
+        function madvise(buffer: ArrayBuffer, advice: 'normal' | 'sequential' | 'random' | 'willneed' | 'dontneed'): void;
+
         interface RemoveOptions {
             /* Amount of times to retry the operation in case it fails. Defaults to 0. */
             maxRetries?: number;
@@ -739,15 +917,60 @@ declare global {
         
         interface Connection {
             read(buf: Uint8Array): Promise<number|null>;
-            write(buf: Uint8Array): Promise<number>;
+            /**
+            * Writes the given buffer, or all the given buffers in a single
+            * vectored write, without concatenating them first.
+            */
+            write(buf: Uint8Array | Uint8Array[]): Promise<number>;
+            /**
+            * Holds back writes until the matching {@link uncork} call, which
+            * sends all of them in a single vectored write. Useful when issuing
+            * many small writes, e.g. corking and uncorking in a microtask.
+            */
+            cork(): void;
+            /**
+            * Undoes one {@link cork} call, writing what was held back once
+            * the connection is no longer corked. {@link shutdown} writes what
+            * is held back first, {@link close} discards it and rejects those
+            * writes with ECANCELED.
+            */
+            uncork(): void;
+            /**
+            * Sends everything read from this connection to `dest`, without
+            * going through JS, until the end of the stream. Reading pauses
+            * while `dest` has `highWaterMark` bytes (256KB by default) queued.
+            * Resolves to the number of bytes moved. `dest` is shut down at
+            * the end unless `end` is false.
+            */
+            pipeTo(dest: Connection, options?: { end?: boolean, highWaterMark?: number }): Promise<number>;
             setKeepAlive(enable: boolean, delay: number): void;
             setNoDelay(enable?: boolean): void;
+            /**
+            * Sets TCP_QUICKACK (Linux only). This is a one-shot hint: the kernel
+            * clears it on its own, so call it again after reads that need it.
+            */
+            setQuickAck(enable?: boolean): void;
+            setSendBufferSize(size: number): void;
+            setRecvBufferSize(size: number): void;
             shutdown(): void;
             close(): void;
             localAddress: Address;
             remoteAddress: Address;
+            /**
+            * A byte stream, BYOB readers are supported. Chunks handed to default
+            * readers share 256KB slabs, a slab stays allocated while any of its
+            * chunks is alive: copy the chunks you keep around.
+            */
             readable: ReadableStream<Uint8Array>;
+            /**
+            * Writes resolve without waiting for the data to be sent while
+            * less than 64KB are queued.
+            */
             writable: WritableStream<Uint8Array>;
+            /**
+            * Number of bytes written but not yet handed to the kernel.
+            */
+            readonly writeQueueSize: number;
         }
         
         interface DatagramData {
@@ -776,6 +999,17 @@ declare global {
             * Disables dual stack mode.
             */
             ipv6Only?: boolean;
+            
+            /**
+            * Used on TCP only. Sets TCP_NODELAY once connected.
+            */
+            noDelay?: boolean;
+            
+            /**
+            * Used on TCP only. Socket buffer sizes.
+            */
+            sendBufferSize?: number;
+            recvBufferSize?: number;
         }
         
         /**
@@ -790,6 +1024,11 @@ declare global {
         
         interface Listener extends AsyncIterable<Connection> {
             accept(): Promise<Connection>;
+            /**
+            * Accepts all the connections which are ready at once, up to `max`
+            * (128 by default). Resolves to `undefined` once the listener is closed.
+            */
+            acceptMany(max?: number): Promise<Connection[] | undefined>;
             close(): void;
             localAddress: Address;
         }
@@ -810,6 +1049,35 @@ declare global {
             * any traffic, in effect "stealing" the port from the previous listener.
             */
             reuseAddr?: boolean;
+            
+            /**
+            * Used on TCP only.
+            * Enable port reusing (SO_REUSEPORT). Multiple threads or processes can
+            * listen on the same address and port (provided they all set the flag) and
+            * the kernel load-balances incoming connections across them.
+            */
+            reusePort?: boolean;
+            
+            /**
+            * Used on TCP only.
+            * Enables TCP Fast Open (where supported) with the given queue
+            * length for pending Fast Open requests, 256 if `true`.
+            */
+            fastOpen?: boolean | number;
+            
+            /**
+            * Used on TCP only, Linux.
+            * Connections are only accepted once data arrives, waiting up to
+            * the given number of seconds (TCP_DEFER_ACCEPT).
+            */
+            deferAccept?: boolean | number;
+            
+            /**
+            * Used on TCP only.
+            * Socket buffer sizes, inherited by accepted connections.
+            */
+            sendBufferSize?: number;
+            recvBufferSize?: number;
         }
         
         /**